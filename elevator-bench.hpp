@@ -0,0 +1,175 @@
+// Elevator bench components: minimal UI, door, drive, and timer API's for
+// timing the FSM itself. Every command succeeds immediately and nothing is
+// simulated; the bench raises the completion events itself.
+//
+#ifndef ELEVATOR_BENCH_HPP
+#define ELEVATOR_BENCH_HPP
+
+#include "elevator-fsm.hpp"
+
+#include <chrono>
+
+class BenchUi : public ElevatorUiApi
+{
+public:
+    virtual void arrived(size_t floor) {}
+    virtual void inService() {}
+    virtual void outOfService() {}
+    virtual void alarmOn() {}
+    virtual void alarmOff() {}
+    virtual void hallCallSkipped(size_t floor) {}
+
+    bool floorRequest(size_t floor) { return client_->handleFloorRequest(floor); }
+    bool openButton()               { return client_->handleOpenButton(); }
+    bool restoreService()           { return client_->handleRestoreService(); }
+};
+
+class BenchDoor : public ElevatorDoorApi
+{
+public:
+    virtual void open() {}
+    virtual void close() {}
+
+    bool opened() { return client_->handleOpened(); }
+    bool closed() { return client_->handleClosed(); }
+};
+
+class BenchDrive : public ElevatorDriveApi
+{
+public:
+    BenchDrive()
+        : floor_(ElevatorFsm::GROUND_FLOOR)
+        {}
+
+    virtual void   goToFloor(size_t floor) { floor_ = floor; }
+    virtual void   stop() {}
+    virtual void   start() {}
+    virtual size_t getFloor() const { return floor_; }
+    virtual bool   isAtFloor() const { return true; }
+
+    bool arrived() { return client_->handleArrived(); }
+
+private:
+    size_t floor_;
+};
+
+class BenchTimer : public ElevatorTimerApi
+{
+public:
+    BenchTimer()
+        : now_(0)
+        {}
+
+    virtual void   start(size_t msec) {}
+    virtual void   stop() {}
+    virtual size_t nowMsec() const { return now_; }
+
+    bool expired() { return client_->handleExpired(); }
+    void advance(size_t msec) { now_ += msec; }
+
+private:
+    size_t now_;
+};
+
+// Timer on a virtual clock that expires when the bench advances the clock
+// past its deadline, counting the starts and stops the FSM issues.
+class BenchVirtualTimer : public ElevatorTimerApi
+{
+public:
+    BenchVirtualTimer()
+        : now_(0)
+        , deadline_(0)
+        , armed_(false)
+        , calls_(0)
+        {}
+
+    virtual void start(size_t msec)
+    {
+        deadline_ = now_ + msec;
+        armed_    = true;
+        ++calls_;
+    }
+    virtual void stop()
+    {
+        armed_ = false;
+        ++calls_;
+    }
+    virtual size_t nowMsec() const { return now_; }
+
+    // Expire at each deadline passed on the way, including any the FSM sets
+    // on expiry.
+    void advance(size_t msec)
+    {
+        size_t end = now_ + msec;
+
+        while (armed_ && (deadline_ <= end))
+        {
+            now_   = deadline_;
+            armed_ = false;
+            client_->handleExpired();
+        }
+        now_ = end;
+    }
+
+    size_t calls() const { return calls_; }
+
+private:
+    size_t now_;
+    size_t deadline_;
+    bool   armed_;
+    size_t calls_;
+};
+
+// Wall-clock timer, for stand-ins that run in real time. Timers never
+// expire; the bench raises expiry itself if it needs to.
+class BenchClockTimer : public ElevatorTimerApi
+{
+public:
+    virtual void   start(size_t msec) {}
+    virtual void   stop() {}
+    virtual size_t nowMsec() const
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+// One car's bench components, for an FSM constructed on them.
+struct BenchCar
+{
+    BenchUi    ui;
+    BenchDoor  door;
+    BenchDrive drive;
+    BenchTimer timer;
+
+    // Serve one floor request: five state changes, from Stopped back to
+    // Stopped.
+    void trip(size_t floor)
+    {
+        ui.floorRequest(floor);
+        timer.advance(5000);
+        drive.arrived();
+        timer.advance(2000);
+        door.opened();
+        timer.expired();
+        timer.advance(3000);
+        door.closed();
+    }
+};
+
+// Wall-clock nanoseconds per call of a function run the given number of times.
+template <typename Function>
+double benchNsec(size_t iterations, Function function)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t iteration = 0; iteration < iterations; ++iteration)
+    {
+        function(iteration);
+    }
+
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+#endif // ELEVATOR_BENCH_HPP
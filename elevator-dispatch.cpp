@@ -0,0 +1,175 @@
+// Destination dispatcher: groups destination calls into cars.
+//
+#include "elevator-dispatch.hpp"
+
+//---------- Class ElevatorDestinationDispatcher Implementation ---------------
+
+ElevatorDestinationDispatcher::ElevatorDestinationDispatcher(size_t cars, size_t capacity)
+    : cars_((cars < MAX_CARS) ? cars : MAX_CARS)
+    , capacity_(capacity)
+    , driveModel_(nullptr)
+    , energyModel_(nullptr)
+    , msecPerWh_(0)
+{
+    for (size_t car = 0; car < MAX_CARS; ++car)
+    {
+        pickups_[car]   = 0;
+        dropoffs_[car]  = 0;
+        committed_[car] = 0;
+        lowest_[car]    = ElevatorFsm::GROUND_FLOOR;
+        highest_[car]   = MAX_FLOORS;
+
+        for (size_t floor = 0; floor <= MAX_FLOORS; ++floor)
+        {
+            pickupDestinations_[car][floor] = 0;
+        }
+    }
+}
+
+void ElevatorDestinationDispatcher::setReach(size_t car, size_t lowest, size_t highest)
+{
+    lowest_[car]  = lowest;
+    highest_[car] = (highest < MAX_FLOORS) ? highest : MAX_FLOORS;
+}
+
+size_t ElevatorDestinationDispatcher::assign(
+        const ElevatorDestinationCall &call,
+        const size_t *carFloors)
+{
+    size_t  best     = NO_CAR;
+    int64_t bestCost = INT64_MAX;
+
+    // Floors are bits of the masks: a floor beyond them can't be taken.
+    if ((call.origin < ElevatorFsm::GROUND_FLOOR) || (call.origin > MAX_FLOORS) ||
+        (call.destination < ElevatorFsm::GROUND_FLOOR) || (call.destination > MAX_FLOORS))
+    {
+        return NO_CAR;
+    }
+
+    for (size_t car = 0; car < cars_; ++car)
+    {
+        size_t origin      = servedFloor(car, call.origin);
+        size_t destination = servedFloor(car, call.destination);
+
+        if ((committed_[car] + call.groupSize > capacity_) ||
+            !isReachable(car, origin) || !isReachable(car, destination) ||
+            (origin == destination))
+        {
+            continue;
+        }
+
+        // Grouping: a call costs nothing extra when the car is already
+        // stopping at both its origin and its destination.
+        uint64_t stopping = pickups_[car] | dropoffs_[car];
+        size_t   added    = ((stopping & bit(origin)) ? 0 : 1) +
+                            ((destinations(car) & bit(destination)) ? 0 : 1);
+        size_t   distance = (carFloors[car] > origin) ? (carFloors[car] - origin)
+                                                      : (origin - carFloors[car]);
+        size_t   travel   = driveModel_ ? driveModel_->travelMsec(carFloors[car], origin)
+                                        : distance * FLOOR_TRAVEL_MSEC;
+        // Each added stop delays everyone already assigned to the car as
+        // well as the new group.
+        int64_t  cost     = added * STOP_COST_MSEC * (committed_[car] + 1) + travel;
+
+        // A car the model can't price goes on time alone.
+        if (energyModel_ && energyModel_->hasFloor(carFloors[car]) &&
+            energyModel_->hasFloor(origin) && energyModel_->hasFloor(destination))
+        {
+            cost += static_cast<int64_t>(msecPerWh_ *
+                energyWh(car, carFloors[car], origin, destination, call.groupSize));
+        }
+
+        if (cost < bestCost)
+        {
+            best     = car;
+            bestCost = cost;
+        }
+    }
+
+    if (best != NO_CAR)
+    {
+        size_t origin = servedFloor(best, call.origin);
+
+        pickups_[best] |= bit(origin);
+        pickupDestinations_[best][origin] |= bit(servedFloor(best, call.destination));
+        committed_[best] += call.groupSize;
+    }
+
+    return best;
+}
+
+void ElevatorDestinationDispatcher::boarded(size_t car, size_t floor)
+{
+    if (pickups_[car] & bit(floor))
+    {
+        dropoffs_[car] |= pickupDestinations_[car][floor];
+        pickupDestinations_[car][floor] = 0;
+        pickups_[car] &= ~bit(floor);
+    }
+}
+
+void ElevatorDestinationDispatcher::alighted(size_t car, size_t floor, size_t passengers)
+{
+    dropoffs_[car] &= ~bit(floor);
+    committed_[car] = (committed_[car] > passengers) ? (committed_[car] - passengers) : 0;
+}
+
+size_t ElevatorDestinationDispatcher::stopList(
+        size_t car,
+        size_t fromFloor,
+        int direction,
+        size_t *stops,
+        size_t maxStops) const
+{
+    uint64_t stopping = pickups_[car] | dropoffs_[car];
+    size_t   count    = 0;
+
+    // First sweep ahead, including the floor the car is at; then back the
+    // other way starting one floor behind it.
+    for (int sweep = 0; sweep < 2; ++sweep)
+    {
+        int floor = static_cast<int>(fromFloor) + sweep * direction;
+
+        for ( ; (floor >= ElevatorFsm::GROUND_FLOOR) && (floor <= MAX_FLOORS); floor += direction)
+        {
+            if ((stopping & bit(floor)) && (count < maxStops))
+            {
+                stops[count++] = floor;
+            }
+        }
+
+        direction = -direction;
+    }
+
+    return count;
+}
+
+double ElevatorDestinationDispatcher::energyWh(
+        size_t car,
+        size_t carFloor,
+        size_t origin,
+        size_t destination,
+        size_t groupSize) const
+{
+    // The load is what's committed, whether it's boarded yet or not.
+    size_t load = committed_[car];
+
+    return energyModel_->runWh(carFloor, origin, load) +
+           energyModel_->runWh(origin, destination, load + groupSize) -
+           energyModel_->runWh(origin, destination, load);
+}
+
+uint64_t ElevatorDestinationDispatcher::destinations(size_t car) const
+{
+    uint64_t all = dropoffs_[car];
+
+    for (size_t floor = ElevatorFsm::GROUND_FLOOR; floor <= MAX_FLOORS; ++floor)
+    {
+        if (pickups_[car] & bit(floor))
+        {
+            all |= pickupDestinations_[car][floor];
+        }
+    }
+
+    return all;
+}
@@ -0,0 +1,124 @@
+// Destination dispatcher: assigns destination calls from lobby keypads to the
+// cars of a bank, grouping passengers travelling to the same floors into the
+// same car, and produces each car's ordered stop list for its ElevatorFsm.
+//
+// Target-agnostic and allocation-free: all bookkeeping is in fixed-size
+// tables of floor bitmasks, so it can run on the bank controller as well as
+// in the simulator.
+//
+#ifndef ELEVATOR_DISPATCH_HPP
+#define ELEVATOR_DISPATCH_HPP
+
+#include "elevator-drive-model.hpp"
+#include "elevator-energy-model.hpp"
+#include "elevator-fsm.hpp"
+
+#include <cstdint>
+
+// A call entered at a destination keypad.
+struct ElevatorDestinationCall
+{
+    size_t origin;
+    size_t destination;
+    size_t groupSize;   // Passengers travelling together.
+};
+
+class ElevatorDestinationDispatcher
+{
+public:
+    ElevatorDestinationDispatcher(size_t cars, size_t capacity);
+
+    enum Limits
+    {
+        MAX_CARS   = 16,
+        MAX_FLOORS = 63,    // Floors are bits 1..63 of a mask.
+        NO_CAR     = MAX_CARS,
+    };
+
+    enum Costs
+    {
+        // A door cycle with transfers is worth several floors of travel.
+        STOP_COST_MSEC    = 9000,
+        FLOOR_TRAVEL_MSEC = 1500,   // Without a drive model.
+    };
+
+    // Estimate travel to the origin with the drive model instead of a flat
+    // time per floor.
+    void setDriveModel(const ElevatorDriveModel *model) { driveModel_ = model; }
+
+    // Trade wait for energy: add the energy the car would spend on the call,
+    // at msecPerWh of delay per watt-hour, to its cost. A car whose run would
+    // regenerate costs less. A car the model can't price, at or for a floor
+    // it has no elevation for, costs its time alone.
+    void setEnergyModel(const ElevatorEnergyModel *model, size_t msecPerWh)
+    {
+        energyModel_ = model;
+        msecPerWh_   = msecPerWh;
+    }
+
+    // Limit a car to the floors it can reach, e.g. one of two cars sharing a
+    // shaft. A car that can't reach the ground floor serves the lobby from
+    // its lowest floor, the upper level of a two-level lobby.
+    void setReach(size_t car, size_t lowest, size_t highest);
+
+    bool isReachable(size_t car, size_t floor) const
+    {
+        return (floor >= lowest_[car]) && (floor <= highest_[car]);
+    }
+
+    // The floor the car takes a call at or to: the floor itself, or the
+    // car's lobby level for the ground floor.
+    size_t servedFloor(size_t car, size_t floor) const
+    {
+        return (floor == ElevatorFsm::GROUND_FLOOR) ? lowest_[car] : floor;
+    }
+
+    // Assign a call to the car that can take the whole group with the least
+    // delay from added stops, weighted by the passengers they delay, plus
+    // travel to the origin and any energy cost, among the cars that reach
+    // both its floors. The call is assigned at the car's served floors.
+    // Returns NO_CAR if no car has room; the caller should retry after
+    // passengers alight. Also NO_CAR, for good, if either floor is outside
+    // GROUND_FLOOR..MAX_FLOORS.
+    size_t assign(const ElevatorDestinationCall &call, const size_t *carFloors);
+
+    // The car opened at a floor: passengers assigned to it there are aboard,
+    // and the given number for that floor are off.
+    void boarded(size_t car, size_t floor);
+    void alighted(size_t car, size_t floor, size_t passengers);
+
+    // Write the car's stops in sweep order starting from the floor in the
+    // direction of travel (+1 up, -1 down), reversing once. Returns the
+    // number of stops written, at most maxStops.
+    size_t stopList(size_t car, size_t fromFloor, int direction,
+                    size_t *stops, size_t maxStops) const;
+
+    bool   hasStops(size_t car) const { return (pickups_[car] | dropoffs_[car]) != 0; }
+    size_t committed(size_t car) const { return committed_[car]; }
+
+private:
+    static uint64_t bit(size_t floor) { return uint64_t(1) << floor; }
+
+    // Destinations of everyone assigned to the car, aboard or not.
+    uint64_t destinations(size_t car) const;
+
+    // Watt-hours to run to the origin with the car's load, and the change in
+    // the run to the destination from adding the group to it.
+    double energyWh(size_t car, size_t carFloor, size_t origin, size_t destination,
+                    size_t groupSize) const;
+
+    size_t cars_;
+    size_t capacity_;
+    const ElevatorDriveModel *driveModel_;
+    const ElevatorEnergyModel *energyModel_;
+    size_t                     msecPerWh_;
+
+    uint64_t pickups_[MAX_CARS];    // Origins not yet visited.
+    uint64_t dropoffs_[MAX_CARS];   // Destinations of passengers aboard.
+    uint64_t pickupDestinations_[MAX_CARS][MAX_FLOORS + 1];
+    size_t   committed_[MAX_CARS];  // Passengers assigned, aboard or not.
+    size_t   lowest_[MAX_CARS];     // Reach.
+    size_t   highest_[MAX_CARS];
+};
+
+#endif // ELEVATOR_DISPATCH_HPP
@@ -0,0 +1,97 @@
+// Elevator drive model: closed-form jerk-limited travel times.
+//
+#include "elevator-drive-model.hpp"
+#include "elevator-fsm.hpp"
+
+#include <cmath>
+
+//---------- Class ElevatorDriveModel Implementation --------------------------
+
+ElevatorDriveModel::ElevatorDriveModel(
+        const ElevatorDriveProfile &profile,
+        const double *elevations,
+        size_t floors)
+        : base_(ElevatorFsm::GROUND_FLOOR)
+        , floors_((floors < MAX_FLOORS) ? floors : MAX_FLOORS)
+{
+    build(profile, elevations);
+}
+
+ElevatorDriveModel::ElevatorDriveModel(
+        const ElevatorDriveProfile &profile,
+        double floorHeight,
+        size_t floors)
+        : base_(ElevatorFsm::GROUND_FLOOR)
+        , floors_((floors < MAX_FLOORS) ? floors : MAX_FLOORS)
+{
+    double elevations[MAX_FLOORS];
+
+    for (size_t floor = 0; floor < floors_; ++floor)
+    {
+        elevations[floor] = floor * floorHeight;
+    }
+    build(profile, elevations);
+}
+
+double ElevatorDriveModel::travelSec(const ElevatorDriveProfile &profile, double meters)
+{
+    const double v = profile.speed;
+    const double a = profile.accel;
+    const double j = profile.jerk;
+
+    if (meters <= 0.0)
+    {
+        return 0.0;
+    }
+
+    // Time and distance to accelerate from rest to a peak speed, with jerk-
+    // limited ramps. Maximum acceleration is only reached if the peak speed
+    // is at least a^2/j; otherwise the profile is two jerk ramps.
+    const double fullAccelSpeed = a * a / j;
+    double accelSec;
+    double accelMeters;
+
+    if (v >= fullAccelSpeed)
+    {
+        accelSec    = v / a + a / j;
+        accelMeters = v * accelSec / 2.0;
+    }
+    else
+    {
+        accelSec    = 2.0 * std::sqrt(v / j);
+        accelMeters = v * accelSec / 2.0;
+    }
+
+    // Long trip: accelerate to rated speed, cruise, decelerate.
+    if (meters >= 2.0 * accelMeters)
+    {
+        return meters / v + accelSec;
+    }
+
+    // Short trip: rated speed is never reached. Accelerating to peak speed
+    // p covers half the distance, d/2 = p * t(p) / 2.
+    double peak = (-a / j + std::sqrt(a * a / (j * j) + 4.0 * meters / a)) * a / 2.0;
+
+    if (peak >= fullAccelSpeed)
+    {
+        return 2.0 * (peak / a + a / j);
+    }
+
+    // Too short to reach maximum acceleration: d = 2 p sqrt(p/j).
+    return 4.0 * std::cbrt(meters / (2.0 * j));
+}
+
+void ElevatorDriveModel::build(const ElevatorDriveProfile &profile, const double *elevations)
+{
+    for (size_t high = 1; high < floors_; ++high)
+    {
+        for (size_t low = 0; low < high; ++low)
+        {
+            double sec   = travelSec(profile, std::fabs(elevations[high] - elevations[low]));
+            double ticks = std::ceil(sec * 1000.0 / TICK_MSEC);
+
+            times_[index(low, high)] = (ticks < UINT16_MAX) ? static_cast<uint16_t>(ticks)
+                                                            : UINT16_MAX;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+// Elevator drive model: floor-to-floor travel times from the drive's
+// jerk-limited trapezoidal velocity profile, for dispatching decisions and
+// per-trip move timeouts.
+//
+// Travel time for a distance is computed in closed form. Times for every
+// floor pair are precomputed at construction into a compact triangular
+// table, so each ETA query is a single table read with no floating point.
+//
+#ifndef ELEVATOR_DRIVE_MODEL_HPP
+#define ELEVATOR_DRIVE_MODEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Drive ratings. Acceleration and deceleration are symmetric.
+struct ElevatorDriveProfile
+{
+    double speed;   // Rated speed, m/s.
+    double accel;   // Maximum acceleration, m/s^2.
+    double jerk;    // Maximum jerk, m/s^3.
+};
+
+class ElevatorDriveModel
+{
+public:
+    // Floor elevations in meters, starting with the ground floor.
+    ElevatorDriveModel(
+        const ElevatorDriveProfile &profile,
+        const double *elevations,
+        size_t floors);
+
+    // All floors the same height.
+    ElevatorDriveModel(
+        const ElevatorDriveProfile &profile,
+        double floorHeight,
+        size_t floors);
+
+    enum Limits
+    {
+        MAX_FLOORS = 64,
+        TICK_MSEC  = 10,    // Table resolution; 16 bits covers 655 s.
+    };
+
+    enum Timeouts
+    {
+        // Allowance over the profile time for start delays, leveling, and
+        // a drive running below rated speed.
+        TIMEOUT_PERCENT     = 150,
+        TIMEOUT_MARGIN_MSEC = 5000,
+    };
+
+    // Seconds to travel a distance from rest to rest.
+    static double travelSec(const ElevatorDriveProfile &profile, double meters);
+
+    // Is the floor one the model has an elevation for?
+    bool hasFloor(size_t floor) const
+    {
+        return (floor >= base_) && (floor - base_ < floors_);
+    }
+
+    // Milliseconds from rest at one floor to rest at another. Both floors
+    // must be in the model; see hasFloor().
+    size_t travelMsec(size_t fromFloor, size_t toFloor) const
+    {
+        if (fromFloor == toFloor)
+        {
+            return 0;
+        }
+        if (fromFloor > toFloor)
+        {
+            size_t swap = fromFloor;
+            fromFloor   = toFloor;
+            toFloor     = swap;
+        }
+        return times_[index(fromFloor - base_, toFloor - base_)] * TICK_MSEC;
+    }
+
+    // How long a trip may take before the drive is considered faulted.
+    size_t moveTimeoutMsec(size_t fromFloor, size_t toFloor) const
+    {
+        return timeoutMsec(travelMsec(fromFloor, toFloor));
+    }
+
+    // The same allowance over any expected travel time.
+    static size_t timeoutMsec(size_t travel)
+    {
+        return travel * TIMEOUT_PERCENT / 100 + TIMEOUT_MARGIN_MSEC;
+    }
+
+    size_t floors() const { return floors_; }
+
+private:
+    // Upper triangle, row-major by the higher floor: pairs (i, j), i < j.
+    static size_t index(size_t low, size_t high) { return high * (high - 1) / 2 + low; }
+
+    void build(const ElevatorDriveProfile &profile, const double *elevations);
+
+    size_t   base_;     // Floor number of the first elevation.
+    size_t   floors_;
+    uint16_t times_[MAX_FLOORS * (MAX_FLOORS - 1) / 2];
+};
+
+#endif // ELEVATOR_DRIVE_MODEL_HPP
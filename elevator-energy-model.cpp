@@ -0,0 +1,70 @@
+// Elevator energy model: mains energy per run for a counterweighted traction
+// drive, with or without regeneration.
+//
+#include "elevator-energy-model.hpp"
+#include "elevator-fsm.hpp"
+
+#include <cmath>
+
+namespace
+{
+    const double GRAVITY       = 9.81;      // m/s^2
+    const double JOULES_PER_WH = 3600.0;
+}
+
+//---------- Class ElevatorEnergyModel Implementation -------------------------
+
+ElevatorEnergyModel::ElevatorEnergyModel(
+        const ElevatorEnergyProfile &profile,
+        const double *elevations,
+        size_t floors)
+        : profile_(profile)
+        , base_(ElevatorFsm::GROUND_FLOOR)
+        , floors_((floors < MAX_FLOORS) ? floors : MAX_FLOORS)
+{
+    build(elevations);
+}
+
+ElevatorEnergyModel::ElevatorEnergyModel(
+        const ElevatorEnergyProfile &profile,
+        double floorHeight,
+        size_t floors)
+        : profile_(profile)
+        , base_(ElevatorFsm::GROUND_FLOOR)
+        , floors_((floors < MAX_FLOORS) ? floors : MAX_FLOORS)
+{
+    double elevations[MAX_FLOORS];
+
+    for (size_t floor = 0; floor < floors_; ++floor)
+    {
+        elevations[floor] = floor * floorHeight;
+    }
+    build(elevations);
+}
+
+double ElevatorEnergyModel::runWh(size_t fromFloor, size_t toFloor, size_t passengers) const
+{
+    if (fromFloor == toFloor)
+    {
+        return 0.0;
+    }
+
+    double rise = elevations_[toFloor - base_] - elevations_[fromFloor - base_];
+
+    // The car and counterweight cancel but for the load over the balance.
+    double imbalanceKg = passengers * profile_.passengerKg -
+                         profile_.ratedLoadKg * profile_.balancePercent / 100.0;
+    double sheaveJ     = imbalanceKg * GRAVITY * rise + profile_.frictionN * std::fabs(rise);
+    double mainsJ      = (sheaveJ >= 0.0) ? (sheaveJ * 100.0 / profile_.motorPercent)
+                                          : (sheaveJ * profile_.regenPercent / 100.0);
+
+    return profile_.runWh + mainsJ / JOULES_PER_WH;
+}
+
+void ElevatorEnergyModel::build(const double *elevations)
+{
+    for (size_t floor = 0; floor < floors_; ++floor)
+    {
+        elevations_[floor] = elevations[floor];
+    }
+}
@@ -0,0 +1,74 @@
+// Elevator energy model: the energy a traction drive takes from, or returns
+// to, the mains for a run between floors, for dispatching decisions and for
+// accounting.
+//
+// The counterweight balances the car plus a share of its rated load, so the
+// drive lifts or lowers only the imbalance: a light car going up, or a heavy
+// car going down, is pulled by gravity, and a regenerative drive returns that
+// energy less its losses. A drive without regeneration burns it in a braking
+// resistor. Friction in the guides and ropes, and a fixed cost per run for
+// accelerating the rotating masses and lifting the brake, are always paid.
+//
+#ifndef ELEVATOR_ENERGY_MODEL_HPP
+#define ELEVATOR_ENERGY_MODEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Installation ratings.
+struct ElevatorEnergyProfile
+{
+    double ratedLoadKg;     // Load at rated capacity.
+    double balancePercent;  // Of rated load the counterweight balances.
+    double passengerKg;     // Average passenger.
+    double frictionN;       // Guide and rope friction, N.
+    double runWh;           // Fixed cost per run, Wh.
+    double motorPercent;    // Efficiency, mains to sheave, when motoring.
+    double regenPercent;    // Efficiency, sheave to mains, when regenerating;
+                            // 0 without a regenerative drive.
+};
+
+class ElevatorEnergyModel
+{
+public:
+    // Floor elevations in meters, starting with the ground floor.
+    ElevatorEnergyModel(
+        const ElevatorEnergyProfile &profile,
+        const double *elevations,
+        size_t floors);
+
+    // All floors the same height.
+    ElevatorEnergyModel(
+        const ElevatorEnergyProfile &profile,
+        double floorHeight,
+        size_t floors);
+
+    enum Limits
+    {
+        MAX_FLOORS = 64,
+    };
+
+    // Is the floor one the model has an elevation for?
+    bool hasFloor(size_t floor) const
+    {
+        return (floor >= base_) && (floor - base_ < floors_);
+    }
+
+    // Watt-hours from the mains for a run from rest at one floor to rest at
+    // another with passengers aboard; negative if the run returns more to the
+    // mains than it takes. Both floors must be in the model; see hasFloor().
+    double runWh(size_t fromFloor, size_t toFloor, size_t passengers) const;
+
+    const ElevatorEnergyProfile &profile() const { return profile_; }
+    size_t floors() const { return floors_; }
+
+private:
+    void build(const double *elevations);
+
+    ElevatorEnergyProfile profile_;
+    size_t base_;       // Floor number of the first elevation.
+    size_t floors_;
+    double elevations_[MAX_FLOORS];
+};
+
+#endif // ELEVATOR_ENERGY_MODEL_HPP
@@ -0,0 +1,1001 @@
+// Elevator FSM generator: reads the declarative model in elevator-fsm.model
+// and generates ElevatorFsm's state ids and both of its engines, so the
+// model is the single source of truth for the FSM's states and transitions:
+// - elevator-fsm-ids.gen.hpp: the StateId enum, included in the public
+//   section of class ElevatorFsm;
+// - elevator-fsm-states.gen.hpp: the declarations of the model's actions and
+//   decisions, and of each engine, included in the private section;
+// - elevator-fsm-states.gen.cpp: the definitions, included at the end of
+//   elevator-fsm.cpp;
+// - elevator-fsm-coverage.gen.cpp: a transition coverage test skeleton, with
+//   a skipped test per transition, built as runTestsCoverage.
+//
+// The State pattern engine has a singleton State subclass per state with a
+// virtual handler per event. The switch engine keeps the current StateId and
+// has a function per event switching on it. Defining ELEVATOR_FSM_SWITCH
+// selects the switch engine.
+//
+// Usage: elevatorFsmGen MODEL OUTDIR
+//
+// Files are only rewritten when their contents change, so an edit to a
+// comment in the model doesn't rebuild the FSM.
+//
+#include <cctype>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char *const DONE = "done";        // A transitory state's way out.
+const char *const ANY  = "*";           // Every state.
+const char *const NONE = "none";        // A decision may stay put.
+
+struct ModelState
+{
+    std::string name;
+    std::string entry;                  // Entry action, if any.
+    bool        transitory;
+};
+
+struct ModelTransition
+{
+    enum Kind
+    {
+        TO,                             // Enters target.
+        DECIDE,                         // Decision enters one of targets.
+        ACCEPT,                         // No state change.
+    };
+
+    int                      line;
+    std::string              state;
+    std::string              event;
+    Kind                     kind;
+    std::string              action;    // Run first, if any.
+    std::string              decision;
+    std::vector<std::string> targets;
+};
+
+struct Model
+{
+    std::vector<std::string>     events;
+    std::vector<ModelState>      states;
+    std::string                  initial;
+    std::vector<ModelTransition> transitions;
+
+    const ModelState *findState(const std::string &name) const
+    {
+        for (const ModelState &state : states)
+        {
+            if (state.name == name)
+            {
+                return &state;
+            }
+        }
+        return nullptr;
+    }
+
+    bool hasEvent(const std::string &name) const
+    {
+        for (const std::string &event : events)
+        {
+            if (event == name)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The transition state makes on event, its own or every state's.
+    const ModelTransition *find(const std::string &state, const std::string &event) const
+    {
+        const ModelTransition *any = nullptr;
+
+        for (const ModelTransition &transition : transitions)
+        {
+            if (transition.event != event)
+            {
+                continue;
+            }
+            if (transition.state == state)
+            {
+                return &transition;
+            }
+            if (transition.state == ANY)
+            {
+                any = &transition;
+            }
+        }
+        return any;
+    }
+
+    const ModelTransition *findAny(const std::string &event) const
+    {
+        return find(ANY, event);
+    }
+};
+
+//---------- Parsing ----------------------------------------------------------
+
+class Parser
+{
+public:
+    Parser(const char *path, Model &model)
+        : path_(path)
+        , model_(model)
+        , errors_(0)
+        {}
+
+    bool parse();
+
+private:
+    void error(int line, const std::string &message)
+    {
+        fprintf(stderr, "%s:%d: %s\n", path_, line, message.c_str());
+        ++errors_;
+    }
+
+    void parseLine(int line, const std::vector<std::string> &words);
+    void parseTransition(int line, const std::vector<std::string> &words);
+    void check();
+    void checkTarget(int line, const std::string &target);
+    void addFunction(int line, const std::string &name, const char *kind);
+
+    static bool isName(const std::string &word);
+
+    const char *path_;
+    Model      &model_;
+    int         errors_;
+    std::map<std::string, std::string> functions_;  // Name to "action" or "decision".
+};
+
+bool Parser::isName(const std::string &word)
+{
+    if (word.empty() || !isalpha(static_cast<unsigned char>(word[0])))
+    {
+        return false;
+    }
+    for (char c : word)
+    {
+        if (!isalnum(static_cast<unsigned char>(c)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Parser::parse()
+{
+    std::ifstream file(path_);
+    std::string   text;
+    int           line = 0;
+
+    if (!file)
+    {
+        fprintf(stderr, "elevatorFsmGen: can't open %s\n", path_);
+        return false;
+    }
+
+    while (std::getline(file, text))
+    {
+        std::vector<std::string> words;
+        std::istringstream       stream(text.substr(0, text.find('#')));
+        std::string              word;
+
+        ++line;
+        while (stream >> word)
+        {
+            words.push_back(word);
+        }
+        if (!words.empty())
+        {
+            parseLine(line, words);
+        }
+    }
+
+    check();
+    return errors_ == 0;
+}
+
+void Parser::parseLine(int line, const std::vector<std::string> &words)
+{
+    if (words[0] == "event")
+    {
+        if ((words.size() != 2) || !isName(words[1]))
+        {
+            error(line, "expected: event NAME");
+        }
+        else if (model_.hasEvent(words[1]) || (words[1] == DONE))
+        {
+            error(line, "event " + words[1] + " already defined");
+        }
+        else
+        {
+            model_.events.push_back(words[1]);
+        }
+    }
+    else if (words[0] == "state")
+    {
+        ModelState state = { (words.size() > 1) ? words[1] : "", "", false };
+        size_t     word  = 2;
+
+        if (!isName(state.name) || (state.name == NONE))
+        {
+            error(line, "expected: state NAME [entry ACTION] [transitory]");
+            return;
+        }
+        if (model_.findState(state.name))
+        {
+            error(line, "state " + state.name + " already defined");
+            return;
+        }
+        if ((word + 1 < words.size()) && (words[word] == "entry") && isName(words[word + 1]))
+        {
+            state.entry = words[word + 1];
+            addFunction(line, state.entry, "action");
+            word += 2;
+        }
+        if ((word < words.size()) && (words[word] == "transitory"))
+        {
+            state.transitory = true;
+            ++word;
+        }
+        if (word != words.size())
+        {
+            error(line, "expected: state NAME [entry ACTION] [transitory]");
+            return;
+        }
+        model_.states.push_back(state);
+    }
+    else if (words[0] == "initial")
+    {
+        if (words.size() != 2)
+        {
+            error(line, "expected: initial NAME");
+        }
+        else if (!model_.initial.empty())
+        {
+            error(line, "initial state already given");
+        }
+        else
+        {
+            model_.initial = words[1];
+        }
+    }
+    else
+    {
+        parseTransition(line, words);
+    }
+}
+
+void Parser::parseTransition(int line, const std::vector<std::string> &words)
+{
+    ModelTransition transition;
+    size_t          word = 4;
+
+    transition.line  = line;
+    transition.state = words[0];
+    transition.event = (words.size() > 1) ? words[1] : "";
+    transition.kind  = ModelTransition::TO;
+
+    if ((words.size() < 4) || (words[2] != "->"))
+    {
+        error(line, "expected: STATE EVENT -> TARGET | decide DECISION : TARGET... | accept");
+        return;
+    }
+
+    if (words[3] == "accept")
+    {
+        transition.kind = ModelTransition::ACCEPT;
+    }
+    else if (words[3] == "decide")
+    {
+        transition.kind = ModelTransition::DECIDE;
+        if ((words.size() < 7) || !isName(words[4]) || (words[5] != ":"))
+        {
+            error(line, "expected: STATE EVENT -> decide DECISION : TARGET...");
+            return;
+        }
+        transition.decision = words[4];
+        for (word = 6; (word < words.size()) && (words[word] != "do"); ++word)
+        {
+            transition.targets.push_back(words[word]);
+        }
+    }
+    else
+    {
+        transition.targets.push_back(words[3]);
+    }
+
+    if (word < words.size())
+    {
+        if ((transition.kind == ModelTransition::ACCEPT) || (words[word] != "do") ||
+            (word + 2 != words.size()) || !isName(words[word + 1]))
+        {
+            error(line, "expected: ... [do ACTION] at end of transition");
+            return;
+        }
+        transition.action = words[word + 1];
+    }
+
+    if (!transition.action.empty())
+    {
+        addFunction(line, transition.action, "action");
+    }
+    if (!transition.decision.empty())
+    {
+        addFunction(line, transition.decision, "decision");
+    }
+    model_.transitions.push_back(transition);
+}
+
+void Parser::addFunction(int line, const std::string &name, const char *kind)
+{
+    auto function = functions_.insert(std::make_pair(name, kind));
+
+    if (function.first->second != kind)
+    {
+        error(line, name + " is both an action and a decision");
+    }
+}
+
+void Parser::checkTarget(int line, const std::string &target)
+{
+    if (!model_.findState(target))
+    {
+        error(line, "unknown state " + target);
+    }
+}
+
+void Parser::check()
+{
+    std::set<std::pair<std::string, std::string>> defined;
+
+    if (model_.states.empty() || model_.events.empty())
+    {
+        error(0, "the model needs states and events");
+        return;
+    }
+
+    const ModelState *initial = model_.findState(model_.initial);
+    if (!initial)
+    {
+        error(0, "no initial state, or unknown initial state " + model_.initial);
+    }
+    else if (initial->transitory)
+    {
+        error(0, "the initial state can't be transitory");
+    }
+
+    for (const ModelTransition &transition : model_.transitions)
+    {
+        const ModelState *state = model_.findState(transition.state);
+
+        if (!state && (transition.state != ANY))
+        {
+            error(transition.line, "unknown state " + transition.state);
+        }
+        if (transition.event == DONE)
+        {
+            if (!state || !state->transitory)
+            {
+                error(transition.line, "only a transitory state has a done transition");
+            }
+            if (transition.kind == ModelTransition::ACCEPT)
+            {
+                error(transition.line, "a transitory state must leave when done");
+            }
+        }
+        else if (!model_.hasEvent(transition.event))
+        {
+            error(transition.line, "unknown event " + transition.event);
+        }
+        if (!defined.insert(std::make_pair(transition.state, transition.event)).second)
+        {
+            error(transition.line, transition.state + " already has a transition on " + transition.event);
+        }
+
+        for (const std::string &target : transition.targets)
+        {
+            if ((transition.kind != ModelTransition::DECIDE) || (target != NONE))
+            {
+                checkTarget(transition.line, target);
+            }
+        }
+    }
+
+    for (const ModelState &state : model_.states)
+    {
+        if (state.transitory && !defined.count(std::make_pair(state.name, std::string(DONE))))
+        {
+            error(0, "transitory state " + state.name + " has no done transition");
+        }
+    }
+
+    for (const auto &function : functions_)
+    {
+        if (model_.findState(function.first) || model_.hasEvent(function.first))
+        {
+            error(0, function.first + " names a state or event as well as a function");
+        }
+    }
+}
+
+//---------- Generation -------------------------------------------------------
+
+const char *const HEADER =
+    "// Generated by elevatorFsmGen from elevator-fsm.model; do not edit.\n"
+    "//\n";
+
+// CamelCase to UPPER_SNAKE, e.g. OutOfService to OUT_OF_SERVICE.
+std::string constant(const std::string &name)
+{
+    std::string text;
+
+    for (size_t c = 0; c < name.size(); ++c)
+    {
+        if ((c > 0) && isupper(static_cast<unsigned char>(name[c])) &&
+            !isupper(static_cast<unsigned char>(name[c - 1])))
+        {
+            text += '_';
+        }
+        text += static_cast<char>(toupper(static_cast<unsigned char>(name[c])));
+    }
+    return text;
+}
+
+std::string stateId(const std::string &state)
+{
+    return "STATE_" + constant(state);
+}
+
+std::string divider(const std::string &title)
+{
+    std::string text = "//---------- " + title + " ";
+
+    while (text.size() < 79)
+    {
+        text += '-';
+    }
+    return text + "\n";
+}
+
+// The statements making a transition, each indented and prefixed by self, the
+// object the FSM's members are called on.
+std::string transitionBody(const ModelTransition &transition, const std::string &self,
+                           const std::string &indent)
+{
+    std::string text;
+
+    if (!transition.action.empty())
+    {
+        text += indent + self + transition.action + "();\n";
+    }
+    switch (transition.kind)
+    {
+    case ModelTransition::TO:
+        text += indent + "return " + self + "changeState(" + stateId(transition.targets[0]) + ");\n";
+        break;
+
+    case ModelTransition::DECIDE:
+        text += indent + "return " + self + transition.decision + "();\n";
+        break;
+
+    case ModelTransition::ACCEPT:
+        text += indent + "return true;\n";
+        break;
+    }
+    return text;
+}
+
+// The statements entering a state: its entry action, then for a transitory
+// state its way out.
+std::string entryBody(const Model &model, const ModelState &state, const std::string &self,
+                      const std::string &indent)
+{
+    std::string text;
+
+    if (!state.entry.empty())
+    {
+        text += indent + self + state.entry + "();\n";
+    }
+    if (state.transitory)
+    {
+        return text + transitionBody(*model.find(state.name, DONE), self, indent);
+    }
+    return text + indent + "return true;\n";
+}
+
+std::string describe(const ModelTransition &transition, const std::string &state)
+{
+    std::string text = state + " --" + transition.event + "--> ";
+
+    switch (transition.kind)
+    {
+    case ModelTransition::TO:
+        text += transition.targets[0];
+        break;
+
+    case ModelTransition::DECIDE:
+        for (size_t target = 0; target < transition.targets.size(); ++target)
+        {
+            text += (target ? " | " : "") + transition.targets[target];
+        }
+        text += ", decided by " + transition.decision;
+        break;
+
+    case ModelTransition::ACCEPT:
+        text += state + ", accepted";
+        break;
+    }
+    if (!transition.action.empty())
+    {
+        text += ", doing " + transition.action;
+    }
+    return text;
+}
+
+std::string generateIds(const Model &model)
+{
+    std::ostringstream text;
+
+    text << HEADER
+         << "// ElevatorFsm's state ids, included in the public section of the class.\n"
+         << "//\n"
+         << "    // State ids, in model order; values are persisted in snapshots.\n"
+         << "    enum StateId\n"
+         << "    {\n";
+    for (const ModelState &state : model.states)
+    {
+        text << "        " << stateId(state.name) << ",\n";
+    }
+    text << "    };\n"
+         << "\n"
+         << "    enum StateIds\n"
+         << "    {\n"
+         << "        STATE_IDS = " << model.states.size() << ",\n"
+         << "    };\n";
+    return text.str();
+}
+
+std::string generateDeclarations(const Model &model)
+{
+    std::ostringstream    text;
+    std::set<std::string> actions;
+    std::set<std::string> decisions;
+
+    for (const ModelState &state : model.states)
+    {
+        if (!state.entry.empty())
+        {
+            actions.insert(state.entry);
+        }
+    }
+    for (const ModelTransition &transition : model.transitions)
+    {
+        if (!transition.action.empty())
+        {
+            actions.insert(transition.action);
+        }
+        if (!transition.decision.empty())
+        {
+            decisions.insert(transition.decision);
+        }
+    }
+
+    text << HEADER
+         << "// ElevatorFsm's engines, included in the private section of the class.\n"
+         << "//\n"
+         << "    // Actions and decisions named in the model, written in elevator-fsm.cpp\n"
+         << "    // and shared by both engines. A decision changes state itself.\n";
+    for (const std::string &action : actions)
+    {
+        text << "    void " << action << "();\n";
+    }
+    text << "\n";
+    for (const std::string &decision : decisions)
+    {
+        text << "    bool " << decision << "();\n";
+    }
+    text << "\n"
+         << "    // Make state current and run its entry action, then leave it if it's\n"
+         << "    // transitory.\n"
+         << "    bool enterState(StateId state);\n"
+         << "\n"
+         << "    // Make state current without running its entry action.\n"
+         << "    void setState(StateId state);\n"
+         << "\n"
+         << "#ifndef ELEVATOR_FSM_SWITCH\n"
+         << "    // State pattern engine: a singleton State subclass per state, with a\n"
+         << "    // handler per event that makes the state's transition.\n"
+         << "    class State\n"
+         << "    {\n"
+         << "    public:\n";
+    for (const std::string &event : model.events)
+    {
+        if (model.findAny(event))
+        {
+            text << "        // Every state.\n"
+                 << "        virtual bool on" << event << "(ElevatorFsm *fsm);\n";
+        }
+        else
+        {
+            text << "        virtual bool on" << event << "(ElevatorFsm *fsm) { return false; }\n";
+        }
+    }
+    text << "\n"
+         << "        virtual StateId id() const = 0;\n"
+         << "        virtual bool enter(ElevatorFsm *fsm) = 0;\n"
+         << "    };\n";
+
+    for (const ModelState &state : model.states)
+    {
+        text << "\n"
+             << "    class " << state.name << "\n"
+             << "        : public State\n"
+             << "    {\n"
+             << "    public:\n"
+             << "        static " << state.name << " *instance()\n"
+             << "        {\n"
+             << "            static " << state.name << " me;\n"
+             << "            return &me;\n"
+             << "        }\n"
+             << "\n"
+             << "        virtual StateId id() const { return " << stateId(state.name) << "; }\n"
+             << "\n";
+        if (state.transitory)
+        {
+            text << "        // Leaves on completion, so no need for additional events.\n";
+        }
+        text << "        virtual bool enter(ElevatorFsm *fsm);\n";
+        for (const ModelTransition &transition : model.transitions)
+        {
+            if ((transition.state != state.name) || (transition.event == DONE))
+            {
+                continue;
+            }
+            if (transition.kind == ModelTransition::ACCEPT)
+            {
+                text << "        virtual bool on" << transition.event << "(ElevatorFsm *fsm) { return true; }\n";
+            }
+            else
+            {
+                text << "        virtual bool on" << transition.event << "(ElevatorFsm *fsm);\n";
+            }
+        }
+        text << "    };\n";
+    }
+
+    text << "\n"
+         << "    State *state_ = " << model.initial << "::instance();\n"
+         << "\n"
+         << "    StateId currentState() const { return state_->id(); }\n"
+         << "\n";
+    for (const std::string &event : model.events)
+    {
+        text << "    bool fire" << event << "() { return state_->on" << event << "(this); }\n";
+    }
+    text << "#else\n"
+         << "    // Switch engine: the current state's id, and a function per event\n"
+         << "    // switching on it.\n"
+         << "    StateId state_ = " << stateId(model.initial) << ";\n"
+         << "\n"
+         << "    StateId currentState() const { return state_; }\n"
+         << "\n";
+    for (const std::string &event : model.events)
+    {
+        text << "    bool fire" << event << "();\n";
+    }
+    text << "#endif\n";
+    return text.str();
+}
+
+std::string generateStatePattern(const Model &model)
+{
+    std::ostringstream text;
+
+    text << divider("State Pattern Engine")
+         << "\n"
+         << "bool ElevatorFsm::enterState(StateId state)\n"
+         << "{\n"
+         << "    setState(state);\n"
+         << "    return state_->enter(this);\n"
+         << "}\n"
+         << "\n"
+         << "void ElevatorFsm::setState(StateId state)\n"
+         << "{\n"
+         << "    static State *const states[STATE_IDS] =\n"
+         << "    {\n";
+    for (const ModelState &state : model.states)
+    {
+        text << "        " << state.name << "::instance(),\n";
+    }
+    text << "    };\n"
+         << "\n"
+         << "    state_ = states[state];\n"
+         << "}\n";
+
+    for (const std::string &event : model.events)
+    {
+        const ModelTransition *any = model.findAny(event);
+
+        if (any)
+        {
+            text << "\n"
+                 << "bool ElevatorFsm::State::on" << event << "(ElevatorFsm *fsm)\n"
+                 << "{\n"
+                 << transitionBody(*any, "fsm->", "    ")
+                 << "}\n";
+        }
+    }
+
+    for (const ModelState &state : model.states)
+    {
+        text << "\n"
+             << divider("Class ElevatorFsm::" + state.name + " Implementation")
+             << "\n"
+             << "bool ElevatorFsm::" << state.name << "::enter(ElevatorFsm *fsm)\n"
+             << "{\n"
+             << entryBody(model, state, "fsm->", "    ")
+             << "}\n";
+
+        for (const ModelTransition &transition : model.transitions)
+        {
+            if ((transition.state != state.name) || (transition.event == DONE) ||
+                (transition.kind == ModelTransition::ACCEPT))
+            {
+                continue;
+            }
+            text << "\n"
+                 << "bool ElevatorFsm::" << state.name << "::on" << transition.event << "(ElevatorFsm *fsm)\n"
+                 << "{\n"
+                 << transitionBody(transition, "fsm->", "    ")
+                 << "}\n";
+        }
+    }
+    return text.str();
+}
+
+// Cases of a switch on the current state, with states that share a body
+// sharing it, in model order of the first of them.
+std::string generateCases(const std::vector<std::pair<std::string, std::string>> &cases)
+{
+    std::vector<std::string>                        bodies;
+    std::map<std::string, std::vector<std::string>> labels;
+    std::string                                     text;
+
+    for (const auto &state : cases)
+    {
+        if (!labels.count(state.second))
+        {
+            bodies.push_back(state.second);
+        }
+        labels[state.second].push_back(state.first);
+    }
+    for (size_t body = 0; body < bodies.size(); ++body)
+    {
+        text += body ? "\n" : "";
+        for (const std::string &label : labels[bodies[body]])
+        {
+            text += "    case " + stateId(label) + ":\n";
+        }
+        text += bodies[body];
+    }
+    return text;
+}
+
+std::string generateSwitch(const Model &model)
+{
+    std::ostringstream                               text;
+    std::vector<std::pair<std::string, std::string>> entries;
+
+    for (const ModelState &state : model.states)
+    {
+        entries.push_back(std::make_pair(state.name, entryBody(model, state, "", "        ")));
+    }
+
+    text << divider("Switch Engine")
+         << "\n"
+         << "bool ElevatorFsm::enterState(StateId state)\n"
+         << "{\n"
+         << "    state_ = state;\n"
+         << "\n"
+         << "    switch (state)\n"
+         << "    {\n"
+         << generateCases(entries)
+         << "    }\n"
+         << "    return false;\n"
+         << "}\n"
+         << "\n"
+         << "void ElevatorFsm::setState(StateId state)\n"
+         << "{\n"
+         << "    state_ = state;\n"
+         << "}\n";
+
+    for (const std::string &event : model.events)
+    {
+        const ModelTransition                           *any = model.findAny(event);
+        std::vector<std::pair<std::string, std::string>> cases;
+
+        for (const ModelTransition &transition : model.transitions)
+        {
+            if ((transition.event == event) && (transition.state != ANY))
+            {
+                cases.push_back(std::make_pair(transition.state, transitionBody(transition, "", "        ")));
+            }
+        }
+
+        text << "\n"
+             << "bool ElevatorFsm::fire" << event << "()\n"
+             << "{\n";
+        if (cases.empty())
+        {
+            text << (any ? transitionBody(*any, "", "    ") : "    return false;\n");
+        }
+        else
+        {
+            text << "    switch (state_)\n"
+                 << "    {\n"
+                 << generateCases(cases)
+                 << "\n"
+                 << "    default:\n"
+                 << (any ? transitionBody(*any, "", "        ") : "        return false;\n")
+                 << "    }\n";
+        }
+        text << "}\n";
+    }
+    return text.str();
+}
+
+std::string generateDefinitions(const Model &model)
+{
+    std::ostringstream text;
+
+    text << HEADER
+         << "// ElevatorFsm's engines, included at the end of elevator-fsm.cpp.\n"
+         << "//\n"
+         << "const char *ElevatorFsm::stateName(StateId state)\n"
+         << "{\n"
+         << "    static const char *const names[STATE_IDS] =\n"
+         << "    {\n";
+    for (const ModelState &state : model.states)
+    {
+        text << "        \"" << state.name << "\",\n";
+    }
+    text << "    };\n"
+         << "\n"
+         << "    return (static_cast<size_t>(state) < STATE_IDS) ? names[state] : \"?\";\n"
+         << "}\n"
+         << "\n"
+         << "#ifndef ELEVATOR_FSM_SWITCH\n"
+         << "\n"
+         << generateStatePattern(model)
+         << "\n"
+         << "#else\n"
+         << "\n"
+         << generateSwitch(model)
+         << "\n"
+         << "#endif // ELEVATOR_FSM_SWITCH\n";
+    return text.str();
+}
+
+void generateTest(std::ostringstream &text, const ModelTransition &transition,
+                  const std::string &state, const std::string &outcome)
+{
+    std::string when = (transition.event == DONE) ? "Entered" : transition.event;
+
+    text << "\n"
+         << "// " << describe(transition, state) << "\n"
+         << "TEST(Transition_" << state << ", Should_" << outcome << "_When_" << when << ")\n"
+         << "{\n"
+         << "    GTEST_SKIP() << \"not covered yet\";\n"
+         << "}\n";
+}
+
+std::string generateCoverage(const Model &model)
+{
+    std::ostringstream text;
+
+    text << HEADER
+         << "// Transition coverage skeleton: a skipped test per transition in the model,\n"
+         << "// and per way out of a decision, built as runTestsCoverage so the list\n"
+         << "// of transitions left to cover follows the model. Write a test under a\n"
+         << "// Given_ fixture in tests.cpp that drives the FSM into the state, and\n"
+         << "// fill it in.\n"
+         << "//\n"
+         << "#include <gtest/gtest.h>\n";
+
+    for (const ModelState &state : model.states)
+    {
+        text << "\n"
+             << divider("Transition_" + state.name);
+
+        for (const std::string &event : model.events)
+        {
+            const ModelTransition *transition = model.find(state.name, event);
+
+            if (transition)
+            {
+                if (transition->kind == ModelTransition::ACCEPT)
+                {
+                    generateTest(text, *transition, state.name, "Stay" + state.name);
+                }
+                for (const std::string &target : transition->targets)
+                {
+                    generateTest(text, *transition, state.name,
+                                 (target == NONE) ? "Stay" + state.name : "Enter" + target);
+                }
+            }
+        }
+        if (state.transitory)
+        {
+            const ModelTransition *done = model.find(state.name, DONE);
+
+            for (const std::string &target : done->targets)
+            {
+                generateTest(text, *done, state.name, "Enter" + target);
+            }
+        }
+    }
+    return text.str();
+}
+
+// Write the file unless it already holds the text.
+bool update(const std::string &path, const std::string &text)
+{
+    std::ifstream     existing(path, std::ios::binary);
+    std::stringstream contents;
+
+    if (existing)
+    {
+        contents << existing.rdbuf();
+        if (contents.str() == text)
+        {
+            return true;
+        }
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+    file.close();
+    if (!file)
+    {
+        fprintf(stderr, "elevatorFsmGen: can't write %s\n", path.c_str());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Model model;
+
+    if (argc != 3)
+    {
+        fprintf(stderr, "usage: elevatorFsmGen MODEL OUTDIR\n");
+        return 2;
+    }
+
+    Parser parser(argv[1], model);
+    if (!parser.parse())
+    {
+        return 1;
+    }
+
+    std::string directory = std::string(argv[2]) + "/";
+    bool        written   = update(directory + "elevator-fsm-ids.gen.hpp", generateIds(model)) &&
+                            update(directory + "elevator-fsm-states.gen.hpp", generateDeclarations(model)) &&
+                            update(directory + "elevator-fsm-states.gen.cpp", generateDefinitions(model)) &&
+                            update(directory + "elevator-fsm-coverage.gen.cpp", generateCoverage(model));
+
+    return written ? 0 : 1;
+}
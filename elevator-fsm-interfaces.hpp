@@ -15,7 +15,14 @@ class ElevatorUiClient
 public:
     ElevatorUiClient() {}
 
+    // Car call: floor requested from the car panel, always served.
     virtual bool handleFloorRequest(size_t floor) = 0;
+    // Hall call: floor requested from a landing panel, may be skipped when
+    // the car is full.
+    virtual bool handleHallCall(size_t floor) = 0;
+    // Destination dispatch: ordered stops for the car, replacing any not yet
+    // started.
+    virtual bool handleStopList(const size_t *floors, size_t count) = 0;
     virtual bool handleOpenButton() = 0;
     virtual bool handleCloseButton() = 0;
     virtual bool handleStopButton() = 0;
@@ -41,6 +48,8 @@ public:
 
     virtual bool handleArrived() = 0;
     virtual bool handleDriveFault() = 0;
+    // Load weighing: car load as a percentage of rated load.
+    virtual bool handleLoad(size_t percent) = 0;
 };
 
 //---------- Elevator Timer Events --------------------------------------------
@@ -73,6 +82,8 @@ public:
     virtual void outOfService() = 0;
     virtual void alarmOn() = 0;
     virtual void alarmOff() = 0;
+    // Hand a skipped hall call back to the dispatcher for reassignment.
+    virtual void hallCallSkipped(size_t floor) = 0;
 
 protected:
     ElevatorUiClient *client_;
@@ -141,6 +152,8 @@ public:
     // Stopping the timer when it is already stopped is a no-op.
     virtual void start(size_t msec) = 0;
     virtual void stop() = 0;
+    // Monotonic time, used to measure how long actions take.
+    virtual size_t nowMsec() const = 0;
 
 protected:
     ElevatorTimerClient *client_;
@@ -1,8 +1,17 @@
-// Elevator FSM: An example FSM using the State pattern.
+// Elevator FSM: An example FSM using the State pattern. The actions and
+// decisions named in elevator-fsm.model are defined here; the engines that
+// call them are generated from the model.
 //
 // Author: Steve Branam, sdbranam@gmail.com, December, 2021
 //
 #include "elevator-fsm.hpp"
+#include "elevator-drive-model.hpp"
+#include "elevator-metrics.hpp"
+#include "elevator-shaft.hpp"
+#include "elevator-snapshot.hpp"
+
+static_assert(static_cast<size_t>(ElevatorSnapshot::MAX_STOPS) >= ElevatorFsm::MAX_STOPS,
+              "snapshot must hold the whole stop list");
 
 //---------- Class ElevatorFsm Implementation ---------------------------------
 
@@ -15,9 +24,32 @@ ElevatorFsm::ElevatorFsm(
         , door_(door)
         , drive_(drive)
         , timer_(timer)
-        , state_(ElevatorFsm::Stopped::instance())
+        , driveModel_(nullptr)
+        , actionStartMsec_(0)
+        , moveFloors_(0)
+        , timerDeadlineMsec_(0)
+        , coalesceTimers_(false)
+        , timerSlackMsec_(0)
+        , timerArmed_(false)
+        , armedDeadlineMsec_(0)
+        , snapshotSlot_(nullptr)
+        , snapshotSequence_(0)
+        , recovery_(nullptr)
+        , resumeDwellMsec_(0)
+        , transitionObserver_(nullptr)
+        , metrics_(nullptr)
+        , metricsCar_(0)
+        , shaft_(nullptr)
+        , shaftCar_(0)
+        , shaftHeld_(false)
+        , shaftHeldMsec_(0)
         , currentFloor_(GROUND_FLOOR)
         , destinationFloor_(GROUND_FLOOR)
+        , hallCallFloor_(GROUND_FLOOR)
+        , stopCount_(0)
+        , nextStop_(0)
+        , loadPercent_(0)
+        , fullLoadPercent_(FULL_LOAD_PERCENT)
 {
     ui_.init(this);
     door_.init(this);
@@ -28,221 +60,580 @@ ElevatorFsm::ElevatorFsm(
     ui_.inService();
 }
 
-bool ElevatorFsm::isInService() const
+ElevatorFsm::ElevatorFsm(
+        ElevatorUiApi          &ui,
+        ElevatorDoorApi        &door,
+        ElevatorDriveApi       &drive,
+        ElevatorTimerApi       &timer,
+        const ElevatorSnapshot *snapshot)
+        : ElevatorFsm(ui, door, drive, timer)
 {
-    return state_ != ElevatorFsm::OutOfService::instance();
+    recover(snapshot);
 }
 
-bool ElevatorFsm::isIdle() const
+bool ElevatorFsm::handleStopList(const size_t *floors, size_t count)
 {
-    return state_ == ElevatorFsm::Stopped::instance();
+    // The state acts on the new list, so it goes in first; a state that
+    // rejects it gets the old list back.
+    size_t previousStops[MAX_STOPS];
+    size_t previousCount = stopCount_;
+    size_t previousNext  = nextStop_;
+
+    for (size_t stop = 0; stop < previousCount; ++stop)
+    {
+        previousStops[stop] = stops_[stop];
+    }
+
+    stopCount_ = (count < MAX_STOPS) ? count : MAX_STOPS;
+    nextStop_  = 0;
+    for (size_t stop = 0; stop < stopCount_; ++stop)
+    {
+        stops_[stop] = floors[stop];
+    }
+
+    uint32_t sequence = snapshotSequence_;
+
+    if (onStopList())
+    {
+        // Accepted without a transition, the slot still holds the old list.
+        if (snapshotSequence_ == sequence)
+        {
+            saveSnapshot();
+        }
+        return true;
+    }
+
+    stopCount_ = previousCount;
+    nextStop_  = previousNext;
+    for (size_t stop = 0; stop < stopCount_; ++stop)
+    {
+        stops_[stop] = previousStops[stop];
+    }
+    return false;
 }
 
-bool ElevatorFsm::isWaiting() const
+const char *ElevatorFsm::eventName(EventId event)
 {
-    return state_ == ElevatorFsm::Waiting::instance();
+    static const char *const names[EVENT_IDS] =
+    {
+        "FloorRequest",
+        "HallCall",
+        "StopList",
+        "OpenButton",
+        "CloseButton",
+        "StopButton",
+        "RestoreService",
+        "DoorsOpened",
+        "DoorsClosed",
+        "DoorFault",
+        "Arrived",
+        "DriveFault",
+        "Timer",
+    };
+
+    return (static_cast<size_t>(event) < EVENT_IDS) ? names[event] : "?";
 }
 
-//---------- Class ElevatorFsm::State Implementation --------------------------
+bool ElevatorFsm::isInService() const
+{
+    return currentState() != STATE_OUT_OF_SERVICE;
+}
 
-bool ElevatorFsm::State::changeState(ElevatorFsm *fsm, State *newState)
+bool ElevatorFsm::isIdle() const
 {
-    fsm->state_ = newState;
-    return fsm->state_->enter(fsm);
+    return currentState() == STATE_STOPPED;
 }
 
-//---------- Class ElevatorFsm::Stopped Implementation ------------------------
+bool ElevatorFsm::isWaiting() const
+{
+    return currentState() == STATE_WAITING;
+}
 
-bool ElevatorFsm::Stopped::enter(ElevatorFsm *fsm)
+bool ElevatorFsm::isFull() const
 {
-    return true;
+    return loadPercent_ >= fullLoadPercent_;
 }
 
-bool ElevatorFsm::Stopped::onFloorRequest(ElevatorFsm *fsm)
+void ElevatorFsm::setSnapshotSlot(ElevatorSnapshotSlot *slot)
 {
-    bool result = false;
+    const ElevatorSnapshot *latest = slot ? slot->latest() : nullptr;
 
-    if (fsm->currentFloor_ == fsm->destinationFloor_)
+    // Carry on from the slot's sequence so the new write is the newer copy.
+    snapshotSlot_     = slot;
+    snapshotSequence_ = latest ? latest->sequence : 0;
+    saveSnapshot();
+}
+
+bool ElevatorFsm::setShaft(ElevatorShaft *shaft, size_t car)
+{
+    if (shaft_)
     {
-        result = changeState(fsm, Opening::instance());
+        shaft_->leave(shaftCar_);
     }
-    else
+
+    shaft_     = shaft;
+    shaftCar_  = car;
+    shaftHeld_ = false;
+    return !shaft_ || shaft_->park(shaftCar_, currentFloor_);
+}
+
+void ElevatorFsm::snapshot(ElevatorSnapshot &image) const
+{
+    size_t now = timer_.nowMsec();
+
+    image.timerRemainingMsec = static_cast<uint32_t>(
+        (timerDeadlineMsec_ > now) ? (timerDeadlineMsec_ - now) : 0);
+    image.currentFloor       = static_cast<uint16_t>(currentFloor_);
+    image.destinationFloor   = static_cast<uint16_t>(destinationFloor_);
+    image.state              = static_cast<uint8_t>(currentState());
+    image.stopCount          = static_cast<uint8_t>(stopCount_);
+    image.nextStop           = static_cast<uint8_t>(nextStop_);
+    for (size_t stop = 0; stop < ElevatorSnapshot::MAX_STOPS; ++stop)
     {
-        result = changeState(fsm, Moving::instance());
+        image.stops[stop] = (stop < stopCount_) ? static_cast<uint16_t>(stops_[stop]) : 0;
     }
+}
 
+bool ElevatorFsm::recover(const ElevatorSnapshot *snapshot)
+{
+    // Whatever timer was running is not to be relied on.
+    timerArmed_ = false;
+
+    recovery_ = snapshot;
+    bool result = onRecover();
+    recovery_ = nullptr;
     return result;
 }
 
-bool ElevatorFsm::Stopped::onOpenButton(ElevatorFsm *fsm)
+size_t ElevatorFsm::startTimer(size_t msec)
 {
-    return changeState(fsm, Opening::instance());
-}
+    size_t now = timer_.nowMsec();
 
-//---------- Class ElevatorFsm::Moving Implementation ------------------------
+    timerDeadlineMsec_ = now + msec;
 
-bool ElevatorFsm::Moving::enter(ElevatorFsm *fsm)
+    if (coalesceTimers_)
+    {
+        // A running timer that expires no later than the deadline, or later
+        // by no more than the slack, does: a later deadline is re-armed on
+        // its expiry.
+        if (timerArmed_ && (armedDeadlineMsec_ <= timerDeadlineMsec_ + timerSlackMsec_))
+        {
+            return now;
+        }
+        timerArmed_        = true;
+        armedDeadlineMsec_ = timerDeadlineMsec_;
+    }
+
+    timer_.start(msec);
+    return now;
+}
+
+bool ElevatorFsm::isTimerDue()
 {
-    fsm->drive_.goToFloor(fsm->destinationFloor_);
-    fsm->timer_.start(TIMEOUT_MOVE_TO_FLOOR_MSEC);
-    return true;
+    size_t now = timer_.nowMsec();
+
+    timerArmed_ = false;
+    if (timerDeadlineMsec_ <= now + timerSlackMsec_)
+    {
+        return true;
+    }
+
+    timerArmed_        = true;
+    armedDeadlineMsec_ = timerDeadlineMsec_;
+    timer_.start(timerDeadlineMsec_ - now);
+    return false;
 }
 
-bool ElevatorFsm::Moving::onArrived(ElevatorFsm *fsm)
+void ElevatorFsm::countEvent(StateId state, EventId event, bool handled)
 {
-    return changeState(fsm, Opening::instance());
+    metrics_->event(metricsCar_, state, event, handled);
 }
 
-bool ElevatorFsm::Moving::onStopButton(ElevatorFsm *fsm)
+void ElevatorFsm::saveSnapshot()
 {
-    return changeState(fsm, Holding::instance());
+    ElevatorSnapshot image;
+
+    if (snapshotSlot_)
+    {
+        snapshot(image);
+        image.seal(++snapshotSequence_);
+        snapshotSlot_->write(image);
+    }
 }
 
-bool ElevatorFsm::Moving::onFault(ElevatorFsm *fsm)
+bool ElevatorFsm::changeState(StateId newState)
 {
-    return changeState(fsm, OutOfService::instance());
+    if (transitionObserver_)
+    {
+        transitionObserver_->onTransition(currentState(), newState, currentFloor_, timer_.nowMsec());
+    }
+    if (metrics_)
+    {
+        metrics_->transition(metricsCar_, currentState(), newState);
+    }
+
+    bool result = enterState(newState);
+
+    // Nested changes write first, so the final state is the last written.
+    saveSnapshot();
+    return result;
 }
 
-bool ElevatorFsm::Moving::onTimer(ElevatorFsm *fsm)
+bool ElevatorFsm::changeToNextStop()
 {
-    return changeState(fsm, OutOfService::instance());
+    // A stop at the floor just served is redundant; the dispatcher may not
+    // have known the car was already there.
+    while (hasPendingStops() && (stops_[nextStop_] == currentFloor_))
+    {
+        ++nextStop_;
+    }
+
+    if (!hasPendingStops())
+    {
+        return changeState(STATE_STOPPED);
+    }
+
+    destinationFloor_ = stops_[nextStop_++];
+    return changeState(STATE_MOVING);
 }
 
-//---------- Class ElevatorFsm::Holding Implementation ------------------------
+//---------- Stopped Decisions ------------------------------------------------
 
-bool ElevatorFsm::Holding::enter(ElevatorFsm *fsm)
+bool ElevatorFsm::goToDestination()
 {
-    fsm->drive_.stop();
-    fsm->ui_.alarmOn();
-    return true;
+    if (currentFloor_ == destinationFloor_)
+    {
+        return changeState(STATE_OPENING);
+    }
+    return changeState(STATE_MOVING);
 }
 
-bool ElevatorFsm::Holding::onStopButton(ElevatorFsm *fsm)
+bool ElevatorFsm::answerHallCall()
 {
-    return changeState(fsm, Resuming::instance());
-}
+    // A full car can't take on anyone at the landing, so don't spend a door
+    // cycle stopping there. Hand the call back so another car can serve it.
+    if (isFull())
+    {
+        ui_.hallCallSkipped(hallCallFloor_);
+        return true;
+    }
 
-//---------- Class ElevatorFsm::Resuming Implementation ------------------------
+    destinationFloor_ = hallCallFloor_;
+    return goToDestination();
+}
 
-bool ElevatorFsm::Resuming::enter(ElevatorFsm *fsm)
+bool ElevatorFsm::startStopList()
 {
-    fsm->drive_.start();
-    fsm->ui_.alarmOff();
-    return true;
+    if (!hasPendingStops())
+    {
+        return true;
+    }
+
+    // The first stop may be right here.
+    destinationFloor_ = stops_[nextStop_++];
+    return goToDestination();
 }
 
-//---------- Class ElevatorFsm::Opening Implementation ------------------------
+//---------- Moving Actions and Decisions -------------------------------------
 
-bool ElevatorFsm::Opening::enter(ElevatorFsm *fsm)
+void ElevatorFsm::startTrip()
 {
-    fsm->ui_.arrived(fsm->destinationFloor_);
-    fsm->door_.open();
-    fsm->timer_.start(TIMEOUT_DOOR_OPEN_MSEC);
-    return true;
+    size_t timeout = TIMEOUT_MOVE_TO_FLOOR_MSEC;
+
+    if (shaft_ && !reserveShaft())
+    {
+        // The other car is in the way: stay put, without commanding the
+        // drive, and try again shortly.
+        size_t now = startTimer(TIMER_SHAFT_RETRY_MSEC);
+
+        if (!shaftHeld_)
+        {
+            shaftHeld_     = true;
+            shaftHeldMsec_ = now;
+        }
+        return;
+    }
+    shaftHeld_ = false;
+
+    moveFloors_ = (destinationFloor_ > currentFloor_)
+        ? (destinationFloor_ - currentFloor_)
+        : (currentFloor_ - destinationFloor_);
+
+    // A timeout derived from the trip catches a stalled drive on a short
+    // trip in seconds rather than a minute. Allow for a car that has been
+    // measured slower than its rated profile. A floor the model doesn't
+    // cover has only the learned time to go on, if any.
+    if (driveModel_)
+    {
+        size_t learned = timing_.travelMsec(moveFloors_);
+
+        if (driveModel_->hasFloor(currentFloor_) && driveModel_->hasFloor(destinationFloor_))
+        {
+            size_t travel = driveModel_->travelMsec(currentFloor_, destinationFloor_);
+
+            timeout = ElevatorDriveModel::timeoutMsec((learned > travel) ? learned : travel);
+        }
+        else if (timing_.travelSamples(moveFloors_))
+        {
+            timeout = ElevatorDriveModel::timeoutMsec(learned);
+        }
+    }
+
+    drive_.goToFloor(destinationFloor_);
+    actionStartMsec_ = startTimer(timeout);
 }
 
-bool ElevatorFsm::Opening::onDoorsOpened(ElevatorFsm *fsm)
+bool ElevatorFsm::retryTrip()
 {
-    return changeState(fsm, Waiting::instance());
+    // A car holding for the other car in its shaft tries again, for a while.
+    // Otherwise the drive didn't arrive in time.
+    if (shaftHeld_ && (timer_.nowMsec() - shaftHeldMsec_ < TIMEOUT_SHAFT_HOLD_MSEC))
+    {
+        return changeState(STATE_MOVING);
+    }
+    return changeState(STATE_OUT_OF_SERVICE);
 }
 
-bool ElevatorFsm::Opening::onFault(ElevatorFsm *fsm)
+void ElevatorFsm::recordArrival()
 {
-    return changeState(fsm, OutOfService::instance());
+    timing_.recordTravel(moveFloors_, timer_.nowMsec() - actionStartMsec_);
+    currentFloor_ = destinationFloor_;
+
+    if (shaft_)
+    {
+        shaft_->release(shaftCar_, currentFloor_);
+    }
 }
 
-bool ElevatorFsm::Opening::onTimer(ElevatorFsm *fsm)
+bool ElevatorFsm::reserveShaft()
 {
-    return changeState(fsm, OutOfService::instance());
-}
+    // Make way first if the other car is waiting for this one and the trip
+    // wouldn't, so a busy car can't keep it waiting indefinitely.
+    size_t yield  = shaft_->yieldFloor(shaftCar_);
+    bool   lower  = (shaftCar_ == ElevatorShaft::LOWER_CAR);
+    bool   detour = (yield != ElevatorShaft::NO_FLOOR) && (yield != currentFloor_) &&
+                    (lower ? (destinationFloor_ > yield) : (destinationFloor_ < yield));
+
+    if (detour && ((nextStop_ > 0) || (stopCount_ < MAX_STOPS)) &&
+        shaft_->reserve(shaftCar_, currentFloor_, yield))
+    {
+        pushStop(destinationFloor_);
+        destinationFloor_ = yield;
+        return true;
+    }
 
-//---------- Class ElevatorFsm::Waiting Implementation ------------------------
+    if (shaft_->reserve(shaftCar_, currentFloor_, destinationFloor_))
+    {
+        return true;
+    }
 
-bool ElevatorFsm::Waiting::enter(ElevatorFsm *fsm)
-{
-    fsm->timer_.start(TIMER_WAITING_MSEC);
-    return true;
+    // Reorder: go first to a later stop the other car isn't in the way of,
+    // then on to the destination.
+    for (size_t stop = nextStop_; stop < stopCount_; ++stop)
+    {
+        size_t floor = stops_[stop];
+
+        if (shaft_->reserve(shaftCar_, currentFloor_, floor))
+        {
+            for (size_t later = stop; later > nextStop_; --later)
+            {
+                stops_[later] = stops_[later - 1];
+            }
+            stops_[nextStop_] = destinationFloor_;
+            destinationFloor_ = floor;
+            return true;
+        }
+    }
+
+    // Ask for the destination once more, which also leaves it as what this
+    // car is waiting for.
+    return shaft_->reserve(shaftCar_, currentFloor_, destinationFloor_);
 }
 
-bool ElevatorFsm::Waiting::onOpenButton(ElevatorFsm *fsm)
+bool ElevatorFsm::pushStop(size_t floor)
 {
-    return changeState(fsm, Waiting::instance());
+    if (nextStop_ == 0)
+    {
+        if (stopCount_ >= MAX_STOPS)
+        {
+            return false;
+        }
+        for (size_t stop = stopCount_; stop > 0; --stop)
+        {
+            stops_[stop] = stops_[stop - 1];
+        }
+        ++stopCount_;
+        ++nextStop_;
+    }
+
+    stops_[--nextStop_] = floor;
+    return true;
 }
 
-bool ElevatorFsm::Waiting::onCloseButton(ElevatorFsm *fsm)
+//---------- Holding and Resuming Actions -------------------------------------
+
+void ElevatorFsm::holdCar()
 {
-    return changeState(fsm, Closing::instance());
+    // Not held for the shaft while stopped: a resumed trip waits anew.
+    shaftHeld_ = false;
+    drive_.stop();
+    ui_.alarmOn();
 }
 
-bool ElevatorFsm::Waiting::onTimer(ElevatorFsm *fsm)
+void ElevatorFsm::resumeCar()
 {
-    return changeState(fsm, Closing::instance());
+    drive_.start();
+    ui_.alarmOff();
 }
 
-//---------- Class ElevatorFsm::Closing Implementation ------------------------
+//---------- Opening, Waiting, and Closing Actions and Decisions --------------
 
-bool ElevatorFsm::Closing::enter(ElevatorFsm *fsm)
+void ElevatorFsm::openDoors()
 {
-    fsm->door_.close();
-    fsm->timer_.start(TIMEOUT_DOOR_CLOSE_MSEC);
-    return true;
+    ui_.arrived(destinationFloor_);
+    door_.open();
+    actionStartMsec_ = startTimer(TIMEOUT_DOOR_OPEN_MSEC);
 }
 
-bool ElevatorFsm::Closing::onDoorsClosed(ElevatorFsm *fsm)
+void ElevatorFsm::recordDoorOpen()
 {
-    return changeState(fsm, Stopped::instance());
+    timing_.recordDoor(ElevatorTimingCache::DOOR_OPEN, timer_.nowMsec() - actionStartMsec_);
 }
 
-bool ElevatorFsm::Closing::onFault(ElevatorFsm *fsm)
+void ElevatorFsm::startDwell()
 {
-    return changeState(fsm, OutOfService::instance());
+    size_t dwell = resumeDwellMsec_ ? resumeDwellMsec_ : TIMER_WAITING_MSEC;
+
+    resumeDwellMsec_ = 0;
+    startTimer(dwell);
 }
 
-bool ElevatorFsm::Closing::onTimer(ElevatorFsm *fsm)
+void ElevatorFsm::closeDoors()
 {
-    return changeState(fsm, OutOfService::instance());
+    door_.close();
+    actionStartMsec_ = startTimer(TIMEOUT_DOOR_CLOSE_MSEC);
 }
 
-//---------- Class ElevatorFsm::OutOfService Implementation -------------------
-
-bool ElevatorFsm::OutOfService::enter(ElevatorFsm *fsm)
+void ElevatorFsm::recordDoorClose()
 {
-    fsm->ui_.outOfService();
-    return true;
+    timing_.recordDoor(ElevatorTimingCache::DOOR_CLOSE, timer_.nowMsec() - actionStartMsec_);
 }
 
-bool ElevatorFsm::OutOfService::onRestoreService(ElevatorFsm *fsm)
+bool ElevatorFsm::goToNextStop()
 {
-    return changeState(fsm, Restoring::instance());
+    return changeToNextStop();
 }
 
-//---------- Class ElevatorFsm::Restoring Implementation -------------------
+//---------- OutOfService and Restoring Actions and Decisions -----------------
 
-bool ElevatorFsm::Restoring::enter(ElevatorFsm *fsm)
+void ElevatorFsm::takeOutOfService()
 {
-    bool result = false;
+    shaftHeld_ = false;
+    ui_.outOfService();
+}
 
+void ElevatorFsm::findCar()
+{
     // Don't make any assumptions about the elevator position when it was
     // manually returned to service. It could be at a floor or in between
-    // floors, at the ground or some other floor. If the elevator is safely
-    // at the ground floor, open the door. Otherwise, send it to the ground
-    // floor.
+    // floors, at the ground or some other floor.
 
-    fsm->currentFloor_     = fsm->drive_.getFloor();
-    fsm->destinationFloor_ = ElevatorFsm::GROUND_FLOOR;
+    currentFloor_     = drive_.getFloor();
+    destinationFloor_ = ElevatorFsm::GROUND_FLOOR;
+    stopCount_        = 0;
+    nextStop_         = 0;
 
-    fsm->ui_.inService();
+    // Keep the shaft clear where the car was found, if the other car isn't
+    // there; otherwise the car still holds its last reservation.
+    if (shaft_)
+    {
+        shaft_->park(shaftCar_, currentFloor_);
+    }
+
+    ui_.inService();
+}
 
-    if (fsm->drive_.isAtFloor() &&
-        (fsm->currentFloor_== fsm->destinationFloor_))
+bool ElevatorFsm::returnToGround()
+{
+    // If the elevator is safely at the ground floor, open the door.
+    // Otherwise, send it to the ground floor.
+    if (drive_.isAtFloor() && (currentFloor_ == destinationFloor_))
     {
-        result = changeState(fsm, Opening::instance());
+        return changeState(STATE_OPENING);
     }
-    else
+    return changeState(STATE_MOVING);
+}
+
+//---------- Recovering Decisions ---------------------------------------------
+
+bool ElevatorFsm::resumeFromSnapshot()
+{
+    const ElevatorSnapshot *snapshot = recovery_;
+
+    if (!snapshot || !snapshot->isValid())
     {
-        result = changeState(fsm, Moving::instance());
+        return changeState(STATE_RESTORING);
     }
 
-    return result;
+    // The snapshot is only trusted as far as the drive confirms it. If the
+    // car was stationary at a floor but isn't there now, it was moved while
+    // the controller was down; find it the same way as restoring service.
+    size_t floor          = drive_.getFloor();
+    bool   atSnapshotFloor = drive_.isAtFloor() && (floor == snapshot->currentFloor);
+
+    currentFloor_     = floor;
+    destinationFloor_ = snapshot->destinationFloor;
+    stopCount_        = snapshot->stopCount;
+    nextStop_         = snapshot->nextStop;
+    for (size_t stop = 0; stop < stopCount_; ++stop)
+    {
+        stops_[stop] = snapshot->stops[stop];
+    }
+
+    switch (snapshot->state)
+    {
+    case STATE_OUT_OF_SERVICE:
+        // A faulted car stays out of service until it is restored manually.
+        return changeState(STATE_OUT_OF_SERVICE);
+
+    case STATE_MOVING:
+    case STATE_RESUMING:
+        // Reissue the trip from wherever the car is now.
+        return changeState(STATE_MOVING);
+
+    case STATE_HOLDING:
+        return changeState(STATE_HOLDING);
+
+    default:
+        break;
+    }
+
+    if (!atSnapshotFloor)
+    {
+        return changeState(STATE_RESTORING);
+    }
+
+    switch (snapshot->state)
+    {
+    case STATE_STOPPED:
+        return changeState(STATE_STOPPED);
+
+    case STATE_OPENING:
+        return changeState(STATE_OPENING);
+
+    case STATE_WAITING:
+        // The doors are still open; finish the dwell rather than cycling
+        // them again.
+        resumeDwellMsec_ = snapshot->timerRemainingMsec;
+        return changeState(STATE_WAITING);
+
+    case STATE_CLOSING:
+        return changeState(STATE_CLOSING);
+
+    default:
+        return changeState(STATE_RESTORING);
+    }
 }
 
+// The State pattern classes or the switch engine, and state names.
+#include "elevator-fsm-states.gen.cpp"
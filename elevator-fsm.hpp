@@ -6,6 +6,10 @@
 // - xUML: Each state has only an entry function, performed whenever the state is entered,
 //   including transition-to-self.
 //
+// The states and transitions are declared in elevator-fsm.model, from which
+// the build generates the State pattern classes and an equivalent flat switch
+// engine. Define ELEVATOR_FSM_SWITCH to build the FSM on the switch engine.
+//
 // References:
 // [1] "Design Patterns: Elements of Reusable Object-Oriented Software",
 //     by Erich Gamma, Richard Helm, Ralph Johnson, and John Vlissides.
@@ -22,6 +26,14 @@
 #define ELEVATOR_FSM_HPP
 
 #include "elevator-fsm-interfaces.hpp"
+#include "elevator-timing-cache.hpp"
+
+class ElevatorDriveModel;
+class ElevatorMetrics;
+class ElevatorShaft;
+class ElevatorTransitionObserver;
+struct ElevatorSnapshot;
+struct ElevatorSnapshotSlot;
 
 class ElevatorFsm
     : ElevatorUiClient
@@ -36,17 +48,69 @@ public:
         ElevatorDriveApi &drive,
         ElevatorTimerApi &timer);
 
+    // Warm restart: resume from a snapshot written before the controller
+    // restarted, if it is valid and the drive confirms the car is where the
+    // snapshot says. Otherwise, or with no snapshot, take the same path as
+    // restoring service: find the car and return it to the ground floor.
+    ElevatorFsm(
+        ElevatorUiApi          &ui,
+        ElevatorDoorApi        &door,
+        ElevatorDriveApi       &drive,
+        ElevatorTimerApi       &timer,
+        const ElevatorSnapshot *snapshot);
+
     enum Floors
     {
         GROUND_FLOOR = 1,
     };
 
+    enum Stops
+    {
+        MAX_STOPS = 16,
+    };
+
+    enum Load
+    {
+        FULL_LOAD_PERCENT = 80,
+    };
+
+#include "elevator-fsm-ids.gen.hpp"
+
+    // Events dispatched to the current state, as counted in metrics.
+    enum EventId
+    {
+        EVENT_FLOOR_REQUEST,
+        EVENT_HALL_CALL,
+        EVENT_STOP_LIST,
+        EVENT_OPEN_BUTTON,
+        EVENT_CLOSE_BUTTON,
+        EVENT_STOP_BUTTON,
+        EVENT_RESTORE_SERVICE,
+        EVENT_DOORS_OPENED,
+        EVENT_DOORS_CLOSED,
+        EVENT_DOOR_FAULT,
+        EVENT_ARRIVED,
+        EVENT_DRIVE_FAULT,
+        EVENT_TIMER,
+    };
+
+    enum EventIds
+    {
+        EVENT_IDS = EVENT_TIMER + 1,
+    };
+
+    // Names for logs and metrics, e.g. "OutOfService", "DoorFault".
+    static const char *stateName(StateId state);
+    static const char *eventName(EventId event);
+
     enum Timers
     {
         TIMEOUT_DOOR_OPEN_MSEC     =  5000,
         TIMEOUT_DOOR_CLOSE_MSEC    =  7000,
         TIMEOUT_MOVE_TO_FLOOR_MSEC = 60000,
         TIMER_WAITING_MSEC         = 10000,
+        TIMER_SHAFT_RETRY_MSEC     =   500,
+        TIMEOUT_SHAFT_HOLD_MSEC    = 60000,
     };
 
     // Client interface event handlers: store event parameters and forward to FSM event handlers.
@@ -55,6 +119,12 @@ public:
         destinationFloor_ = floor;
         return onFloorRequest();
     }
+    virtual bool handleHallCall(size_t floor)
+    {
+        hallCallFloor_ = floor;
+        return onHallCall();
+    }
+    virtual bool handleStopList(const size_t *floors, size_t count);
     virtual bool handleOpenButton()                 { return onOpenButton(); }
     virtual bool handleCloseButton()                { return onCloseButton(); }
     virtual bool handleStopButton()                 { return onStopButton(); }
@@ -62,12 +132,22 @@ public:
 
     virtual bool handleOpened()                     { return onDoorsOpened(); }
     virtual bool handleClosed()                     { return onDoorsClosed(); }
-    virtual bool handleDoorFault()                  { return onFault(); }
+    virtual bool handleDoorFault()                  { return onFault(EVENT_DOOR_FAULT); }
 
     virtual bool handleArrived()                    { return onArrived(); }
-    virtual bool handleDriveFault()                 { return onFault(); }
+    virtual bool handleDriveFault()                 { return onFault(EVENT_DRIVE_FAULT); }
+    virtual bool handleLoad(size_t percent)
+    {
+        loadPercent_ = percent;
+        return true;
+    }
 
-    virtual bool handleExpired()                    { return onTimer(); }
+    virtual bool handleExpired()
+    {
+        // A coalesced timer may expire before the deadline the FSM wants;
+        // it's re-armed rather than reaching the current state.
+        return (coalesceTimers_ && !isTimerDue()) ? true : onTimer();
+    }
 
     // Is the elevator functioning?
     bool isInService() const;
@@ -78,179 +158,142 @@ public:
     // Is the elevator waiting at a floor with doors opened?
     bool isWaiting() const;
 
-private:
-    class State
-    {
-    public:
-        virtual bool onFloorRequest(ElevatorFsm *fsm) { return false; }
-        virtual bool onDoorsOpened(ElevatorFsm *fsm) { return false; }
-        virtual bool onDoorsClosed(ElevatorFsm *fsm) { return false; }
-        virtual bool onOpenButton(ElevatorFsm *fsm) { return false; }
-        virtual bool onCloseButton(ElevatorFsm *fsm) { return false; }
-        virtual bool onStopButton(ElevatorFsm *fsm) { return false; }
-        virtual bool onRestoreService(ElevatorFsm *fsm) { return false; }
-        virtual bool onFault(ElevatorFsm *fsm) { return false; }
-        virtual bool onArrived(ElevatorFsm *fsm) { return false; }
-        virtual bool onTimer(ElevatorFsm *fsm) { return false; }
-
-    protected:
-        bool changeState(ElevatorFsm *fsm, State *newState);
-
-    private:
-        virtual bool enter(ElevatorFsm *fsm) { return false; }
-    };
+    // Are there stops left on the stop list?
+    bool hasPendingStops() const { return nextStop_ < stopCount_; }
 
-    class Stopped
-        : public State
-    {
-    public:
-        static Stopped *instance()
-        {
-            static Stopped me;
-            return &me;
-        }
+    // Current state, as recorded in snapshots.
+    StateId stateId() const { return currentState(); }
 
-        virtual bool enter(ElevatorFsm *fsm);
-        virtual bool onFloorRequest(ElevatorFsm *fsm);
-        virtual bool onOpenButton(ElevatorFsm *fsm);
-    };
+    // Is the car loaded at or above the threshold for skipping hall calls?
+    bool isFull() const;
 
-    class Moving
-        : public State
+    // Load at or above which hall calls are skipped; above 100 never skips.
+    void setFullLoadThreshold(size_t percent) { fullLoadPercent_ = percent; }
+
+    // Coalesce timer requests: track the deadline the FSM wants, and only
+    // restart the timer when that deadline is sooner than the running timer's
+    // by more than the slack. A later deadline is re-armed lazily when the
+    // running timer expires, and an expiry within the slack of the deadline
+    // counts as the deadline. With no slack, the FSM sees the same expiries
+    // at the same times as without coalescing, for fewer timer starts. A
+    // standby's shadow FSM must use the same setting as its primary.
+    void setTimerCoalescing(bool coalesce, size_t slackMsec = 0)
     {
-    public:
-        static Moving *instance()
-        {
-            static Moving me;
-            return &me;
-        }
+        // Turned on, the timer isn't known to be running until it's started.
+        timerArmed_     = timerArmed_ && coalesceTimers_ && coalesce;
+        coalesceTimers_ = coalesce;
+        timerSlackMsec_ = slackMsec;
+    }
 
-        virtual bool enter(ElevatorFsm *fsm);
-        virtual bool onArrived(ElevatorFsm *fsm);
-        virtual bool onStopButton(ElevatorFsm *fsm);
-        virtual bool onFault(ElevatorFsm *fsm);
-        virtual bool onTimer(ElevatorFsm *fsm);
-    };
+    // Derive each trip's move timeout from the drive model instead of
+    // TIMEOUT_MOVE_TO_FLOOR_MSEC. Null restores the flat timeout.
+    void setDriveModel(const ElevatorDriveModel *model) { driveModel_ = model; }
 
-    class Holding
-        : public State
-    {
-    public:
-        static Holding *instance()
-        {
-            static Holding me;
-            return &me;
-        }
+    // Travel and door times learned from this car's completion events. Load
+    // a saved table at startup to start from what was learned before.
+    const ElevatorTimingCache &timing() const { return timing_; }
+    ElevatorTimingCache &timing() { return timing_; }
 
-        virtual bool enter(ElevatorFsm *fsm);
-        virtual bool onStopButton(ElevatorFsm *fsm);
-    };
+    // Write a snapshot into the slot on every state change, starting now.
+    // Null stops writing.
+    void setSnapshotSlot(ElevatorSnapshotSlot *slot);
 
-    class Resuming
-        : public State
+    // Report every state change to the observer, e.g. a transition log.
+    // Null stops reporting.
+    void setTransitionObserver(ElevatorTransitionObserver *observer) { transitionObserver_ = observer; }
+
+    // Count this car's transitions and dispatched events in the registry.
+    // Null stops counting.
+    void setMetrics(ElevatorMetrics *metrics, size_t car)
     {
-    public:
-        static Resuming *instance()
-        {
-            static Resuming me;
-            return &me;
-        }
+        metrics_    = metrics;
+        metricsCar_ = car;
+    }
 
-        // Immediately advances state on completion, so no need for additional events.
-        virtual bool enter(ElevatorFsm *fsm);
-    };
+    // Share a shaft with another car, as ElevatorShaft::LOWER_CAR or
+    // UPPER_CAR: reserve the floors each trip sweeps before moving. If the
+    // other car is waiting for this one, first stop where it's out of its
+    // way. If the other car is in the way, take a later stop on the stop list
+    // that it isn't in the way of; or else hold at the floor, trying again
+    // every TIMER_SHAFT_RETRY_MSEC, and give up out of service after
+    // TIMEOUT_SHAFT_HOLD_MSEC. The car is parked in the shaft at its current
+    // floor; returns false if that's too close to the other car. Null
+    // leaves the shaft.
+    bool setShaft(ElevatorShaft *shaft, size_t car);
 
-    class Opening
-        : public State
-    {
-    public:
-        static Opening *instance()
-        {
-            static Opening me;
-            return &me;
-        }
+    // Is the car holding at a floor for the other car in its shaft?
+    bool isHeldForShaft() const { return shaftHeld_; }
 
-        virtual bool enter(ElevatorFsm *fsm);
-        virtual bool onDoorsOpened(ElevatorFsm *fsm);
-        virtual bool onFault(ElevatorFsm *fsm);
-        virtual bool onTimer(ElevatorFsm *fsm);
-    };
+    // Fill in the snapshot fields for the current state, unsealed.
+    void snapshot(ElevatorSnapshot &image) const;
 
-    class Waiting
-        : public State
-    {
-    public:
-        static Waiting *instance()
-        {
-            static Waiting me;
-            return &me;
-        }
+    // Resume from a snapshot as the warm restart constructor does, from any
+    // state: for a standby taking over, reissuing the commands of the state
+    // it was shadowing.
+    bool recover(const ElevatorSnapshot *snapshot);
 
-        virtual bool enter(ElevatorFsm *fsm);
-        virtual bool onOpenButton(ElevatorFsm *fsm);
-        virtual bool onCloseButton(ElevatorFsm *fsm);
-        virtual bool onTimer(ElevatorFsm *fsm);
-    };
+private:
+    // States, transitions, and both engines, generated from elevator-fsm.model.
+#include "elevator-fsm-states.gen.hpp"
 
-    class Closing
-        : public State
-    {
-    public:
-        static Closing *instance()
-        {
-            static Closing me;
-            return &me;
-        }
+    // Leave the current state for the new one, reporting the change, and
+    // enter it. Shared by both engines.
+    bool changeState(StateId newState);
 
-        virtual bool enter(ElevatorFsm *fsm);
-        virtual bool onDoorsClosed(ElevatorFsm *fsm);
-        virtual bool onFault(ElevatorFsm *fsm);
-        virtual bool onTimer(ElevatorFsm *fsm);
-    };
+    // Go to the next stop on the stop list, or stop if there are none.
+    bool changeToNextStop();
 
-    class OutOfService
-        : public State
+    // Delegate all events to the current state.
+    bool onFloorRequest()   { return dispatch(EVENT_FLOOR_REQUEST, &ElevatorFsm::fireFloorRequest); }
+    bool onHallCall()       { return dispatch(EVENT_HALL_CALL, &ElevatorFsm::fireHallCall); }
+    bool onStopList()       { return dispatch(EVENT_STOP_LIST, &ElevatorFsm::fireStopList); }
+    bool onDoorsOpened()    { return dispatch(EVENT_DOORS_OPENED, &ElevatorFsm::fireDoorsOpened); }
+    bool onDoorsClosed()    { return dispatch(EVENT_DOORS_CLOSED, &ElevatorFsm::fireDoorsClosed); }
+    bool onOpenButton()     { return dispatch(EVENT_OPEN_BUTTON, &ElevatorFsm::fireOpenButton); }
+    bool onCloseButton()    { return dispatch(EVENT_CLOSE_BUTTON, &ElevatorFsm::fireCloseButton); }
+    bool onStopButton()     { return dispatch(EVENT_STOP_BUTTON, &ElevatorFsm::fireStopButton); }
+    bool onRestoreService() { return dispatch(EVENT_RESTORE_SERVICE, &ElevatorFsm::fireRestoreService); }
+    bool onFault(EventId source) { return dispatch(source, &ElevatorFsm::fireFault); }
+    bool onArrived()        { return dispatch(EVENT_ARRIVED, &ElevatorFsm::fireArrived); }
+    bool onTimer()          { return dispatch(EVENT_TIMER, &ElevatorFsm::fireTimer); }
+    bool onRecover()        { return fireRecover(); }
+
+    // Run the current state's handler, counting the event against that
+    // state if metrics are enabled.
+    bool dispatch(EventId event, bool (ElevatorFsm::*fire)())
     {
-    public:
-        static OutOfService *instance()
+        if (!metrics_)
         {
-            static OutOfService me;
-            return &me;
+            return (this->*fire)();
         }
 
-        virtual bool enter(ElevatorFsm *fsm);
-        virtual bool onRestoreService(ElevatorFsm *fsm);
-    };
+        StateId state   = currentState();
+        bool    handled = (this->*fire)();
 
-    class Restoring
-        : public State
-    {
-    public:
-        static Restoring *instance()
-        {
-            static Restoring me;
-            return &me;
-        }
+        countEvent(state, event, handled);
+        return handled;
+    }
 
-        // Immediately advances state on completion, so no need for additional events.
-        virtual bool enter(ElevatorFsm *fsm);
-    };
+    void countEvent(StateId state, EventId event, bool handled);
 
+    // Start the timer, noting when it will expire for snapshots. Returns the
+    // current time.
+    size_t startTimer(size_t msec);
 
-    friend State;
-    State *state_;
+    // On a coalesced timer's expiry: has the deadline the FSM wants come, or
+    // come within the slack? If not, re-arm the timer for the rest.
+    bool isTimerDue();
 
-    // Delegate all events to the current state.
-    bool onFloorRequest()   { return state_->onFloorRequest(this); }
-    bool onDoorsOpened()    { return state_->onDoorsOpened(this); }
-    bool onDoorsClosed()    { return state_->onDoorsClosed(this); }
-    bool onOpenButton()     { return state_->onOpenButton(this); }
-    bool onCloseButton()    { return state_->onCloseButton(this); }
-    bool onStopButton()     { return state_->onStopButton(this); }
-    bool onRestoreService() { return state_->onRestoreService(this); }
-    bool onFault()          { return state_->onFault(this); }
-    bool onArrived()        { return state_->onArrived(this); }
-    bool onTimer()          { return state_->onTimer(this); }
+    void saveSnapshot();
+
+    // Reserve the shaft for the trip to the destination, detouring first out
+    // of the way of the other car if it's waiting for this one, or else for
+    // a trip to a later stop, taking that stop first. Returns false if the
+    // car must hold.
+    bool reserveShaft();
+
+    // Put a stop back at the head of the stop list. Returns false if full.
+    bool pushStop(size_t floor);
 
     // API's used by this FSM.
     ElevatorUiApi    &ui_;
@@ -258,8 +301,51 @@ private:
     ElevatorDriveApi &drive_;
     ElevatorTimerApi &timer_;
 
+    const ElevatorDriveModel *driveModel_;
+    ElevatorTimingCache       timing_;
+    size_t                    actionStartMsec_;   // Drive or door command issued.
+    size_t                    moveFloors_;
+    size_t                    timerDeadlineMsec_;
+    bool                      coalesceTimers_;
+    size_t                    timerSlackMsec_;
+    bool                      timerArmed_;        // Coalesced timer running.
+    size_t                    armedDeadlineMsec_;
+
+    ElevatorSnapshotSlot     *snapshotSlot_;
+    uint32_t                  snapshotSequence_;
+    const ElevatorSnapshot   *recovery_;         // Only while constructing.
+    size_t                    resumeDwellMsec_;  // Dwell left on recovery.
+
+    ElevatorTransitionObserver *transitionObserver_;
+    ElevatorMetrics            *metrics_;
+    size_t                      metricsCar_;
+
+    ElevatorShaft              *shaft_;
+    size_t                      shaftCar_;
+    bool                        shaftHeld_;
+    size_t                      shaftHeldMsec_;     // Held since.
+
     size_t currentFloor_;
     size_t destinationFloor_;
+    size_t hallCallFloor_;
+    size_t stops_[MAX_STOPS];
+    size_t stopCount_;
+    size_t nextStop_;
+    size_t loadPercent_;
+    size_t fullLoadPercent_;
+};
+
+// Receives an ElevatorFsm's state changes as they happen, before the new
+// state's entry actions run, so nested changes arrive in order. The floor is
+// the car's current floor on entry.
+class ElevatorTransitionObserver
+{
+public:
+    virtual void onTransition(
+        ElevatorFsm::StateId from,
+        ElevatorFsm::StateId to,
+        size_t               floor,
+        size_t               nowMsec) = 0;
 };
         
 #endif // ELEVATOR_FSM_HPP
@@ -0,0 +1,499 @@
+// Elevator ingress: shared-memory event rings from driver processes to the
+// fleet host.
+//
+#include "elevator-ingress.hpp"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <new>
+
+static_assert(sizeof(ElevatorIngressEvent) == 48, "ingress event layout changed");
+static_assert(sizeof(ElevatorIngressRegion) % ElevatorIngressRegion::CACHE_LINE_BYTES == 0,
+              "rings start on a cache line");
+static_assert(std::atomic<uint32_t>::is_always_lock_free &&
+              (sizeof(std::atomic<uint32_t>) == sizeof(uint32_t)),
+              "the doorbell is a futex word");
+
+namespace
+{
+
+// The region is shared between processes, so the futex isn't private.
+void futexWait(std::atomic<uint32_t> &word, uint32_t expected, size_t timeoutMsec)
+{
+    struct timespec timeout;
+
+    timeout.tv_sec  = timeoutMsec / 1000;
+    timeout.tv_nsec = (timeoutMsec % 1000) * 1000000;
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAIT, expected, &timeout,
+            nullptr, 0);
+}
+
+void futexWake(std::atomic<uint32_t> &word)
+{
+    syscall(SYS_futex, reinterpret_cast<uint32_t *>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+}
+
+//---------- Struct ElevatorIngressRegion Implementation ----------------------
+
+ElevatorIngressRegion::ElevatorIngressRegion(size_t cars)
+    : magic(0)
+    , cars(static_cast<uint32_t>(cars))
+    , doorbell(0)
+    , sleeping(0)
+{
+    for (size_t source = 0; source < SOURCES; ++source)
+    {
+        for (size_t word = 0; word < READY_WORDS; ++word)
+        {
+            ready[source].words[word].store(0, std::memory_order_relaxed);
+        }
+    }
+    for (size_t ring = 0; ring < cars * SOURCES; ++ring)
+    {
+        new (reinterpret_cast<Ring *>(this + 1) + ring) Ring;
+    }
+}
+
+size_t ElevatorIngressRegion::bytes(size_t cars)
+{
+    return sizeof(ElevatorIngressRegion) + cars * SOURCES * sizeof(Ring);
+}
+
+ElevatorIngressRegion *ElevatorIngressRegion::create(void *memory, size_t cars)
+{
+    if (cars > MAX_CARS)
+    {
+        return nullptr;
+    }
+
+    ElevatorIngressRegion *region = new (memory) ElevatorIngressRegion(cars);
+
+    std::atomic_thread_fence(std::memory_order_release);
+    region->magic = MAGIC;
+    return region;
+}
+
+uint64_t ElevatorIngressRegion::nowNsec()
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ull + now.tv_nsec;
+}
+
+//---------- Class ElevatorIngressMap Implementation --------------------------
+
+ElevatorIngressMap::ElevatorIngressMap()
+    : fd_(-1)
+    , bytes_(0)
+    , region_(nullptr)
+{
+}
+
+ElevatorIngressMap::~ElevatorIngressMap()
+{
+    close();
+}
+
+bool ElevatorIngressMap::create(const char *path, size_t cars)
+{
+    size_t bytes = ElevatorIngressRegion::bytes(cars);
+
+    close();
+
+    // Truncating first discards rings and counters left by an earlier host.
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if ((fd_ < 0) || (ftruncate(fd_, bytes) != 0) || !map(bytes))
+    {
+        close();
+        return false;
+    }
+
+    if (!ElevatorIngressRegion::create(region_, cars))
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool ElevatorIngressMap::open(const char *path)
+{
+    struct stat status;
+
+    close();
+
+    fd_ = ::open(path, O_RDWR);
+    if ((fd_ < 0) || (fstat(fd_, &status) != 0) ||
+        (static_cast<size_t>(status.st_size) < sizeof(ElevatorIngressRegion)) ||
+        !map(status.st_size))
+    {
+        close();
+        return false;
+    }
+
+    if ((region_->magic != ElevatorIngressRegion::MAGIC) ||
+        (ElevatorIngressRegion::bytes(region_->cars) > bytes_))
+    {
+        close();
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return true;
+}
+
+void ElevatorIngressMap::close()
+{
+    if (region_)
+    {
+        munmap(region_, bytes_);
+        region_ = nullptr;
+        bytes_  = 0;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool ElevatorIngressMap::map(size_t bytes)
+{
+    void *map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    region_ = static_cast<ElevatorIngressRegion *>(map);
+    bytes_  = bytes;
+    return true;
+}
+
+//---------- Class ElevatorIngressProducer Implementation ---------------------
+
+ElevatorIngressProducer::ElevatorIngressProducer(ElevatorIngressRegion        &region,
+                                                 ElevatorIngressRegion::Source source)
+    : region_(region)
+    , source_(source)
+    , dropped_(0)
+    , wakes_(0)
+{
+    for (size_t word = 0; word < ElevatorIngressRegion::READY_WORDS; ++word)
+    {
+        posted_[word] = 0;
+    }
+}
+
+bool ElevatorIngressProducer::post(size_t car, ElevatorIngressEvent event)
+{
+    if (car >= region_.cars)
+    {
+        ++dropped_;
+        return false;
+    }
+
+    event.postedNsec = ElevatorIngressRegion::nowNsec();
+    if (!region_.ring(car, source_)->push(event))
+    {
+        ++dropped_;
+        return false;
+    }
+
+    posted_[car / 64] |= uint64_t(1) << (car % 64);
+    return true;
+}
+
+bool ElevatorIngressProducer::post(size_t car, ElevatorIngressEvent::Type type, size_t value)
+{
+    ElevatorIngressEvent event = {};
+
+    event.type  = type;
+    event.value = static_cast<uint32_t>(value);
+    return post(car, event);
+}
+
+bool ElevatorIngressProducer::postStopList(size_t car, const size_t *floors, size_t count)
+{
+    ElevatorIngressEvent event = {};
+
+    event.type      = ElevatorIngressEvent::STOP_LIST;
+    event.stopCount = static_cast<uint8_t>((count < ElevatorFsm::MAX_STOPS) ? count
+                                                                            : ElevatorFsm::MAX_STOPS);
+    for (size_t stop = 0; stop < event.stopCount; ++stop)
+    {
+        event.stops[stop] = static_cast<uint16_t>(floors[stop]);
+    }
+    return post(car, event);
+}
+
+void ElevatorIngressProducer::flush()
+{
+    bool posted = false;
+
+    for (size_t word = 0; word < ElevatorIngressRegion::READY_WORDS; ++word)
+    {
+        if (posted_[word])
+        {
+            region_.ready[source_].words[word].fetch_or(posted_[word]);
+            posted_[word] = 0;
+            posted        = true;
+        }
+    }
+    if (!posted)
+    {
+        return;
+    }
+
+    // Marking the cars, ringing, then checking for a sleeper pairs with the
+    // host announcing it may sleep, then checking for cars: one side or the
+    // other sees the events. Only the first driver to see a sleeper wakes
+    // it.
+    region_.doorbell.fetch_add(1);
+    if (region_.sleeping.load() && region_.sleeping.exchange(0))
+    {
+        futexWake(region_.doorbell);
+        ++wakes_;
+    }
+}
+
+//---------- Class ElevatorIngressGateway Implementation ----------------------
+
+ElevatorIngressGateway::ElevatorIngressGateway(ElevatorIngressRegion &region)
+    : region_(region)
+    , fsms_(region.cars, nullptr)
+    , routed_(0)
+    , rejected_(0)
+    , discarded_(0)
+    , sleeps_(0)
+    , latency_(BUCKETS, 0)
+{
+}
+
+void ElevatorIngressGateway::attach(size_t car, ElevatorFsm *fsm)
+{
+    if (car < fsms_.size())
+    {
+        fsms_[car] = fsm;
+    }
+}
+
+size_t ElevatorIngressGateway::drain()
+{
+    size_t routed = 0;
+    size_t words  = (region_.cars + 63) / 64;
+
+    for (size_t source = 0; source < ElevatorIngressRegion::SOURCES; ++source)
+    {
+        for (size_t word = 0; word < words; ++word)
+        {
+            std::atomic<uint64_t> &ready = region_.ready[source].words[word];
+
+            // Read first, so an idle word's line stays shared with the
+            // drivers.
+            if (ready.load(std::memory_order_relaxed) == 0)
+            {
+                continue;
+            }
+
+            uint64_t cars = ready.exchange(0);
+            while (cars)
+            {
+                size_t bit = __builtin_ctzll(cars);
+
+                cars &= cars - 1;
+                routed += drainRing(word * 64 + bit, static_cast<ElevatorIngressRegion::Source>(source));
+            }
+        }
+    }
+
+    return routed;
+}
+
+size_t ElevatorIngressGateway::wait(size_t timeoutMsec)
+{
+    size_t routed = drain();
+    if (routed)
+    {
+        return routed;
+    }
+
+    uint32_t doorbell = region_.doorbell.load();
+
+    region_.sleeping.store(1);
+    routed = drain();
+    if (routed == 0)
+    {
+        futexWait(region_.doorbell, doorbell, timeoutMsec);
+        ++sleeps_;
+    }
+    region_.sleeping.store(0);
+
+    return routed + drain();
+}
+
+size_t ElevatorIngressGateway::drainRing(size_t car, ElevatorIngressRegion::Source source)
+{
+    ElevatorIngressRegion::Ring *ring   = region_.ring(car, source);
+    ElevatorFsm                 *fsm    = fsms_[car];
+    ElevatorIngressEvent         event;
+    size_t                       routed = 0;
+
+    // One clock read for the batch: each event's latency runs to when the
+    // last of them was handled.
+    uint64_t posted[ElevatorIngressRegion::RING_EVENTS];
+
+    while ((routed < ElevatorIngressRegion::RING_EVENTS) && ring->pop(event))
+    {
+        posted[routed++] = event.postedNsec;
+        route(fsm, event);
+    }
+
+    uint64_t now = ElevatorIngressRegion::nowNsec();
+    for (size_t index = 0; index < routed; ++index)
+    {
+        ++latency_[bucket((now > posted[index]) ? (now - posted[index]) : 0)];
+    }
+
+    // The ring never holds more than a visit drains of what was announced;
+    // anything pushed since is announced by the driver's next flush.
+    routed_ += routed;
+    return routed;
+}
+
+void ElevatorIngressGateway::route(ElevatorFsm *fsm, const ElevatorIngressEvent &event)
+{
+    bool handled;
+
+    if (!fsm)
+    {
+        ++discarded_;
+        return;
+    }
+
+    switch (event.type)
+    {
+    case ElevatorIngressEvent::FLOOR_REQUEST:
+        handled = fsm->handleFloorRequest(event.value);
+        break;
+    case ElevatorIngressEvent::HALL_CALL:
+        handled = fsm->handleHallCall(event.value);
+        break;
+    case ElevatorIngressEvent::OPEN_BUTTON:
+        handled = fsm->handleOpenButton();
+        break;
+    case ElevatorIngressEvent::CLOSE_BUTTON:
+        handled = fsm->handleCloseButton();
+        break;
+    case ElevatorIngressEvent::STOP_BUTTON:
+        handled = fsm->handleStopButton();
+        break;
+    case ElevatorIngressEvent::RESTORE_SERVICE:
+        handled = fsm->handleRestoreService();
+        break;
+    case ElevatorIngressEvent::OPENED:
+        handled = fsm->handleOpened();
+        break;
+    case ElevatorIngressEvent::CLOSED:
+        handled = fsm->handleClosed();
+        break;
+    case ElevatorIngressEvent::DOOR_FAULT:
+        handled = fsm->handleDoorFault();
+        break;
+    case ElevatorIngressEvent::ARRIVED:
+        handled = fsm->handleArrived();
+        break;
+    case ElevatorIngressEvent::DRIVE_FAULT:
+        handled = fsm->handleDriveFault();
+        break;
+    case ElevatorIngressEvent::LOAD:
+        handled = fsm->handleLoad(event.value);
+        break;
+
+    case ElevatorIngressEvent::STOP_LIST:
+    {
+        size_t floors[ElevatorFsm::MAX_STOPS];
+        size_t count = (event.stopCount < ElevatorFsm::MAX_STOPS) ? event.stopCount
+                                                                   : ElevatorFsm::MAX_STOPS;
+
+        for (size_t stop = 0; stop < count; ++stop)
+        {
+            floors[stop] = event.stops[stop];
+        }
+        handled = fsm->handleStopList(floors, count);
+        break;
+    }
+
+    default:
+        // A type from a newer driver.
+        ++discarded_;
+        return;
+    }
+
+    if (!handled)
+    {
+        ++rejected_;
+    }
+}
+
+uint64_t ElevatorIngressGateway::latencyNsec(double percentile) const
+{
+    uint64_t total = 0;
+    for (uint64_t count : latency_)
+    {
+        total += count;
+    }
+    if (total == 0)
+    {
+        return 0;
+    }
+
+    uint64_t rank  = static_cast<uint64_t>(percentile / 100.0 * (total - 1));
+    uint64_t count = 0;
+    for (size_t index = 0; index < BUCKETS; ++index)
+    {
+        count += latency_[index];
+        if (count > rank)
+        {
+            return bucketNsec(index + 1);
+        }
+    }
+    return bucketNsec(BUCKETS);
+}
+
+// Buckets are exact below SUB_BUCKETS, then SUB_BUCKETS to each power of two.
+size_t ElevatorIngressGateway::bucket(uint64_t nsec)
+{
+    if (nsec < SUB_BUCKETS)
+    {
+        return nsec;
+    }
+
+    size_t msb = 63 - __builtin_clzll(nsec);
+    size_t sub = (nsec >> (msb - 3)) & (SUB_BUCKETS - 1);
+
+    return (msb - 2) * SUB_BUCKETS + sub;
+}
+
+// The lowest latency in a bucket; a bucket's highest is the next one's less
+// one.
+uint64_t ElevatorIngressGateway::bucketNsec(size_t bucket)
+{
+    if (bucket < SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    size_t msb = bucket / SUB_BUCKETS + 2;
+    size_t sub = bucket % SUB_BUCKETS;
+
+    return static_cast<uint64_t>(SUB_BUCKETS + sub) << (msb - 3);
+}
@@ -0,0 +1,213 @@
+// Elevator ingress: a gateway feeding events from component driver
+// processes into a host process running a fleet of ElevatorFsm cars.
+//
+// The drivers and the host share an ElevatorIngressRegion in a memory-mapped
+// file, on /dev/shm for one that lives in RAM. Each car has an SPSC ring of
+// fixed-size event records per source (UI, door, and drive), so a driver
+// process is the single producer for its source however many cars it
+// drives. A driver posts a batch of events, then flushes: it marks the cars
+// it posted to in its source's ready bitmap and bumps the region's doorbell,
+// and only if the host is asleep on the doorbell does it wake it, with a
+// futex. The host sleeps on the doorbell until a flush, takes the ready
+// bitmaps, and drains just those cars' rings, routing each event to its
+// car's handleX(). A busy host makes no system calls; an idle one is woken
+// once per batch, however many drivers flush at once.
+//
+// Timer expiries aren't ingress events: the host runs the cars' timers.
+//
+#ifndef ELEVATOR_INGRESS_HPP
+#define ELEVATOR_INGRESS_HPP
+
+#include "elevator-fsm.hpp"
+#include "elevator-spsc-queue.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// An event from a component driver, stamped when it was posted.
+struct ElevatorIngressEvent
+{
+    enum Type
+    {
+        FLOOR_REQUEST,
+        HALL_CALL,
+        STOP_LIST,
+        OPEN_BUTTON,
+        CLOSE_BUTTON,
+        STOP_BUTTON,
+        RESTORE_SERVICE,
+        OPENED,
+        CLOSED,
+        DOOR_FAULT,
+        ARRIVED,
+        DRIVE_FAULT,
+        LOAD,
+    };
+
+    uint8_t  type;
+    uint8_t  stopCount;
+    uint16_t reserved;
+    uint32_t value;         // Floor or load percent.
+    uint64_t postedNsec;    // ElevatorIngressRegion::nowNsec() when posted.
+    uint16_t stops[ElevatorFsm::MAX_STOPS];
+};
+
+// The shared region: a header followed by the cars' rings. It has no
+// pointers, so each process can map it anywhere.
+struct ElevatorIngressRegion
+{
+    enum Source
+    {
+        SOURCE_UI,
+        SOURCE_DOOR,
+        SOURCE_DRIVE,
+        SOURCES,
+    };
+
+    enum Limits
+    {
+        MAX_CARS         = 4096,
+        RING_EVENTS      = 64,
+        READY_WORDS      = MAX_CARS / 64,
+        CACHE_LINE_BYTES = 64,
+        MAGIC            = 0x494e4752,  // "INGR"
+    };
+
+    typedef ElevatorSpscQueue<ElevatorIngressEvent, RING_EVENTS> Ring;
+
+    // Bytes to map for a region of this many cars.
+    static size_t bytes(size_t cars);
+
+    // Construct a region, with empty rings, in memory of bytes(cars).
+    static ElevatorIngressRegion *create(void *memory, size_t cars);
+
+    // The monotonic clock events are stamped with, the same in every process.
+    static uint64_t nowNsec();
+
+    Ring *ring(size_t car, Source source)
+    {
+        return reinterpret_cast<Ring *>(this + 1) + car * SOURCES + source;
+    }
+
+    uint32_t magic;         // Written last by create().
+    uint32_t cars;
+
+    // Bumped by each flush; the futex word the host sleeps on.
+    alignas(CACHE_LINE_BYTES) std::atomic<uint32_t> doorbell;
+    std::atomic<uint32_t> sleeping;     // Set while the host may sleep.
+
+    // Cars with events posted since the host last drained them, a bitmap
+    // per source.
+    struct alignas(CACHE_LINE_BYTES) Ready
+    {
+        std::atomic<uint64_t> words[READY_WORDS];
+    };
+    Ready ready[SOURCES];
+
+private:
+    ElevatorIngressRegion(size_t cars);
+};
+
+// A region in a memory-mapped file: created by the host, replacing any left
+// by an earlier run, and opened by the drivers.
+class ElevatorIngressMap
+{
+public:
+    ElevatorIngressMap();
+    ~ElevatorIngressMap();
+
+    bool create(const char *path, size_t cars);
+    bool open(const char *path);
+    void close();
+
+    bool                   isOpen() const { return region_ != nullptr; }
+    ElevatorIngressRegion *region() { return region_; }
+
+private:
+    ElevatorIngressMap(const ElevatorIngressMap &) = delete;
+    ElevatorIngressMap &operator=(const ElevatorIngressMap &) = delete;
+
+    bool map(size_t bytes);
+
+    int                    fd_;
+    size_t                 bytes_;
+    ElevatorIngressRegion *region_;
+};
+
+// Driver side: posts one source's events to the cars' rings. Posted events
+// may be drained at once by a host that's already busy, but the host isn't
+// told of them until the flush.
+class ElevatorIngressProducer
+{
+public:
+    ElevatorIngressProducer(ElevatorIngressRegion &region, ElevatorIngressRegion::Source source);
+
+    // Returns false, dropping the event, if the car's ring is full; flush
+    // and try again to wait for the host.
+    bool post(size_t car, ElevatorIngressEvent event);
+    bool post(size_t car, ElevatorIngressEvent::Type type, size_t value = 0);
+    bool postStopList(size_t car, const size_t *floors, size_t count);
+
+    // Announce the posted events, waking the host if it's asleep.
+    void flush();
+
+    size_t dropped() const { return dropped_; }
+    size_t wakes() const { return wakes_; }
+
+private:
+    ElevatorIngressRegion        &region_;
+    ElevatorIngressRegion::Source source_;
+    uint64_t                      posted_[ElevatorIngressRegion::READY_WORDS];
+    size_t                        dropped_;
+    size_t                        wakes_;
+};
+
+// Host side: routes the drivers' events to the cars' FSMs, and keeps a
+// histogram of the time from post to handler.
+class ElevatorIngressGateway
+{
+public:
+    enum Histogram
+    {
+        SUB_BUCKETS = 8,                        // Per power of two.
+        BUCKETS     = (64 - 2) * SUB_BUCKETS,
+    };
+
+    explicit ElevatorIngressGateway(ElevatorIngressRegion &region);
+
+    // Events for a car with no FSM attached are discarded.
+    void attach(size_t car, ElevatorFsm *fsm);
+
+    // Route the announced events without blocking; returns how many.
+    size_t drain();
+
+    // Drain, sleeping first until a flush if there's nothing to route, for
+    // up to the timeout.
+    size_t wait(size_t timeoutMsec);
+
+    size_t routed() const { return routed_; }
+    size_t rejected() const { return rejected_; }   // Handler returned false.
+    size_t discarded() const { return discarded_; }
+    size_t sleeps() const { return sleeps_; }
+
+    // Post-to-handler latency at a percentile, to within an eighth.
+    uint64_t latencyNsec(double percentile) const;
+
+private:
+    size_t drainRing(size_t car, ElevatorIngressRegion::Source source);
+    void   route(ElevatorFsm *fsm, const ElevatorIngressEvent &event);
+
+    static size_t   bucket(uint64_t nsec);
+    static uint64_t bucketNsec(size_t bucket);
+
+    ElevatorIngressRegion     &region_;
+    std::vector<ElevatorFsm *> fsms_;
+    size_t                     routed_;
+    size_t                     rejected_;
+    size_t                     discarded_;
+    size_t                     sleeps_;
+    std::vector<uint64_t>      latency_;
+};
+
+#endif // ELEVATOR_INGRESS_HPP
@@ -0,0 +1,143 @@
+// Elevator transition log query tool: answers maintenance queries over
+// ElevatorTransitionLog files by memory-mapping them and reading only the
+// columns a query needs.
+//
+// Usage: queryLog count FROM TO FILE...   FROM->TO transitions per car per day
+//        queryLog summary FILE...         blocks, rows, and size of each file
+//
+// States are named as in the FSM, e.g. queryLog count Opening OutOfService.
+//
+#include "elevator-transition-log.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace
+{
+
+void usage()
+{
+    fprintf(stderr,
+            "usage: queryLog count FROM TO FILE...\n"
+            "       queryLog summary FILE...\n"
+            "states:");
+    for (int state = ElevatorFsm::STATE_STOPPED; state < ElevatorFsm::STATE_IDS; ++state)
+    {
+        fprintf(stderr, " %s", ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(state)));
+    }
+    fprintf(stderr, "\n");
+}
+
+void formatDay(uint64_t day, char *text, size_t size)
+{
+    time_t    seconds = static_cast<time_t>(day * (ElevatorTransitionLogReader::DAY_MSEC / 1000));
+    struct tm date;
+
+    gmtime_r(&seconds, &date);
+    strftime(text, size, "%Y-%m-%d", &date);
+}
+
+int count(int files, char **paths, ElevatorFsm::StateId from, ElevatorFsm::StateId to)
+{
+    ElevatorTransitionLogReader::CarDayCounts counts;
+    size_t blocks = 0;
+    size_t read   = 0;
+
+    for (int file = 0; file < files; ++file)
+    {
+        ElevatorTransitionLogReader reader;
+
+        if (!reader.open(paths[file]))
+        {
+            fprintf(stderr, "queryLog: can't open %s\n", paths[file]);
+            return 1;
+        }
+        blocks += reader.blocks();
+        read   += reader.countPerCarDay(from, to, counts);
+    }
+
+    printf("%s -> %s\n", ElevatorFsm::stateName(from), ElevatorFsm::stateName(to));
+    printf("%5s %-10s %8s\n", "car", "day", "count");
+    for (const auto &count : counts)
+    {
+        char day[16];
+
+        formatDay(count.first.second, day, sizeof(day));
+        printf("%5zu %-10s %8zu\n", count.first.first, day, count.second);
+    }
+    fprintf(stderr, "%zu of %zu blocks read\n", read, blocks);
+    return 0;
+}
+
+int summary(int files, char **paths)
+{
+    printf("%-32s %8s %10s %12s %9s %-10s %-10s\n",
+           "file", "blocks", "rows", "bytes", "bytes/row", "first day", "last day");
+
+    for (int file = 0; file < files; ++file)
+    {
+        ElevatorTransitionLogReader reader;
+        size_t   rows  = 0;
+        uint64_t first = UINT64_MAX;
+        uint64_t last  = 0;
+        char     firstDay[16] = "-";
+        char     lastDay[16]  = "-";
+
+        if (!reader.open(paths[file]))
+        {
+            fprintf(stderr, "queryLog: can't open %s\n", paths[file]);
+            return 1;
+        }
+
+        // From the block index alone.
+        for (size_t index = 0; index < reader.blocks(); ++index)
+        {
+            const ElevatorTransitionBlock &block = reader.block(index);
+
+            rows += block.rows;
+            first = std::min(first, block.minTimeMsec);
+            last  = std::max(last, block.maxTimeMsec);
+        }
+        if (rows > 0)
+        {
+            formatDay(first / ElevatorTransitionLogReader::DAY_MSEC, firstDay, sizeof(firstDay));
+            formatDay(last / ElevatorTransitionLogReader::DAY_MSEC, lastDay, sizeof(lastDay));
+        }
+
+        printf("%-32s %8zu %10zu %12zu %9.1f %-10s %-10s\n", paths[file], reader.blocks(), rows,
+               reader.fileBytes(), rows ? double(reader.indexedBytes()) / rows : 0.0,
+               firstDay, lastDay);
+        if (reader.indexedBytes() != reader.fileBytes())
+        {
+            printf("%-32s %zu bytes of torn or corrupt tail ignored\n", "",
+                   reader.fileBytes() - reader.indexedBytes());
+        }
+    }
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ElevatorFsm::StateId from;
+    ElevatorFsm::StateId to;
+
+    if ((argc >= 3) && (strcmp(argv[1], "summary") == 0))
+    {
+        return summary(argc - 2, argv + 2);
+    }
+
+    if ((argc >= 5) && (strcmp(argv[1], "count") == 0) &&
+        ElevatorTransitionLogReader::parseState(argv[2], from) &&
+        ElevatorTransitionLogReader::parseState(argv[3], to))
+    {
+        return count(argc - 4, argv + 4, from, to);
+    }
+
+    usage();
+    return 2;
+}
@@ -0,0 +1,159 @@
+// Elevator metrics: sharded counters and Prometheus text rendering.
+//
+#include "elevator-metrics.hpp"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+
+namespace
+{
+
+void appendCounter(std::string &text, const char *line, ...)
+    __attribute__((format(printf, 2, 3)));
+
+void appendCounter(std::string &text, const char *line, ...)
+{
+    char    buffer[192];
+    va_list args;
+
+    va_start(args, line);
+    int length = vsnprintf(buffer, sizeof(buffer), line, args);
+    va_end(args);
+
+    if (length > 0)
+    {
+        text.append(buffer, std::min(static_cast<size_t>(length), sizeof(buffer) - 1));
+    }
+}
+
+} // namespace
+
+//---------- Class ElevatorMetrics Implementation -----------------------------
+
+ElevatorMetrics::ElevatorMetrics(size_t cars, size_t shards)
+    : cars_(cars)
+    , shardMask_(shardMask(shards))
+    , lines_((shardMask_ + 2) * cars * CAR_LINES)    // Value-initialized to zero.
+{
+}
+
+size_t ElevatorMetrics::shardMask(size_t shards)
+{
+    size_t mask = 0;
+
+    while (mask + 1 < shards)
+    {
+        mask = (mask << 1) | 1;
+    }
+    return mask;
+}
+
+uint64_t ElevatorMetrics::sum(size_t car, size_t index) const
+{
+    uint64_t total = 0;
+
+    for (size_t shard = 0; shard <= shardMask_ + 1; ++shard)
+    {
+        total += counter(shard, car, index).load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+void ElevatorMetrics::render(std::string &text) const
+{
+    text.clear();
+
+    text += "# HELP elevator_transitions_total State changes by from and to state.\n"
+            "# TYPE elevator_transitions_total counter\n";
+    for (size_t car = 0; car < cars_; ++car)
+    {
+        for (int from = 0; from < ElevatorFsm::STATE_IDS; ++from)
+        {
+            for (int to = 0; to < ElevatorFsm::STATE_IDS; ++to)
+            {
+                uint64_t count = transitions(car, static_cast<ElevatorFsm::StateId>(from),
+                                             static_cast<ElevatorFsm::StateId>(to));
+                if (count)
+                {
+                    appendCounter(text, "elevator_transitions_total{car=\"%zu\",from=\"%s\",to=\"%s\"} %llu\n",
+                                  car, ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(from)),
+                                  ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(to)),
+                                  static_cast<unsigned long long>(count));
+                }
+            }
+        }
+    }
+
+    text += "# HELP elevator_events_rejected_total Events the current state did not handle.\n"
+            "# TYPE elevator_events_rejected_total counter\n";
+    for (size_t car = 0; car < cars_; ++car)
+    {
+        for (int state = 0; state < ElevatorFsm::STATE_IDS; ++state)
+        {
+            for (int event = 0; event < ElevatorFsm::EVENT_IDS; ++event)
+            {
+                uint64_t count = rejected(car, static_cast<ElevatorFsm::StateId>(state),
+                                          static_cast<ElevatorFsm::EventId>(event));
+                if (count)
+                {
+                    appendCounter(text, "elevator_events_rejected_total{car=\"%zu\",state=\"%s\",event=\"%s\"} %llu\n",
+                                  car, ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(state)),
+                                  ElevatorFsm::eventName(static_cast<ElevatorFsm::EventId>(event)),
+                                  static_cast<unsigned long long>(count));
+                }
+            }
+        }
+    }
+
+    text += "# HELP elevator_timer_expiries_total Timer expiries by state.\n"
+            "# TYPE elevator_timer_expiries_total counter\n";
+    for (size_t car = 0; car < cars_; ++car)
+    {
+        for (int state = 0; state < ElevatorFsm::STATE_IDS; ++state)
+        {
+            uint64_t count = expiries(car, static_cast<ElevatorFsm::StateId>(state));
+            if (count)
+            {
+                appendCounter(text, "elevator_timer_expiries_total{car=\"%zu\",state=\"%s\"} %llu\n",
+                              car, ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(state)),
+                              static_cast<unsigned long long>(count));
+            }
+        }
+    }
+
+    // Both sources always, so a rate over a fault-free fleet reads zero.
+    text += "# HELP elevator_faults_total Faults by source.\n"
+            "# TYPE elevator_faults_total counter\n";
+    for (size_t car = 0; car < cars_; ++car)
+    {
+        appendCounter(text, "elevator_faults_total{car=\"%zu\",source=\"door\"} %llu\n",
+                      car, static_cast<unsigned long long>(doorFaults(car)));
+        appendCounter(text, "elevator_faults_total{car=\"%zu\",source=\"drive\"} %llu\n",
+                      car, static_cast<unsigned long long>(driveFaults(car)));
+    }
+}
+
+bool ElevatorMetrics::renderToFile(const char *path) const
+{
+    std::string text;
+    std::string temporary = std::string(path) + ".tmp";
+
+    render(text);
+
+    FILE *file = fopen(temporary.c_str(), "w");
+    if (!file)
+    {
+        return false;
+    }
+
+    bool written = (fwrite(text.data(), 1, text.size(), file) == text.size());
+    written = (fclose(file) == 0) && written;
+
+    if (!written || (rename(temporary.c_str(), path) != 0))
+    {
+        remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
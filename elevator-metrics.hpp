@@ -0,0 +1,158 @@
+// Elevator metrics: per-car counters for operations, incremented from
+// ElevatorFsm dispatch and scraped in Prometheus text format.
+//
+// For each car the registry counts:
+// - transitions by from and to state;
+// - events rejected by state and event, where the state's handler returned
+//   false;
+// - timer expiries by state;
+// - faults by source, door or drive.
+//
+// Counters are sharded by thread: each of the first threads to count gets a
+// shard of its own, so cars run on different threads never write the same
+// cache line, and as the only writer it increments with a plain load and
+// store rather than a locked add. Threads beyond those share one more shard
+// and increment it with atomic adds. Shards start on cache line boundaries.
+// A scrape sums the shards with relaxed loads while the writers carry on;
+// each counter is exact as of some moment during the scrape.
+//
+#ifndef ELEVATOR_METRICS_HPP
+#define ELEVATOR_METRICS_HPP
+
+#include "elevator-fsm.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class ElevatorMetrics
+{
+public:
+    enum Shards
+    {
+        DEFAULT_SHARDS   = 8,
+        CACHE_LINE_BYTES = 64,
+    };
+
+    // Shards of their own for this many threads, rounded up to a power of
+    // two.
+    explicit ElevatorMetrics(size_t cars, size_t shards = DEFAULT_SHARDS);
+
+    // Called from the FSM.
+    void transition(size_t car, ElevatorFsm::StateId from, ElevatorFsm::StateId to)
+    {
+        add(car, TRANSITIONS + from * int(ElevatorFsm::STATE_IDS) + to);
+    }
+
+    void event(size_t car, ElevatorFsm::StateId state, ElevatorFsm::EventId event, bool handled)
+    {
+        if (!handled)
+        {
+            add(car, REJECTED + state * int(ElevatorFsm::EVENT_IDS) + event);
+        }
+        if (event == ElevatorFsm::EVENT_TIMER)
+        {
+            add(car, EXPIRIES + int(state));
+        }
+        else if (event == ElevatorFsm::EVENT_DOOR_FAULT)
+        {
+            add(car, DOOR_FAULTS);
+        }
+        else if (event == ElevatorFsm::EVENT_DRIVE_FAULT)
+        {
+            add(car, DRIVE_FAULTS);
+        }
+    }
+
+    // Totals over all shards.
+    uint64_t transitions(size_t car, ElevatorFsm::StateId from, ElevatorFsm::StateId to) const
+    {
+        return sum(car, TRANSITIONS + from * int(ElevatorFsm::STATE_IDS) + to);
+    }
+    uint64_t rejected(size_t car, ElevatorFsm::StateId state, ElevatorFsm::EventId event) const
+    {
+        return sum(car, REJECTED + state * int(ElevatorFsm::EVENT_IDS) + event);
+    }
+    uint64_t expiries(size_t car, ElevatorFsm::StateId state) const
+    {
+        return sum(car, EXPIRIES + int(state));
+    }
+    uint64_t doorFaults(size_t car) const  { return sum(car, DOOR_FAULTS); }
+    uint64_t driveFaults(size_t car) const { return sum(car, DRIVE_FAULTS); }
+
+    size_t cars() const { return cars_; }
+    size_t shards() const { return shardMask_ + 1; }    // Plus the shared one.
+
+    // Render every non-zero counter in Prometheus text exposition format,
+    // replacing the text.
+    void render(std::string &text) const;
+
+    // Render to a file for a textfile collector to pick up: written beside
+    // it and renamed over it, so the collector never reads a partial file.
+    bool renderToFile(const char *path) const;
+
+private:
+    enum Counters
+    {
+        TRANSITIONS    = 0,
+        REJECTED       = TRANSITIONS + int(ElevatorFsm::STATE_IDS) * int(ElevatorFsm::STATE_IDS),
+        EXPIRIES       = REJECTED + int(ElevatorFsm::STATE_IDS) * int(ElevatorFsm::EVENT_IDS),
+        DOOR_FAULTS    = EXPIRIES + int(ElevatorFsm::STATE_IDS),
+        DRIVE_FAULTS,
+        COUNTERS,
+        LINE_COUNTERS  = CACHE_LINE_BYTES / sizeof(uint64_t),
+        CAR_LINES      = (COUNTERS + LINE_COUNTERS - 1) / LINE_COUNTERS,
+    };
+
+    struct alignas(CACHE_LINE_BYTES) Line
+    {
+        std::atomic<uint64_t> counters[LINE_COUNTERS];
+    };
+
+    // Threads are numbered in the order they first count, for the life of
+    // the process; a controller's threads are long-lived.
+    static size_t threadIndex()
+    {
+        static std::atomic<size_t> next(0);
+        thread_local size_t        index = next.fetch_add(1, std::memory_order_relaxed);
+
+        return index;
+    }
+
+    std::atomic<uint64_t> &counter(size_t shard, size_t car, size_t counter)
+    {
+        return lines_[(shard * cars_ + car) * CAR_LINES + counter / LINE_COUNTERS]
+            .counters[counter % LINE_COUNTERS];
+    }
+    const std::atomic<uint64_t> &counter(size_t shard, size_t car, size_t counter) const
+    {
+        return lines_[(shard * cars_ + car) * CAR_LINES + counter / LINE_COUNTERS]
+            .counters[counter % LINE_COUNTERS];
+    }
+
+    void add(size_t car, size_t index)
+    {
+        size_t thread = threadIndex();
+
+        if (thread <= shardMask_)
+        {
+            std::atomic<uint64_t> &count = counter(thread, car, index);
+            count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        else
+        {
+            counter(shardMask_ + 1, car, index).fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t sum(size_t car, size_t counter) const;
+
+    static size_t shardMask(size_t shards);
+
+    size_t            cars_;
+    size_t            shardMask_;
+    std::vector<Line> lines_;
+};
+
+#endif // ELEVATOR_METRICS_HPP
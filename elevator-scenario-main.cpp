@@ -0,0 +1,224 @@
+// Elevator scenario runner: generates FSM scenarios with randomized timings,
+// runs them all concurrently on the scenario engine's virtual clock, and
+// reports throughput.
+//
+// Usage: runScenarios [scenarios] [seed]   (default: 50000 scenarios, seed 1)
+//
+// Exits with status 1 if any scenario fails.
+//
+#include "elevator-scenario.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+namespace
+{
+
+typedef ScenarioAction A;
+
+// Ground floor to a floor and back to idle, with the door taking the given
+// time to open and close. A door slower than the open timeout must take the
+// car out of service exactly at the timeout.
+Scenario trip(ScenarioCar &car, size_t floor, size_t travelMsec, size_t doorMsec)
+{
+    car.floorRequest(floor);
+    A go    = co_await car.expect(A::DRIVE_GO_TO_FLOOR);
+    A timer = co_await car.expect(A::TIMER_START);
+    car.check(go.value == floor, "drive sent to requested floor");
+    car.check(timer.value == ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC, "move timeout");
+
+    co_await car.after(travelMsec);
+    car.arrived();
+    A arrived = co_await car.expect(A::UI_ARRIVED);
+    co_await car.expect(A::DOOR_OPEN);
+    timer = co_await car.expect(A::TIMER_START);
+    car.check(arrived.value == floor, "arrival shown at requested floor");
+    car.check(timer.value == ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC, "door open timeout");
+
+    if (doorMsec >= ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC)
+    {
+        A out = co_await car.expect(A::UI_OUT_OF_SERVICE);
+        car.check(out.atMsec == timer.atMsec + ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC,
+                  "out of service exactly at door open timeout");
+        car.check(!car.fsm().isInService(), "out of service after door timeout");
+        co_return;
+    }
+
+    co_await car.after(doorMsec);
+    car.opened();
+    A dwell = co_await car.expect(A::TIMER_START);
+    car.check(dwell.value == ElevatorFsm::TIMER_WAITING_MSEC, "dwell time");
+
+    // The dwell times out on its own.
+    A close = co_await car.expect(A::DOOR_CLOSE);
+    timer   = co_await car.expect(A::TIMER_START);
+    car.check(close.atMsec == dwell.atMsec + ElevatorFsm::TIMER_WAITING_MSEC,
+              "doors close when the dwell ends");
+    car.check(timer.value == ElevatorFsm::TIMEOUT_DOOR_CLOSE_MSEC, "door close timeout");
+
+    co_await car.after(doorMsec);
+    car.closed();
+    car.check(car.fsm().isIdle(), "idle after the trip");
+}
+
+// The stop button holds the car with the alarm on; pushing it again lets the
+// drive continue, reissuing the trip with a fresh timeout.
+Scenario stopButton(ScenarioCar &car, size_t floor, size_t holdMsec)
+{
+    car.floorRequest(floor);
+    co_await car.expect(A::DRIVE_GO_TO_FLOOR);
+    co_await car.expect(A::TIMER_START);
+
+    co_await car.after(1000);
+    car.stopButton();
+    co_await car.expect(A::DRIVE_STOP);
+    co_await car.expect(A::UI_ALARM_ON);
+
+    co_await car.after(holdMsec);
+    car.stopButton();
+    co_await car.expect(A::DRIVE_START);
+    co_await car.expect(A::UI_ALARM_OFF);
+    A go = co_await car.expect(A::DRIVE_GO_TO_FLOOR);
+    car.check(go.value == floor, "resumed trip to requested floor");
+    co_await car.expect(A::TIMER_START);
+}
+
+// A drive fault takes the car out of service. When it is restored, it opens
+// at the ground floor only if it is safely there, otherwise it goes there.
+Scenario faultAndRestore(ScenarioCar &car, size_t floor, size_t restoreFloor, bool atFloor)
+{
+    car.floorRequest(floor);
+    co_await car.expect(A::DRIVE_GO_TO_FLOOR);
+    co_await car.expect(A::TIMER_START);
+
+    co_await car.after(2000);
+    car.driveFault();
+    co_await car.expect(A::UI_OUT_OF_SERVICE);
+    car.check(!car.fsm().isInService(), "out of service after drive fault");
+
+    // A technician moves the car and restores service.
+    co_await car.after(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC);
+    car.placeCar(restoreFloor, atFloor);
+    car.restoreService();
+    co_await car.expect(A::UI_IN_SERVICE);
+
+    if (!atFloor || (restoreFloor != ElevatorFsm::GROUND_FLOOR))
+    {
+        A go = co_await car.expect(A::DRIVE_GO_TO_FLOOR);
+        co_await car.expect(A::TIMER_START);
+        car.check(go.value == ElevatorFsm::GROUND_FLOOR, "restored car returns to ground");
+
+        co_await car.after(3000);
+        car.arrived();
+    }
+
+    A arrived = co_await car.expect(A::UI_ARRIVED);
+    co_await car.expect(A::DOOR_OPEN);
+    co_await car.expect(A::TIMER_START);
+    car.check(arrived.value == ElevatorFsm::GROUND_FLOOR, "restored car opens at ground");
+    car.check(car.fsm().isInService(), "in service after restore");
+}
+
+// Destination dispatch: the car serves its stop list in order without
+// further requests, skipping a stop at the floor it is already at.
+Scenario stopList(ScenarioCar &car, size_t first, size_t second, size_t travelMsec)
+{
+    const size_t stops[] = { first, first, second };
+    const size_t trips   = (second == first) ? 1 : 2;
+
+    car.stopList(stops, 3);
+    for (size_t trip = 0; trip < trips; ++trip)
+    {
+        size_t floor = stops[trip * 2];
+        A go = co_await car.expect(A::DRIVE_GO_TO_FLOOR);
+        co_await car.expect(A::TIMER_START);
+        car.check(go.value == floor, "stops served in order");
+
+        co_await car.after(travelMsec);
+        car.arrived();
+        co_await car.expect(A::UI_ARRIVED);
+        co_await car.expect(A::DOOR_OPEN);
+        co_await car.expect(A::TIMER_START);
+        co_await car.after(2000);
+        car.opened();
+        co_await car.expect(A::TIMER_START);
+
+        // Passengers in a hurry.
+        co_await car.after(1000);
+        car.closeButton();
+        co_await car.expect(A::DOOR_CLOSE);
+        co_await car.expect(A::TIMER_START);
+        co_await car.after(3000);
+        car.closed();
+    }
+    car.check(!car.fsm().hasPendingStops() && car.fsm().isIdle(), "idle when stops are done");
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    size_t       scenarios = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 50000;
+    unsigned     seed      = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 1;
+    std::minstd_rand random(seed);
+    ScenarioEngine   engine;
+
+    auto uniform = [&](size_t low, size_t high)
+    {
+        return std::uniform_int_distribution<size_t>(low, high)(random);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t id = 0; id < scenarios; ++id)
+    {
+        ScenarioCar &car   = engine.newCar();
+        size_t       floor = uniform(ElevatorFsm::GROUND_FLOOR + 1, 12);
+
+        switch (id % 4)
+        {
+        case 0:
+            engine.spawn(trip(car, floor, uniform(2000, 20000), uniform(1500, 6000)));
+            break;
+        case 1:
+            engine.spawn(stopButton(car, floor, uniform(500, 90000)));
+            break;
+        case 2:
+            engine.spawn(faultAndRestore(car, floor, uniform(ElevatorFsm::GROUND_FLOOR, 3),
+                                         uniform(0, 1) != 0));
+            break;
+        default:
+            engine.spawn(stopList(car, floor, uniform(ElevatorFsm::GROUND_FLOOR, 12),
+                                  uniform(2000, 20000)));
+            break;
+        }
+    }
+
+    auto spawned = std::chrono::steady_clock::now();
+    engine.run();
+    auto done = std::chrono::steady_clock::now();
+
+    std::chrono::duration<double> setup = spawned - start;
+    std::chrono::duration<double> run   = done - spawned;
+
+    printf("%zu scenarios: %zu passed, %zu failed\n",
+           engine.started(), engine.passed(), engine.failed());
+    printf("%-28s %10zu\n", "peak concurrent scenarios", engine.peakRunning());
+    printf("%-28s %10.1f s\n", "virtual time", engine.nowMsec() / 1000.0);
+    printf("%-28s %10.3f s\n", "setup (cars, frames)", setup.count());
+    printf("%-28s %10.3f s\n", "run", run.count());
+    printf("%-28s %10.0f\n", "scenarios per second", engine.started() / run.count());
+    printf("%-28s %10zu x %d bytes in %zu slabs, %zu heap fallbacks\n", "frame pool peak",
+           ScenarioFramePool::peakInUse(), ScenarioFramePool::BLOCK_BYTES,
+           ScenarioFramePool::slabs(), ScenarioFramePool::fallbacks());
+
+    if (const ScenarioCar *failure = engine.firstFailure())
+    {
+        printf("first failure: scenario %zu: %s\n", failure->id(), failure->failure());
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,306 @@
+// Elevator scenario engine: coroutine scenarios on a virtual clock.
+//
+#include "elevator-scenario.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <new>
+
+//---------- Class ScenarioFramePool Implementation ---------------------------
+
+ScenarioFramePool::ScenarioFramePool()
+    : free_(nullptr)
+    , inUse_(0)
+    , peakInUse_(0)
+    , fallbacks_(0)
+{
+}
+
+ScenarioFramePool::~ScenarioFramePool()
+{
+    for (void *slab : slabs_)
+    {
+        ::operator delete(slab);
+    }
+}
+
+ScenarioFramePool &ScenarioFramePool::pool()
+{
+    static ScenarioFramePool me;
+    return me;
+}
+
+void *ScenarioFramePool::allocate(size_t bytes)
+{
+    ScenarioFramePool &me = pool();
+
+    if (bytes > BLOCK_BYTES)
+    {
+        ++me.fallbacks_;
+        return ::operator new(bytes);
+    }
+
+    if (!me.free_)
+    {
+        char *slab = static_cast<char *>(::operator new(size_t(BLOCK_BYTES) * SLAB_BLOCKS));
+
+        me.slabs_.push_back(slab);
+        for (size_t block = SLAB_BLOCKS; block-- > 0; )
+        {
+            Block *free = reinterpret_cast<Block *>(slab + block * BLOCK_BYTES);
+            free->next  = me.free_;
+            me.free_    = free;
+        }
+    }
+
+    Block *block = me.free_;
+    me.free_     = block->next;
+    me.peakInUse_ = std::max(me.peakInUse_, ++me.inUse_);
+    return block;
+}
+
+void ScenarioFramePool::release(void *frame, size_t bytes)
+{
+    ScenarioFramePool &me = pool();
+
+    if (bytes > BLOCK_BYTES)
+    {
+        ::operator delete(frame);
+        return;
+    }
+
+    Block *block = static_cast<Block *>(frame);
+    block->next  = me.free_;
+    me.free_     = block;
+    --me.inUse_;
+}
+
+//---------- Struct Scenario::promise_type Implementation ---------------------
+
+void Scenario::promise_type::return_void()
+{
+    car_.engine_.finished(car_);
+}
+
+void Scenario::promise_type::unhandled_exception()
+{
+    // Scenarios report failures with check(); an exception is a bug in the
+    // scenario itself.
+    std::abort();
+}
+
+//---------- Class ScenarioCar Implementation ---------------------------------
+
+ScenarioCar::ScenarioCar(ScenarioEngine &engine, size_t id)
+    : engine_(engine)
+    , id_(id)
+    , ui_(*this)
+    , door_(*this)
+    , drive_(*this)
+    , timer_(*this)
+    , pendingHead_(0)
+    , pendingCount_(0)
+    , waitToken_(0)
+    , timerGeneration_(0)
+    , failure_(nullptr)
+    , fsm_(ui_, door_, drive_, timer_)
+{
+    // Scenarios start from an idle car; the in-service indication at
+    // construction isn't part of any of them.
+    pendingCount_ = 0;
+}
+
+uint64_t ScenarioCar::nowMsec() const
+{
+    return engine_.nowMsec();
+}
+
+bool ScenarioCar::check(bool condition, const char *what)
+{
+    if (!condition && !failure_)
+    {
+        failure_ = what;
+    }
+    return condition;
+}
+
+bool ScenarioCar::arrived()
+{
+    drive_.arrive();
+    return drive_.client()->handleArrived();
+}
+
+void ScenarioCar::record(ScenarioAction::Type type, size_t value)
+{
+    if (pendingCount_ == MAX_PENDING_ACTIONS)
+    {
+        check(false, "too many unexpected commands");
+        return;
+    }
+
+    pending_[(pendingHead_ + pendingCount_++) % MAX_PENDING_ACTIONS] =
+        ScenarioAction{ type, value, engine_.nowMsec() };
+
+    // Resume a waiting scenario from the engine, not from inside the FSM's
+    // state change that issued the command.
+    if (waiter_)
+    {
+        engine_.schedule(engine_.nowMsec(), ScenarioEngine::RESUME, this, waiter_);
+        waiter_ = nullptr;
+        ++waitToken_;
+    }
+}
+
+void ScenarioCar::startTimer(size_t msec)
+{
+    record(ScenarioAction::TIMER_START, msec);
+    engine_.schedule(engine_.nowMsec() + msec, ScenarioEngine::TIMER_EXPIRY, this,
+                     nullptr, ++timerGeneration_);
+}
+
+void ScenarioCar::stopTimer()
+{
+    record(ScenarioAction::TIMER_STOP);
+    ++timerGeneration_;
+}
+
+void ScenarioCar::timerExpired(uint32_t generation)
+{
+    // Restarted or stopped since.
+    if (generation == timerGeneration_)
+    {
+        timer_.client()->handleExpired();
+    }
+}
+
+void ScenarioCar::waitForAction(std::coroutine_handle<> waiter)
+{
+    waiter_ = waiter;
+    engine_.schedule(engine_.nowMsec() + EXPECT_TIMEOUT_MSEC, ScenarioEngine::WAIT_TIMEOUT,
+                     this, nullptr, ++waitToken_);
+}
+
+void ScenarioCar::waitTimedOut(uint32_t token)
+{
+    if (waiter_ && (token == waitToken_))
+    {
+        std::coroutine_handle<> waiter = waiter_;
+
+        waiter_ = nullptr;
+        waiter.resume();
+    }
+}
+
+ScenarioAction ScenarioCar::takeAction(ScenarioAction::Type type)
+{
+    if (pendingCount_ == 0)
+    {
+        check(false, "expected command never issued");
+        return ScenarioAction{ ScenarioAction::NONE, 0, engine_.nowMsec() };
+    }
+
+    ScenarioAction action = pending_[pendingHead_];
+    pendingHead_ = (pendingHead_ + 1) % MAX_PENDING_ACTIONS;
+    --pendingCount_;
+
+    check(action.type == type, "unexpected command");
+    return action;
+}
+
+void ScenarioCar::After::await_suspend(std::coroutine_handle<> waiter)
+{
+    car.engine_.schedule(car.engine_.nowMsec() + msec, ScenarioEngine::RESUME, &car, waiter);
+}
+
+//---------- Class ScenarioEngine Implementation ------------------------------
+
+ScenarioEngine::ScenarioEngine()
+    : now_(0)
+    , sequence_(0)
+    , started_(0)
+    , running_(0)
+    , peakRunning_(0)
+    , passed_(0)
+    , failed_(0)
+    , firstFailure_(nullptr)
+{
+}
+
+ScenarioEngine::~ScenarioEngine()
+{
+    for (ScenarioCar *car : cars_)
+    {
+        delete car;
+    }
+}
+
+ScenarioCar &ScenarioEngine::newCar()
+{
+    cars_.push_back(new ScenarioCar(*this, cars_.size()));
+    return *cars_.back();
+}
+
+void ScenarioEngine::spawn(Scenario scenario)
+{
+    ++started_;
+    peakRunning_ = std::max(peakRunning_, ++running_);
+    schedule(now_, RESUME, &scenario.handle().promise().car_, scenario.handle());
+}
+
+void ScenarioEngine::schedule(uint64_t atMsec, Kind kind, ScenarioCar *car,
+                              std::coroutine_handle<> waiter, uint32_t token)
+{
+    queue_.push_back(Entry{ atMsec, sequence_++, kind, token, car, waiter });
+    std::push_heap(queue_.begin(), queue_.end(), std::greater<Entry>());
+}
+
+void ScenarioEngine::run()
+{
+    while (!queue_.empty())
+    {
+        std::pop_heap(queue_.begin(), queue_.end(), std::greater<Entry>());
+        Entry entry = queue_.back();
+        queue_.pop_back();
+
+        now_ = entry.atMsec;
+        switch (entry.kind)
+        {
+        case RESUME:
+            entry.waiter.resume();
+            break;
+        case TIMER_EXPIRY:
+            entry.car->timerExpired(entry.token);
+            break;
+        case WAIT_TIMEOUT:
+            entry.car->waitTimedOut(entry.token);
+            break;
+        }
+    }
+}
+
+void ScenarioEngine::finished(ScenarioCar &car)
+{
+    --running_;
+
+    // Let the car's timer lapse rather than run the FSM on with no one
+    // watching.
+    ++car.timerGeneration_;
+
+    // Commands the scenario never looked at are a failure too, like an
+    // unsatisfied mock expectation.
+    car.check(car.pendingCount_ == 0, "unexpected command at end");
+
+    if (car.failed())
+    {
+        ++failed_;
+        if (!firstFailure_)
+        {
+            firstFailure_ = &car;
+        }
+    }
+    else
+    {
+        ++passed_;
+    }
+}
@@ -0,0 +1,390 @@
+// Elevator scenario engine: FSM scenarios written as C++20 coroutines, run by
+// the tens of thousands concurrently on a virtual clock.
+//
+// A scenario drives one car. It co_awaits the commands the FSM issues to its
+// components ("door open", "timer started for 5000 ms") and responds with
+// events, or lets virtual time pass so the car's timer expires on its own:
+//
+//     Scenario openDoor(ScenarioCar &car)
+//     {
+//         car.openButton();
+//         co_await car.expect(ScenarioAction::UI_ARRIVED);
+//         co_await car.expect(ScenarioAction::DOOR_OPEN);
+//         ScenarioAction timer = co_await car.expect(ScenarioAction::TIMER_START);
+//         car.check(timer.value == ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC, "door open timeout");
+//         co_await car.after(2000);
+//         car.opened();
+//     }
+//
+// Commands must be expected in the order the FSM issues them; any other
+// command, or none within the expect timeout, fails the scenario. Coroutine
+// frames come from a pool, so running a scenario doesn't touch the heap once
+// the pool has warmed up.
+//
+#ifndef ELEVATOR_SCENARIO_HPP
+#define ELEVATOR_SCENARIO_HPP
+
+#include "elevator-fsm.hpp"
+
+#include <coroutine>
+#include <cstdint>
+#include <vector>
+
+class ScenarioCar;
+class ScenarioEngine;
+
+// A command the FSM issued to one of its components.
+struct ScenarioAction
+{
+    enum Type
+    {
+        NONE,               // No command arrived in time.
+        UI_ARRIVED,
+        UI_IN_SERVICE,
+        UI_OUT_OF_SERVICE,
+        UI_ALARM_ON,
+        UI_ALARM_OFF,
+        UI_HALL_CALL_SKIPPED,
+        DOOR_OPEN,
+        DOOR_CLOSE,
+        DRIVE_GO_TO_FLOOR,
+        DRIVE_STOP,
+        DRIVE_START,
+        TIMER_START,
+        TIMER_STOP,
+    };
+
+    Type     type;
+    size_t   value;     // Floor or timer msec.
+    uint64_t atMsec;    // Virtual time issued.
+};
+
+// Fixed-size blocks for coroutine frames, on a free list carved from slabs.
+// Frames too big for a block fall back to the heap, and are counted.
+class ScenarioFramePool
+{
+public:
+    enum Limits
+    {
+        BLOCK_BYTES = 512,
+        SLAB_BLOCKS = 4096,
+    };
+
+    static void *allocate(size_t bytes);
+    static void  release(void *frame, size_t bytes);
+
+    static size_t inUse()     { return pool().inUse_; }
+    static size_t peakInUse() { return pool().peakInUse_; }
+    static size_t slabs()     { return pool().slabs_.size(); }
+    static size_t fallbacks() { return pool().fallbacks_; }
+
+private:
+    struct Block
+    {
+        Block *next;
+    };
+
+    ScenarioFramePool();
+    ~ScenarioFramePool();
+
+    static ScenarioFramePool &pool();
+
+    Block              *free_;
+    std::vector<void *> slabs_;
+    size_t              inUse_;
+    size_t              peakInUse_;
+    size_t              fallbacks_;
+};
+
+// The coroutine type of a scenario. Its first parameter must be the car it
+// drives. The engine starts it; it destroys itself when it returns.
+class Scenario
+{
+public:
+    struct promise_type
+    {
+        template <typename... Args>
+        promise_type(ScenarioCar &car, Args &&...)
+            : car_(car)
+            {}
+
+        Scenario get_return_object()
+        {
+            return Scenario(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never  final_suspend() noexcept { return {}; }
+        void                return_void();
+        void                unhandled_exception();
+
+        static void *operator new(size_t bytes) { return ScenarioFramePool::allocate(bytes); }
+        static void  operator delete(void *frame, size_t bytes) { ScenarioFramePool::release(frame, bytes); }
+
+        ScenarioCar &car_;
+    };
+
+    explicit Scenario(std::coroutine_handle<promise_type> handle)
+        : handle_(handle)
+        {}
+
+    std::coroutine_handle<promise_type> handle() const { return handle_; }
+
+private:
+    std::coroutine_handle<promise_type> handle_;
+};
+
+// One car under test: an ElevatorFsm with stand-in components that record
+// its commands against the engine's virtual clock.
+class ScenarioCar
+{
+public:
+    enum Limits
+    {
+        MAX_PENDING_ACTIONS = 16,
+        EXPECT_TIMEOUT_MSEC = 120000,  // Longer than any FSM timeout.
+    };
+
+    ScenarioCar(ScenarioEngine &engine, size_t id);
+
+    size_t       id() const { return id_; }
+    ElevatorFsm &fsm() { return fsm_; }
+    uint64_t     nowMsec() const;
+
+    // Awaitables.
+    struct Expect
+    {
+        ScenarioCar          &car;
+        ScenarioAction::Type  type;
+
+        bool           await_ready() const { return car.pendingCount_ > 0; }
+        void           await_suspend(std::coroutine_handle<> waiter) { car.waitForAction(waiter); }
+        ScenarioAction await_resume() { return car.takeAction(type); }
+    };
+
+    struct After
+    {
+        ScenarioCar &car;
+        size_t       msec;
+
+        bool await_ready() const { return msec == 0; }
+        void await_suspend(std::coroutine_handle<> waiter);
+        void await_resume() {}
+    };
+
+    // Wait for the FSM's next command, which must be of this type.
+    Expect expect(ScenarioAction::Type type) { return Expect{ *this, type }; }
+
+    // Let virtual time pass; the car's timer expires on its own meanwhile.
+    After after(size_t msec) { return After{ *this, msec }; }
+
+    // Record a failure unless the condition holds.
+    bool check(bool condition, const char *what);
+
+    bool        failed() const { return failure_ != nullptr; }
+    const char *failure() const { return failure_; }
+
+    // Events, as the components would raise them.
+    bool floorRequest(size_t floor)     { return ui_.client()->handleFloorRequest(floor); }
+    bool hallCall(size_t floor)         { return ui_.client()->handleHallCall(floor); }
+    bool stopList(const size_t *floors, size_t count)
+    {
+        return ui_.client()->handleStopList(floors, count);
+    }
+    bool openButton()                   { return ui_.client()->handleOpenButton(); }
+    bool closeButton()                  { return ui_.client()->handleCloseButton(); }
+    bool stopButton()                   { return ui_.client()->handleStopButton(); }
+    bool restoreService()               { return ui_.client()->handleRestoreService(); }
+    bool opened()                       { return door_.client()->handleOpened(); }
+    bool closed()                       { return door_.client()->handleClosed(); }
+    bool doorFault()                    { return door_.client()->handleDoorFault(); }
+    bool arrived();
+    bool driveFault()                   { return drive_.client()->handleDriveFault(); }
+    bool load(size_t percent)           { return drive_.client()->handleLoad(percent); }
+
+    // Where the stand-in drive reports the car, e.g. after a manual move.
+    void placeCar(size_t floor, bool atFloor) { drive_.place(floor, atFloor); }
+
+private:
+    friend class ScenarioEngine;
+    friend struct Scenario::promise_type;
+
+    class Ui : public ElevatorUiApi
+    {
+    public:
+        explicit Ui(ScenarioCar &car) : car_(car) {}
+
+        ElevatorUiClient *client() { return client_; }
+
+        virtual void arrived(size_t floor)          { car_.record(ScenarioAction::UI_ARRIVED, floor); }
+        virtual void inService()                    { car_.record(ScenarioAction::UI_IN_SERVICE); }
+        virtual void outOfService()                 { car_.record(ScenarioAction::UI_OUT_OF_SERVICE); }
+        virtual void alarmOn()                      { car_.record(ScenarioAction::UI_ALARM_ON); }
+        virtual void alarmOff()                     { car_.record(ScenarioAction::UI_ALARM_OFF); }
+        virtual void hallCallSkipped(size_t floor)  { car_.record(ScenarioAction::UI_HALL_CALL_SKIPPED, floor); }
+
+    private:
+        ScenarioCar &car_;
+    };
+
+    class Door : public ElevatorDoorApi
+    {
+    public:
+        explicit Door(ScenarioCar &car) : car_(car) {}
+
+        ElevatorDoorClient *client() { return client_; }
+
+        virtual void open()  { car_.record(ScenarioAction::DOOR_OPEN); }
+        virtual void close() { car_.record(ScenarioAction::DOOR_CLOSE); }
+
+    private:
+        ScenarioCar &car_;
+    };
+
+    class Drive : public ElevatorDriveApi
+    {
+    public:
+        explicit Drive(ScenarioCar &car)
+            : car_(car)
+            , floor_(ElevatorFsm::GROUND_FLOOR)
+            , target_(ElevatorFsm::GROUND_FLOOR)
+            , atFloor_(true)
+            {}
+
+        ElevatorDriveClient *client() { return client_; }
+
+        void place(size_t floor, bool atFloor) { floor_ = floor; atFloor_ = atFloor; }
+        void arrive() { floor_ = target_; atFloor_ = true; }
+
+        virtual void goToFloor(size_t floor)
+        {
+            target_  = floor;
+            atFloor_ = false;
+            car_.record(ScenarioAction::DRIVE_GO_TO_FLOOR, floor);
+        }
+        virtual void   stop()            { car_.record(ScenarioAction::DRIVE_STOP); }
+        virtual void   start()           { car_.record(ScenarioAction::DRIVE_START); }
+        virtual size_t getFloor() const  { return floor_; }
+        virtual bool   isAtFloor() const { return atFloor_; }
+
+    private:
+        ScenarioCar &car_;
+        size_t       floor_;
+        size_t       target_;
+        bool         atFloor_;
+    };
+
+    class Timer : public ElevatorTimerApi
+    {
+    public:
+        explicit Timer(ScenarioCar &car) : car_(car) {}
+
+        ElevatorTimerClient *client() { return client_; }
+
+        virtual void   start(size_t msec) { car_.startTimer(msec); }
+        virtual void   stop()             { car_.stopTimer(); }
+        virtual size_t nowMsec() const    { return car_.nowMsec(); }
+
+    private:
+        ScenarioCar &car_;
+    };
+
+    void record(ScenarioAction::Type type, size_t value = 0);
+    void startTimer(size_t msec);
+    void stopTimer();
+    void timerExpired(uint32_t generation);
+
+    void           waitForAction(std::coroutine_handle<> waiter);
+    void           waitTimedOut(uint32_t token);
+    ScenarioAction takeAction(ScenarioAction::Type type);
+
+    ScenarioEngine &engine_;
+    size_t          id_;
+
+    Ui    ui_;
+    Door  door_;
+    Drive drive_;
+    Timer timer_;
+
+    ScenarioAction pending_[MAX_PENDING_ACTIONS];
+    size_t         pendingHead_;
+    size_t         pendingCount_;
+
+    std::coroutine_handle<> waiter_;
+    uint32_t                waitToken_;
+    uint32_t                timerGeneration_;
+    const char             *failure_;
+
+    // Last: its constructor already issues commands.
+    ElevatorFsm fsm_;
+};
+
+// Runs scenarios on a shared virtual clock, in time order.
+class ScenarioEngine
+{
+public:
+    ScenarioEngine();
+    ~ScenarioEngine();
+
+    // A car for a scenario to drive; the engine owns it.
+    ScenarioCar &newCar();
+
+    // Start the scenario at the current virtual time.
+    void spawn(Scenario scenario);
+
+    // Run until every scenario has finished.
+    void run();
+
+    uint64_t nowMsec() const { return now_; }
+    size_t   started() const { return started_; }
+    size_t   passed() const { return passed_; }
+    size_t   failed() const { return failed_; }
+    size_t   peakRunning() const { return peakRunning_; }
+
+    // The first failing car, for reporting.
+    const ScenarioCar *firstFailure() const { return firstFailure_; }
+
+private:
+    friend class ScenarioCar;
+    friend struct Scenario::promise_type;
+
+    enum Kind
+    {
+        RESUME,
+        TIMER_EXPIRY,
+        WAIT_TIMEOUT,
+    };
+
+    struct Entry
+    {
+        uint64_t                atMsec;
+        uint64_t                sequence;   // FIFO among equal times.
+        Kind                    kind;
+        uint32_t                token;      // Timer generation or wait token.
+        ScenarioCar            *car;
+        std::coroutine_handle<> waiter;
+
+        bool operator>(const Entry &other) const
+        {
+            return (atMsec != other.atMsec) ? (atMsec > other.atMsec)
+                                            : (sequence > other.sequence);
+        }
+    };
+
+    void schedule(uint64_t atMsec, Kind kind, ScenarioCar *car,
+                  std::coroutine_handle<> waiter, uint32_t token = 0);
+    void finished(ScenarioCar &car);
+
+    uint64_t                   now_;
+    uint64_t                   sequence_;
+    std::vector<Entry>         queue_;     // Min-heap.
+    std::vector<ScenarioCar *> cars_;
+    size_t                     started_;
+    size_t                     running_;
+    size_t                     peakRunning_;
+    size_t                     passed_;
+    size_t                     failed_;
+    const ScenarioCar         *firstFailure_;
+};
+
+#endif // ELEVATOR_SCENARIO_HPP
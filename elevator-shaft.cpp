@@ -0,0 +1,125 @@
+// Elevator shaft: lock-free floor interval reservations for two cars sharing
+// a shaft.
+//
+#include "elevator-shaft.hpp"
+
+//---------- Class ElevatorShaft Implementation -------------------------------
+
+ElevatorShaft::ElevatorShaft(size_t topFloor, size_t separationFloors)
+    : topFloor_((topFloor < MAX_FLOOR) ? topFloor : MAX_FLOOR)
+    , separation_(separationFloors)
+    , reservations_(0)
+    , refusals_(0)
+{
+    for (size_t car = 0; car < CARS; ++car)
+    {
+        wanted_[car].store(0, std::memory_order_relaxed);
+    }
+}
+
+bool ElevatorShaft::park(size_t car, size_t floor)
+{
+    if (!hasFloor(floor) || !claim(car, interval(floor, floor)))
+    {
+        return false;
+    }
+    wanted_[car].store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void ElevatorShaft::leave(size_t car)
+{
+    claim(car, 0);
+    wanted_[car].store(0, std::memory_order_relaxed);
+}
+
+bool ElevatorShaft::reserve(size_t car, size_t fromFloor, size_t toFloor)
+{
+    // A floor beyond the shaft would pack into some other interval.
+    if (!hasFloor(fromFloor) || !hasFloor(toFloor))
+    {
+        return false;
+    }
+
+    uint32_t wanted = (fromFloor < toFloor) ? interval(fromFloor, toFloor)
+                                            : interval(toFloor, fromFloor);
+
+    if (!claim(car, wanted))
+    {
+        wanted_[car].store(wanted, std::memory_order_relaxed);
+        refusals_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    wanted_[car].store(0, std::memory_order_relaxed);
+    return true;
+}
+
+void ElevatorShaft::release(size_t car, size_t floor)
+{
+    // Within what the car already holds, so it always fits.
+    if (hasFloor(floor))
+    {
+        claim(car, interval(floor, floor));
+    }
+}
+
+size_t ElevatorShaft::lowest(size_t car) const
+{
+    return low(half(reservations_.load(std::memory_order_acquire), car));
+}
+
+size_t ElevatorShaft::highest(size_t car) const
+{
+    return high(half(reservations_.load(std::memory_order_acquire), car));
+}
+
+size_t ElevatorShaft::yieldFloor(size_t car) const
+{
+    size_t   other  = CARS - 1 - car;
+    uint32_t wanted = wanted_[other].load(std::memory_order_relaxed);
+    uint32_t mine   = half(reservations_.load(std::memory_order_acquire), car);
+
+    if ((wanted == 0) || fits(other, wanted, mine))
+    {
+        return NO_FLOOR;
+    }
+
+    if (car == LOWER_CAR)
+    {
+        return (low(wanted) > separation_) ? (low(wanted) - separation_) : NO_FLOOR;
+    }
+    return (high(wanted) + separation_ <= topFloor_) ? (high(wanted) + separation_) : NO_FLOOR;
+}
+
+bool ElevatorShaft::fits(size_t car, uint32_t mine, uint32_t other) const
+{
+    // A car that isn't in the shaft is in nobody's way.
+    if ((low(mine) == NO_FLOOR) || (low(other) == NO_FLOOR))
+    {
+        return true;
+    }
+
+    return (car == LOWER_CAR) ? (high(mine) + separation_ <= low(other))
+                              : (high(other) + separation_ <= low(mine));
+}
+
+bool ElevatorShaft::claim(size_t car, uint32_t wanted)
+{
+    size_t   other = CARS - 1 - car;
+    uint64_t word  = reservations_.load(std::memory_order_acquire);
+
+    // Only this car changes its own half, but the other car may change its
+    // half in between: check against the word the swap will replace.
+    do
+    {
+        if (!fits(car, wanted, half(word, other)))
+        {
+            return false;
+        }
+    } while (!reservations_.compare_exchange_weak(word, withHalf(word, car, wanted),
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire));
+
+    return true;
+}
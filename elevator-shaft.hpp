@@ -0,0 +1,113 @@
+// Elevator shaft: coordination between two cars sharing one shaft, a lower
+// car and an upper car, as in twin-car installations.
+//
+// Before it moves, a car reserves the interval of floors its trip sweeps, and
+// on arrival it releases all but the floor it stopped at. A reservation is
+// refused if it would bring the car within the separation of the other car's
+// reservation, or past it: the lower car always stays below the upper car.
+// Both cars' intervals are packed into one atomic word, so a reservation is a
+// single compare-and-swap that checks and claims at once, lock-free, and the
+// cars' controllers may run on different threads.
+//
+// A car refused a reservation records what it wanted, so that the other car
+// can get out of its way: yieldFloor() says where to. A car with a trip to
+// make does so itself (see ElevatorFsm::setShaft()); an idle car must be
+// moved by whoever dispatches the cars.
+//
+#ifndef ELEVATOR_SHAFT_HPP
+#define ELEVATOR_SHAFT_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+class ElevatorShaft
+{
+public:
+    explicit ElevatorShaft(size_t topFloor, size_t separationFloors = 1);
+
+    enum Car
+    {
+        LOWER_CAR,
+        UPPER_CAR,
+        CARS,
+    };
+
+    enum Limits
+    {
+        MAX_FLOOR = 0xffff,
+        NO_FLOOR  = 0,      // Floors start at ElevatorFsm::GROUND_FLOOR.
+    };
+
+    // Place a car in the shaft, stationary at a floor. Returns false if the
+    // floor is too close to the other car, or isn't in the shaft.
+    bool park(size_t car, size_t floor);
+
+    // Take a car out of the shaft, e.g. out of service and moved by hand.
+    void leave(size_t car);
+
+    // Replace the car's reservation with the floors between fromFloor and
+    // toFloor. Returns false, leaving its reservation as it was, if the other
+    // car is in the way, or if either floor isn't in the shaft; only the
+    // first counts as a refusal.
+    bool reserve(size_t car, size_t fromFloor, size_t toFloor);
+
+    // The car has stopped at a floor: keep just that floor.
+    void release(size_t car, size_t floor);
+
+    // Is the floor in the shaft, between the first floor and the top?
+    bool hasFloor(size_t floor) const
+    {
+        return (floor > NO_FLOOR) && (floor <= topFloor_);
+    }
+
+    // The car's reserved floors, NO_FLOOR for both if it isn't in the shaft.
+    size_t lowest(size_t car) const;
+    size_t highest(size_t car) const;
+
+    // The nearest floor the car would have to move to, to let the other car
+    // have what it was last refused, or NO_FLOOR if the car isn't in the way
+    // or can't get out of it.
+    size_t yieldFloor(size_t car) const;
+
+    // Is the other car waiting on a reservation this car is in the way of?
+    bool isBlocking(size_t car) const { return yieldFloor(car) != NO_FLOOR; }
+
+    size_t separation() const { return separation_; }
+    size_t refusals() const { return refusals_.load(std::memory_order_relaxed); }
+
+private:
+    // A car's interval: the lowest floor in the low 16 bits and the highest
+    // in the high 16. The shaft word holds the lower car's in its low half.
+    static uint32_t interval(size_t low, size_t high)
+    {
+        return static_cast<uint32_t>(low) | (static_cast<uint32_t>(high) << 16);
+    }
+    static size_t low(uint32_t interval) { return interval & 0xffff; }
+    static size_t high(uint32_t interval) { return interval >> 16; }
+
+    static uint32_t half(uint64_t word, size_t car)
+    {
+        return static_cast<uint32_t>(word >> (car * 32));
+    }
+    static uint64_t withHalf(uint64_t word, size_t car, uint32_t interval)
+    {
+        uint64_t mask = uint64_t(0xffffffff) << (car * 32);
+        return (word & ~mask) | (uint64_t(interval) << (car * 32));
+    }
+
+    // Can the car have the interval, given the other car's?
+    bool fits(size_t car, uint32_t mine, uint32_t other) const;
+
+    // Claim the interval for the car if it fits; otherwise leave the shaft
+    // as it is.
+    bool claim(size_t car, uint32_t wanted);
+
+    size_t                topFloor_;
+    size_t                separation_;
+    std::atomic<uint64_t> reservations_;
+    std::atomic<uint32_t> wanted_[CARS];    // Last refused, 0 once granted.
+    std::atomic<size_t>   refusals_;
+};
+
+#endif // ELEVATOR_SHAFT_HPP
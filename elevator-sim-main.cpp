@@ -0,0 +1,1265 @@
+// Elevator simulator experiments: each compares a control or dispatch policy
+// against the baseline on the same generated traffic.
+//
+// Usage: runSim [experiment...]   (default: all experiments)
+//
+#include "elevator-bench.hpp"
+#include "elevator-fleet.hpp"
+#include "elevator-ingress.hpp"
+#include "elevator-metrics.hpp"
+#include "elevator-sim.hpp"
+#include "elevator-snapshot.hpp"
+#include "elevator-standby.hpp"
+#include "elevator-transition-log.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <sched.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace
+{
+
+const uint64_t MINUTE_MSEC = 60 * 1000;
+const uint32_t SEEDS       = 10;
+
+// Run the same traffic with several seeds so a policy isn't judged on one
+// lucky day; counts are totals over all runs.
+SimStats runSeeds(const SimConfig &config,
+                  const std::vector<SimTraffic> &periods,
+                  uint64_t warmupMsec)
+{
+    SimStats total;
+
+    for (uint32_t seed = 1; seed <= SEEDS; ++seed)
+    {
+        Simulation sim(config, seed);
+        total.add(sim.run(periods, warmupMsec));
+    }
+
+    return total;
+}
+
+void printHeader()
+{
+    printf("%-24s %8s %7s %7s %9s %7s %8s %7s %7s %7s\n",
+           "policy", "HC/5min", "wait s", "p90 s", "journey s",
+           "RTT s", "stops/RT", "stops", "empty", "skipped");
+}
+
+void printStats(const char *policy, const SimStats &stats)
+{
+    printf("%-24s %8.1f %7.1f %7.1f %9.1f %7.1f %8.1f %7zu %7zu %7zu\n",
+           policy, stats.handlingCapacity(), stats.meanWaitSec(),
+           stats.percentileWaitSec(90), stats.meanJourneySec(),
+           stats.meanRoundTripSec(), stats.stopsPerRoundTrip(),
+           stats.stops, stats.emptyStops, stats.hallCallsSkipped);
+}
+
+// Up-peak: morning arrivals at the lobby, with some interfloor and down
+// traffic generating hall calls above the lobby. Arrivals are close to what
+// the bank can carry, so deliveries measure handling capacity.
+void upPeakLoadSkip()
+{
+    std::vector<SimTraffic> upPeak = { { 60 * MINUTE_MSEC, 22.0, 0.80, 0.05 } };
+
+    printf("\nUp-peak, hall-call skipping by load (4 cars, 12 floors, 13 passengers, %u seeds):\n", SEEDS);
+    printHeader();
+
+    for (size_t threshold : { 101, 90, 80, 70 })
+    {
+        SimConfig config;
+        char      policy[32];
+
+        config.fullLoadPercent = threshold;
+        SimStats stats = runSeeds(config, upPeak, 10 * MINUTE_MSEC);
+
+        if (threshold > 100)
+        {
+            snprintf(policy, sizeof(policy), "never skip");
+        }
+        else
+        {
+            snprintf(policy, sizeof(policy), "skip at %zu%% load", threshold);
+        }
+        printStats(policy, stats);
+    }
+}
+
+// Up-peak under destination dispatch versus hall-call collective control,
+// at a moderate load and at saturation.
+void upPeakDestinationDispatch()
+{
+    printf("\nUp-peak, destination dispatch (4 cars, 12 floors, 13 passengers, %u seeds):\n", SEEDS);
+    printHeader();
+
+    for (double rate : { 16.0, 30.0 })
+    {
+        std::vector<SimTraffic> upPeak = { { 60 * MINUTE_MSEC, rate, 0.90, 0.05 } };
+
+        for (bool destination : { false, true })
+        {
+            SimConfig config;
+            char      policy[32];
+
+            config.destinationDispatch = destination;
+            SimStats stats = runSeeds(config, upPeak, 10 * MINUTE_MSEC);
+
+            snprintf(policy, sizeof(policy), "%s %.0f/min",
+                     destination ? "destination" : "collective", rate);
+            printStats(policy, stats);
+        }
+    }
+}
+
+// Kinematic drive: per-trip travel times and derived move timeouts, then
+// dispatching with the drive model's ETA versus a flat time per floor.
+void kinematicDrive()
+{
+    SimConfig config;
+    ElevatorDriveModel model(config.driveProfile, config.floorHeight, config.floors);
+
+    printf("\nKinematic drive (%.1f m/s, %.1f m/s^2, %.1f m/s^3, %.1f m floors):\n",
+           config.driveProfile.speed, config.driveProfile.accel,
+           config.driveProfile.jerk, config.floorHeight);
+    printf("%-8s %9s %10s %10s\n", "floors", "travel s", "timeout s", "flat s");
+    for (size_t floors : { 1, 2, 4, 8, 11 })
+    {
+        printf("%-8zu %9.2f %10.2f %10.2f\n", floors,
+               model.travelMsec(ElevatorFsm::GROUND_FLOOR, ElevatorFsm::GROUND_FLOOR + floors) / 1000.0,
+               model.moveTimeoutMsec(ElevatorFsm::GROUND_FLOOR, ElevatorFsm::GROUND_FLOOR + floors) / 1000.0,
+               ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC / 1000.0);
+    }
+
+    std::vector<SimTraffic> twoWay = { { 60 * MINUTE_MSEC, 16.0, 0.40, 0.40 } };
+
+    printf("\nTwo-way traffic on the kinematic drive (%u seeds):\n", SEEDS);
+    printHeader();
+    config.kinematicDrive = true;
+    for (bool eta : { false, true })
+    {
+        for (bool destination : { false, true })
+        {
+            char policy[32];
+
+            config.etaDispatch         = eta;
+            config.destinationDispatch = destination;
+            snprintf(policy, sizeof(policy), "%s, %s",
+                     destination ? "destination" : "collective",
+                     eta ? "ETA" : "per-floor");
+            printStats(policy, runSeeds(config, twoWay, 10 * MINUTE_MSEC));
+        }
+    }
+}
+
+// Learned timing: two of the four cars are older and 40% slower than their
+// rated profile. Compare dispatching on the rated model's ETA with each car's
+// learned travel times, and show what the slow car learned.
+void learnedTiming()
+{
+    std::vector<SimTraffic> twoWay = { { 60 * MINUTE_MSEC, 16.0, 0.40, 0.40 } };
+    SimConfig config;
+
+    config.kinematicDrive = true;
+    config.etaDispatch    = true;
+    config.slowCars       = 2;
+    config.slowPercent    = 140;
+
+    printf("\nTwo-way traffic, 2 of 4 cars 40%% slow (%u seeds):\n", SEEDS);
+    printHeader();
+    for (bool learned : { false, true })
+    {
+        config.learnedEta = learned;
+        printStats(learned ? "learned ETA" : "rated model ETA",
+                   runSeeds(config, twoWay, 10 * MINUTE_MSEC));
+    }
+
+    Simulation sim(config);
+    sim.run(twoWay, 0);
+
+    const ElevatorTimingCache &slow = sim.car(0).fsm().timing();
+    const ElevatorTimingCache &rated = sim.car(3).fsm().timing();
+    ElevatorDriveModel model(config.driveProfile, config.floorHeight, config.floors);
+
+    printf("\n%-8s %9s %9s %9s %9s\n", "floors", "model s", "rated s", "slow s", "samples");
+    for (size_t floors = 1; floors < config.floors; ++floors)
+    {
+        printf("%-8zu %9.2f %9.2f %9.2f %9zu\n", floors,
+               model.travelMsec(ElevatorFsm::GROUND_FLOOR, ElevatorFsm::GROUND_FLOOR + floors) / 1000.0,
+               rated.travelMsec(floors) / 1000.0, slow.travelMsec(floors) / 1000.0,
+               slow.travelSamples(floors));
+    }
+    printf("door open/close s: rated %.2f/%.2f, slow %.2f/%.2f\n",
+           rated.doorMsec(ElevatorTimingCache::DOOR_OPEN) / 1000.0,
+           rated.doorMsec(ElevatorTimingCache::DOOR_CLOSE) / 1000.0,
+           slow.doorMsec(ElevatorTimingCache::DOOR_OPEN) / 1000.0,
+           slow.doorMsec(ElevatorTimingCache::DOOR_CLOSE) / 1000.0);
+}
+
+// Warm restart: what snapshotting every state change costs, how long a
+// restart from a snapshot takes, and the trip to the ground floor that a cold
+// restart costs instead.
+void snapshotRestart()
+{
+    const char *path  = "elevator-snapshot-bench.bin";
+    const size_t TRIPS = 200000;
+    const size_t CARS  = 4;    // Slots in the file; the bench uses the first.
+    SimConfig    config;
+
+    printf("\nSnapshot write cost (%zu trips, 5 state changes each):\n", TRIPS);
+    printf("%-24s %12s\n", "snapshots", "ns/change");
+
+    ElevatorSnapshotFile file;
+    double openNsec = benchNsec(1, [&](size_t) { file.open(path, CARS); });
+    ElevatorSnapshotSlot memory;
+    memset(&memory, 0, sizeof(memory));
+
+    for (ElevatorSnapshotSlot *slot : { static_cast<ElevatorSnapshotSlot *>(nullptr),
+                                        &memory, file.slot(0) })
+    {
+        BenchCar    car;
+        ElevatorFsm fsm(car.ui, car.door, car.drive, car.timer);
+
+        fsm.setSnapshotSlot(slot);
+        double nsec = benchNsec(TRIPS, [&](size_t trip)
+        {
+            car.trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % (config.floors - 1));
+        });
+        printf("%-24s %12.1f\n",
+               !slot ? "none" : (slot == &memory) ? "memory" : "memory-mapped file",
+               nsec / 5);
+    }
+
+    // Restart from the file, from the snapshot left by the last trip above:
+    // validate it, confirm the position with the drive, and resume.
+    BenchCar restartCar;
+    double restoreNsec = benchNsec(TRIPS, [&](size_t)
+    {
+        ElevatorFsm fsm(restartCar.ui, restartCar.door, restartCar.drive, restartCar.timer,
+                        file.slot(0)->latest());
+    });
+
+    file.close();
+    unlink(path);
+
+    printf("\n%-32s %10.1f us\n", "open and map snapshot file", openNsec / 1000.0);
+    printf("%-32s %10.1f ns\n", "restart one car from snapshot", restoreNsec);
+
+    // A cold restart finds the car and sends it to the ground floor.
+    ElevatorDriveModel model(config.driveProfile, config.floorHeight, config.floors);
+    double travel = 0.0;
+    for (size_t floor = ElevatorFsm::GROUND_FLOOR; floor < ElevatorFsm::GROUND_FLOOR + config.floors; ++floor)
+    {
+        travel += model.travelMsec(floor, ElevatorFsm::GROUND_FLOOR);
+    }
+    printf("%-32s %10.1f s, plus a door cycle\n", "cold restart trip to ground",
+           travel / config.floors / 1000.0);
+}
+
+// Hot standby with local stand-in controllers on two threads: the cost of
+// mirroring each event on the primary, and the time from the primary
+// stopping to the standby driving the car.
+void hotStandby()
+{
+    const size_t TRIPS     = 200000;
+    const size_t FAILOVERS = 5;
+
+    printf("\nHot standby mirroring cost (%zu trips, 5 events each):\n", TRIPS);
+    printf("%-24s %12s %12s %10s %12s\n", "primary", "ns/event", "replay ns", "applied", "divergences");
+
+    // Batches stay well within the queue; a car raises a few events per
+    // second, not millions. The standby drains each batch on this thread so
+    // the two sides are timed separately.
+    const size_t BATCH_TRIPS = ElevatorMirrorChannel::QUEUE_EVENTS / 5 / 2;
+
+    for (bool mirrored : { false, true })
+    {
+        BenchCar              primaryCar;
+        BenchCar              standbyCar;
+        ElevatorFsm           fsm(primaryCar.ui, primaryCar.door, primaryCar.drive, primaryCar.timer);
+        ElevatorMirrorChannel channel;
+        ElevatorStandby       standby(channel, standbyCar.ui, standbyCar.door,
+                                      standbyCar.drive, standbyCar.timer);
+        std::unique_ptr<ElevatorEventMirror> mirror;
+        double primaryNsec = 0.0;
+        double replayNsec  = 0.0;
+
+        if (mirrored)
+        {
+            mirror.reset(new ElevatorEventMirror(fsm, channel, primaryCar.ui, primaryCar.door,
+                                                 primaryCar.drive, primaryCar.timer));
+        }
+
+        for (size_t batch = 0; batch < TRIPS / BATCH_TRIPS; ++batch)
+        {
+            primaryNsec += BATCH_TRIPS * benchNsec(BATCH_TRIPS, [&](size_t trip)
+            {
+                primaryCar.trip(ElevatorFsm::GROUND_FLOOR + 1 + (batch + trip) % 11);
+            });
+            if (mirror)
+            {
+                mirror->heartbeat();
+                replayNsec += benchNsec(1, [&](size_t) { standby.poll(); });
+            }
+        }
+
+        size_t events = TRIPS / BATCH_TRIPS * BATCH_TRIPS * 5;
+        if (mirrored)
+        {
+            printf("%-24s %12.1f %12.1f %10zu %12zu\n", "mirrored", primaryNsec / events,
+                   replayNsec / events, standby.applied(), standby.divergences());
+        }
+        else
+        {
+            printf("%-24s %12.1f %12s %10s %12s\n", "unmirrored", primaryNsec / events, "-", "-", "-");
+        }
+    }
+
+    printf("\nFailover, heartbeat every %d ms, timeout %d ms, standby polling every %d ms:\n",
+           ElevatorStandby::HEARTBEAT_PERIOD_MSEC, ElevatorStandby::HEARTBEAT_TIMEOUT_MSEC,
+           ElevatorStandby::POLL_PERIOD_MSEC);
+
+    double switchMin = 1e9;
+    double switchMax = 0.0;
+    double switchSum = 0.0;
+    double takeOverNsec = 0.0;
+
+    for (size_t run = 0; run < FAILOVERS; ++run)
+    {
+        BenchUi               ui[2];
+        BenchDoor             door[2];
+        BenchDrive            drive[2];
+        BenchClockTimer       timer[2];
+        ElevatorFsm           fsm(ui[0], door[0], drive[0], timer[0]);
+        ElevatorMirrorChannel channel;
+        ElevatorEventMirror   mirror(fsm, channel, ui[0], door[0], drive[0], timer[0]);
+        ElevatorStandby       standby(channel, ui[1], door[1], drive[1], timer[1]);
+        std::atomic<bool>     primaryUp(true);
+
+        std::thread primary([&]()
+        {
+            for (size_t floor = ElevatorFsm::GROUND_FLOOR + 1; primaryUp.load(); ++floor)
+            {
+                ui[0].floorRequest(floor % 12 + 1);
+                drive[0].arrived();
+                mirror.heartbeat();
+                std::this_thread::sleep_for(
+                    std::chrono::milliseconds(ElevatorStandby::HEARTBEAT_PERIOD_MSEC));
+            }
+        });
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(300 + 37 * run));
+        primaryUp.store(false);
+        primary.join();
+        auto failed = std::chrono::steady_clock::now();
+
+        while (!standby.poll())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(ElevatorStandby::POLL_PERIOD_MSEC));
+        }
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - failed;
+
+        switchMin  = std::min(switchMin, elapsed.count());
+        switchMax  = std::max(switchMax, elapsed.count());
+        switchSum += elapsed.count();
+
+        // The takeover itself, once detected.
+        ElevatorStandby again(channel, ui[1], door[1], drive[1], timer[1]);
+        takeOverNsec += benchNsec(1, [&](size_t) { again.takeOver(); });
+    }
+
+    printf("%-32s %8.1f ms min, %.1f mean, %.1f max (door timer %d ms)\n", "primary stop to standby active",
+           switchMin, switchSum / FAILOVERS, switchMax, ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC);
+    printf("%-32s %8.1f us\n", "takeover once detected", takeOverNsec / FAILOVERS / 1000.0);
+}
+
+// Transition history: what logging every state change costs, how compact a
+// season of a bank's history is, and how long the maintenance query for door
+// open failures per car per day takes over it. The log is left for queryLog.
+void transitionLog()
+{
+    const char    *path       = "elevator-transitions-bench.log";
+    const size_t   TRIPS      = 200000;
+    const size_t   CARS       = 8;
+    const size_t   DAYS       = 90;
+    const uint64_t EPOCH_MSEC = 1782864000000ull;    // 2026-07-01 00:00 UTC.
+    const uint64_t DAY_MSEC   = ElevatorTransitionLogReader::DAY_MSEC;
+
+    printf("\nTransition log write cost (%zu trips, 5 state changes each):\n", TRIPS);
+    printf("%-24s %12s\n", "log", "ns/change");
+
+    unlink(path);
+    for (bool logged : { false, true })
+    {
+        BenchCar    car;
+        ElevatorFsm fsm(car.ui, car.door, car.drive, car.timer);
+        std::unique_ptr<ElevatorTransitionLog>      log(new ElevatorTransitionLog);
+        std::unique_ptr<ElevatorTransitionRecorder> recorder;
+
+        if (logged)
+        {
+            log->open(path, EPOCH_MSEC);
+            recorder.reset(new ElevatorTransitionRecorder(*log, 0));
+            fsm.setTransitionObserver(recorder.get());
+        }
+        double nsec = benchNsec(TRIPS, [&](size_t trip)
+        {
+            car.trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+        });
+        printf("%-24s %12.1f\n", logged ? "columnar file" : "none", nsec / 5);
+    }
+
+    // A season of history for a bank: trips from 06:00 to 22:00, every 1 to
+    // 5 minutes, with the door failing to open on 1 trip in 400 and the car
+    // restored to service at the ground floor.
+    std::unique_ptr<ElevatorTransitionLog> log(new ElevatorTransitionLog);
+    std::minstd_rand random(1);
+    size_t           faults[CARS] = {};
+    size_t           textBytes    = 0;
+
+    unlink(path);
+    log->open(path, EPOCH_MSEC);
+    for (size_t id = 0; id < CARS; ++id)
+    {
+        BenchCar                   car;
+        ElevatorFsm                fsm(car.ui, car.door, car.drive, car.timer);
+        ElevatorTransitionRecorder recorder(*log, id);
+
+        fsm.setTransitionObserver(&recorder);
+        for (size_t day = 0; day < DAYS; ++day)
+        {
+            car.timer.advance(day * DAY_MSEC + 6 * 3600 * 1000 - car.timer.nowMsec());
+            while (car.timer.nowMsec() < day * DAY_MSEC + 22 * 3600 * 1000)
+            {
+                size_t floor = ElevatorFsm::GROUND_FLOOR + 1 + random() % 11;
+
+                car.timer.advance(60000 + random() % 240000);
+                if (random() % 400 != 0)
+                {
+                    car.trip(floor);
+                    continue;
+                }
+
+                car.ui.floorRequest(floor);
+                car.timer.advance(5000);
+                car.drive.arrived();
+                car.timer.advance(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC);
+                car.timer.expired();
+                ++faults[id];
+
+                car.timer.advance(3600 * 1000);
+                car.drive.goToFloor(ElevatorFsm::GROUND_FLOOR);
+                car.ui.restoreService();
+                car.door.opened();
+                car.timer.expired();
+                car.door.closed();
+            }
+        }
+    }
+    log->close();
+
+    // A text log line per transition, for comparison.
+    char line[96];
+    textBytes = log->rows() * snprintf(line, sizeof(line),
+                                       "2026-07-01T08:15:02.123Z car=%zu %s->%s floor=%zu\n",
+                                       size_t(3), "Opening", "Waiting", size_t(7));
+
+    size_t totalFaults = 0;
+    for (size_t fault : faults)
+    {
+        totalFaults += fault;
+    }
+
+    printf("\nHistory, %zu cars over %zu days:\n", CARS, DAYS);
+    printf("%-32s %10zu\n", "transitions", log->rows());
+    printf("%-32s %10zu (%zu blocks)\n", "log bytes", log->fileBytes(), log->blocks());
+    printf("%-32s %10.1f\n", "bytes per transition", double(log->fileBytes()) / log->rows());
+    printf("%-32s %10.1f\n", "text log bytes per transition", double(textBytes) / log->rows());
+
+    ElevatorTransitionLogReader reader;
+    ElevatorTransitionLogReader::CarDayCounts counts;
+    size_t read = 0;
+    double openNsec = benchNsec(1, [&](size_t) { reader.open(path); });
+    double countNsec = benchNsec(10, [&](size_t)
+    {
+        counts.clear();
+        read = reader.countPerCarDay(ElevatorFsm::STATE_OPENING, ElevatorFsm::STATE_OUT_OF_SERVICE,
+                                     counts);
+    });
+
+    // Every column of every block, for comparison.
+    std::vector<uint64_t> timeMsec(ElevatorTransitionBlock::MAX_ROWS);
+    std::vector<uint8_t>  from(ElevatorTransitionBlock::MAX_ROWS);
+    std::vector<uint8_t>  to(ElevatorTransitionBlock::MAX_ROWS);
+    std::vector<uint16_t> column(ElevatorTransitionBlock::MAX_ROWS);
+    double decodeNsec = benchNsec(10, [&](size_t)
+    {
+        for (size_t index = 0; index < reader.blocks(); ++index)
+        {
+            reader.times(index, timeMsec.data());
+            reader.states(index, from.data(), to.data());
+            reader.cars(index, column.data());
+            reader.floors(index, column.data());
+        }
+    });
+
+    size_t counted = 0;
+    for (const auto &count : counts)
+    {
+        counted += count.second;
+    }
+
+    printf("\nQuery Opening -> OutOfService per car per day:\n");
+    printf("%-32s %10.1f us\n", "open and index log", openNsec / 1000.0);
+    printf("%-32s %10.1f ms (%zu car-days, %zu of %zu injected)\n", "count",
+           countNsec / 1e6, counts.size(), counted, totalFaults);
+    printf("%-32s %10zu of %zu, state column; time and car where matched\n", "blocks read",
+           read, reader.blocks());
+    printf("%-32s %10.1f ms\n", "decode every column", decodeNsec / 1e6);
+}
+
+// Operations counters: what counting every event and transition costs, with
+// cars on several threads counting into per-thread shards or all into one
+// while a scraper renders the text exposition, and how long a scrape takes.
+void metricsCounters()
+{
+    const size_t TRIPS   = 200000;
+    const size_t THREADS = 4;
+    const size_t CARS    = 500;
+
+    printf("\nCounter overhead (%zu trips, 5 events and 5 state changes each):\n", TRIPS);
+    printf("%-24s %12s\n", "metrics", "ns/event");
+
+    for (bool counted : { false, true })
+    {
+        BenchCar        car;
+        ElevatorFsm     fsm(car.ui, car.door, car.drive, car.timer);
+        ElevatorMetrics metrics(1);
+
+        if (counted)
+        {
+            fsm.setMetrics(&metrics, 0);
+        }
+        double nsec = benchNsec(TRIPS, [&](size_t trip)
+        {
+            car.trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+        });
+        printf("%-24s %12.1f\n", counted ? "counted" : "none", nsec / 5);
+    }
+
+    printf("\n%zu threads of %zu cars each, scraped continuously (%u CPUs):\n",
+           THREADS, CARS / THREADS, std::thread::hardware_concurrency());
+    printf("%-24s %12s %10s %12s\n", "shards", "ns/event", "scrapes", "lost counts");
+
+    for (size_t shards : { size_t(1), size_t(ElevatorMetrics::DEFAULT_SHARDS) })
+    {
+        ElevatorMetrics          metrics(CARS, shards);
+        std::atomic<bool>        running(true);
+        std::atomic<size_t>      scrapes(0);
+        std::vector<std::thread> threads;
+        std::vector<double>      nsec(THREADS);
+
+        std::thread scraper([&]()
+        {
+            std::string text;
+            while (running.load())
+            {
+                metrics.render(text);
+                ++scrapes;
+            }
+        });
+
+        for (size_t thread = 0; thread < THREADS; ++thread)
+        {
+            threads.emplace_back([&, thread]()
+            {
+                std::vector<std::unique_ptr<BenchCar>>    cars;
+                std::vector<std::unique_ptr<ElevatorFsm>> fsms;
+                size_t first = thread * CARS / THREADS;
+
+                for (size_t id = first; id < first + CARS / THREADS; ++id)
+                {
+                    cars.emplace_back(new BenchCar);
+                    fsms.emplace_back(new ElevatorFsm(cars.back()->ui, cars.back()->door,
+                                                      cars.back()->drive, cars.back()->timer));
+                    fsms.back()->setMetrics(&metrics, id);
+                }
+                nsec[thread] = benchNsec(TRIPS / THREADS, [&](size_t trip)
+                {
+                    cars[trip % cars.size()]->trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+                });
+            });
+        }
+        for (std::thread &thread : threads)
+        {
+            thread.join();
+        }
+        running.store(false);
+        scraper.join();
+
+        // Every trip leaves Stopped for Moving once.
+        uint64_t counted = 0;
+        for (size_t car = 0; car < CARS; ++car)
+        {
+            counted += metrics.transitions(car, ElevatorFsm::STATE_STOPPED, ElevatorFsm::STATE_MOVING);
+        }
+
+        double mean = 0.0;
+        for (double thread : nsec)
+        {
+            mean += thread / THREADS;
+        }
+        printf("%-24zu %12.1f %10zu %12llu\n", shards, mean / 5, scrapes.load(),
+               static_cast<unsigned long long>(TRIPS / THREADS * THREADS - counted));
+    }
+
+    // A scrape of a busy fleet.
+    ElevatorMetrics metrics(CARS);
+    for (size_t id = 0; id < CARS; ++id)
+    {
+        BenchCar    car;
+        ElevatorFsm fsm(car.ui, car.door, car.drive, car.timer);
+
+        fsm.setMetrics(&metrics, id);
+        car.trip(ElevatorFsm::GROUND_FLOOR + 1 + id % 11);
+        car.ui.floorRequest(ElevatorFsm::GROUND_FLOOR + 2);
+        car.door.opened();      // Rejected while moving.
+        car.timer.expired();    // Move timeout.
+    }
+
+    std::string text;
+    double renderNsec = benchNsec(20, [&](size_t) { metrics.render(text); });
+    printf("\n%-32s %10.2f ms, %zu bytes\n", "scrape of 500 cars", renderNsec / 1e6, text.size());
+}
+
+// Timer calls the FSM makes at up-peak, restarting the timer on every state
+// entry versus coalescing requests, with passengers who walk in while the
+// doors are open pressing the open button repeatedly. With no slack the
+// traffic results must match restarting exactly.
+void timerCoalescing()
+{
+    const size_t TRIPS = 1000;
+
+    // One car's trips, with the open button pressed every second while the
+    // doors are open, then the dwell left to time out.
+    printf("\nTimer calls per trip (%zu trips, open button pressed every second while waiting):\n", TRIPS);
+    printf("%-24s %8s %8s %8s %8s\n", "timers", "0", "1", "5", "20");
+
+    for (size_t slack : { size_t(-1), size_t(0), size_t(250) })
+    {
+        char policy[32];
+
+        if (slack == size_t(-1))
+        {
+            snprintf(policy, sizeof(policy), "restart");
+        }
+        else
+        {
+            snprintf(policy, sizeof(policy), "coalesce, %zu ms slack", slack);
+        }
+        printf("%-24s", policy);
+
+        for (size_t presses : { 0, 1, 5, 20 })
+        {
+            BenchUi           ui;
+            BenchDoor         door;
+            BenchDrive        drive;
+            BenchVirtualTimer timer;
+            ElevatorFsm       fsm(ui, door, drive, timer);
+
+            fsm.setTimerCoalescing(slack != size_t(-1), (slack != size_t(-1)) ? slack : 0);
+            for (size_t trip = 0; trip < TRIPS; ++trip)
+            {
+                ui.floorRequest(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+                timer.advance(5000);
+                drive.arrived();
+                timer.advance(2000);
+                door.opened();
+                for (size_t press = 0; press < presses; ++press)
+                {
+                    timer.advance(1000);
+                    ui.openButton();
+                }
+                timer.advance(ElevatorFsm::TIMER_WAITING_MSEC);
+                timer.advance(3000);
+                door.closed();
+            }
+            printf(" %8.2f", static_cast<double>(timer.calls()) / TRIPS);
+        }
+        printf("\n");
+    }
+
+    std::vector<SimTraffic> upPeak = { { 60 * MINUTE_MSEC, 22.0, 0.80, 0.05 } };
+
+    printf("\nUp-peak, timer calls (4 cars, 12 floors, 13 passengers, %u seeds):\n", SEEDS);
+    printf("%-24s %8s %8s %7s %7s %11s %10s\n",
+           "timers", "presses", "HC/5min", "wait s", "stops", "timer calls", "calls/stop");
+
+    for (size_t presses : { 0, 5 })
+    {
+        for (size_t slack : { size_t(-1), size_t(0), size_t(250) })
+        {
+            SimConfig config;
+            char      policy[32];
+
+            config.openButtonPresses = presses;
+            config.coalesceTimers    = (slack != size_t(-1));
+            config.timerSlackMsec    = config.coalesceTimers ? slack : 0;
+            SimStats stats = runSeeds(config, upPeak, 10 * MINUTE_MSEC);
+
+            if (!config.coalesceTimers)
+            {
+                snprintf(policy, sizeof(policy), "restart");
+            }
+            else
+            {
+                snprintf(policy, sizeof(policy), "coalesce, %zu ms slack", slack);
+            }
+            printf("%-24s %8zu %8.1f %7.1f %7zu %11zu %10.2f\n",
+                   policy, presses, stats.handlingCapacity(), stats.meanWaitSec(),
+                   stats.stops, stats.timerCalls,
+                   stats.stops ? static_cast<double>(stats.timerCalls) / stats.stops : 0.0);
+        }
+    }
+}
+
+// Event handling cost on the engine this binary was built with; compare
+// runSim engine with runSimSwitch engine.
+void fsmEngine()
+{
+    const size_t TRIPS = 200000;
+    const size_t CARS  = 500;
+
+#ifdef ELEVATOR_FSM_SWITCH
+    const char *engine = "switch";
+#else
+    const char *engine = "State pattern";
+#endif
+
+    printf("\nFSM engine: %s (%zu trips, 5 events and 5 state changes each):\n", engine, TRIPS);
+    printf("%-24s %12s\n", "workload", "ns/event");
+
+    BenchCar    car;
+    ElevatorFsm fsm(car.ui, car.door, car.drive, car.timer);
+
+    double nsec = benchNsec(TRIPS, [&](size_t trip)
+    {
+        car.trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+    });
+    printf("%-24s %12.1f\n", "one car", nsec / 5);
+
+    // Events the idle car doesn't handle.
+    nsec = benchNsec(TRIPS * 5, [&](size_t event)
+    {
+        if (event & 1)
+        {
+            car.door.opened();
+        }
+        else
+        {
+            car.drive.arrived();
+        }
+    });
+    printf("%-24s %12.1f\n", "rejected", nsec);
+
+    // Cars round robin, so each event finds its car's state cold.
+    std::vector<std::unique_ptr<BenchCar>>    cars;
+    std::vector<std::unique_ptr<ElevatorFsm>> fsms;
+    for (size_t id = 0; id < CARS; ++id)
+    {
+        cars.emplace_back(new BenchCar);
+        fsms.emplace_back(new ElevatorFsm(cars.back()->ui, cars.back()->door,
+                                          cars.back()->drive, cars.back()->timer));
+    }
+    nsec = benchNsec(TRIPS, [&](size_t trip)
+    {
+        cars[trip % CARS]->trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+    });
+    printf("%-24s %12.1f\n", "500 cars round robin", nsec / 5);
+}
+
+// A driver process for one source: posts its events round robin over the
+// cars in batches, flat out or a batch per period, waiting for ring space
+// when the host falls behind.
+void ingressDriver(const char *path, ElevatorIngressRegion::Source source,
+                   size_t cars, size_t events, size_t batch, size_t periodUsec)
+{
+    ElevatorIngressMap map;
+    if (!map.open(path))
+    {
+        _exit(1);
+    }
+
+    ElevatorIngressProducer producer(*map.region(), source);
+    auto                    next = std::chrono::steady_clock::now();
+
+    for (size_t event = 0; event < events; ++event)
+    {
+        size_t car = (event * 7 + source) % cars;
+        bool   posted;
+
+        do
+        {
+            switch (source)
+            {
+            case ElevatorIngressRegion::SOURCE_UI:
+                if (event & 1)
+                {
+                    posted = producer.post(car, ElevatorIngressEvent::CLOSE_BUTTON);
+                }
+                else
+                {
+                    size_t floors[] = { 1 + event % 11, 13 + event % 7, 1 };
+                    posted = producer.postStopList(car, floors, 3);
+                }
+                break;
+            case ElevatorIngressRegion::SOURCE_DOOR:
+                posted = producer.post(car, (event & 1) ? ElevatorIngressEvent::CLOSED
+                                                        : ElevatorIngressEvent::OPENED);
+                break;
+            default:
+                posted = producer.post(car, ElevatorIngressEvent::ARRIVED);
+                break;
+            }
+            if (!posted)
+            {
+                producer.flush();
+                sched_yield();
+            }
+        } while (!posted);
+
+        if ((event + 1) % batch == 0)
+        {
+            producer.flush();
+            if (periodUsec)
+            {
+                next += std::chrono::microseconds(periodUsec);
+                std::this_thread::sleep_until(next);
+            }
+        }
+    }
+    producer.flush();
+    _exit(0);
+}
+
+// Events from UI, door, and drive driver processes to 500 cars in a host
+// process through the shared-memory ingress gateway: throughput flat out,
+// and post-to-handler latency when the host sleeps between batches. The
+// drivers' streams aren't coordinated, so most events find their car in the
+// wrong state and are rejected, which costs the host less than a handled one.
+void ingressGateway()
+{
+    const size_t CARS  = 500;
+    const size_t BATCH = 32;
+
+    struct Run
+    {
+        const char *name;
+        size_t      events;     // Per driver.
+        size_t      periodUsec;
+    };
+    const Run runs[] =
+    {
+        { "flat out",          300000, 0 },
+        { "batch per 1 ms",    32000,  1000 },
+        { "batch per 10 ms",   3200,   10000 },
+    };
+
+    std::string path = (access("/dev/shm", W_OK) == 0) ? "/dev/shm" : "/tmp";
+    path += "/elevator-ingress-bench-" + std::to_string(getpid());
+
+    printf("\nIngress gateway: %zu cars, 3 driver processes, %zu-event batches (%u CPUs):\n",
+           CARS, BATCH, std::thread::hardware_concurrency());
+    printf("%-24s %12s %9s %9s %9s %9s %9s\n",
+           "drivers", "events/s", "p50 us", "p99 us", "p99.9 us", "handled", "sleeps/b");
+
+    for (const Run &run : runs)
+    {
+        ElevatorIngressMap map;
+        if (!map.create(path.c_str(), CARS))
+        {
+            printf("%-24s cannot create %s\n", run.name, path.c_str());
+            return;
+        }
+
+        std::vector<std::unique_ptr<BenchCar>>    cars;
+        std::vector<std::unique_ptr<ElevatorFsm>> fsms;
+        ElevatorIngressGateway                    gateway(*map.region());
+
+        for (size_t id = 0; id < CARS; ++id)
+        {
+            cars.emplace_back(new BenchCar);
+            fsms.emplace_back(new ElevatorFsm(cars.back()->ui, cars.back()->door,
+                                              cars.back()->drive, cars.back()->timer));
+            gateway.attach(id, fsms.back().get());
+        }
+
+        auto  start = std::chrono::steady_clock::now();
+        pid_t drivers[ElevatorIngressRegion::SOURCES];
+        for (size_t source = 0; source < ElevatorIngressRegion::SOURCES; ++source)
+        {
+            drivers[source] = fork();
+            if (drivers[source] == 0)
+            {
+                ingressDriver(path.c_str(), static_cast<ElevatorIngressRegion::Source>(source),
+                              CARS, run.events, BATCH, run.periodUsec);
+            }
+        }
+
+        // Give up on events from a driver that died after a second of
+        // silence.
+        size_t total = run.events * ElevatorIngressRegion::SOURCES;
+        size_t idle  = 0;
+        while ((gateway.routed() < total) && (idle < 10))
+        {
+            idle = gateway.wait(100) ? 0 : idle + 1;
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        for (pid_t driver : drivers)
+        {
+            waitpid(driver, nullptr, 0);
+        }
+        map.close();
+        unlink(path.c_str());
+
+        printf("%-24s %12.0f %9.1f %9.1f %9.1f %8.0f%% %9.2f\n", run.name,
+               gateway.routed() / elapsed.count(),
+               gateway.latencyNsec(50) / 1e3, gateway.latencyNsec(99) / 1e3,
+               gateway.latencyNsec(99.9) / 1e3,
+               100.0 * (gateway.routed() - gateway.rejected()) / gateway.routed(),
+               double(gateway.sleeps()) / (total / BATCH));
+        if (gateway.routed() < total)
+        {
+            printf("%-24s %zu events lost\n", "", total - gateway.routed());
+        }
+    }
+}
+
+// Twin cars: the same four shafts with one car each and with two, under
+// destination dispatch, for up-peak and two-way traffic past what a single
+// car per shaft can carry. Counts the reservations the shafts refused, each
+// a car held or reordered rather than moving into the other's way.
+void twinCarShafts()
+{
+    const size_t shafts = 4;
+
+    printf("\nTwin cars (%zu shafts, 12 floors, 13 passengers, destination dispatch, %u seeds):\n",
+           shafts, SEEDS);
+    printf("%-24s %8s %7s %7s %9s %7s %8s %9s\n",
+           "policy", "HC/5min", "wait s", "p90 s", "journey s", "stops", "empty", "refusals");
+
+    const struct
+    {
+        const char *name;
+        SimTraffic  traffic;
+    } patterns[] =
+    {
+        { "up-peak",  { 60 * MINUTE_MSEC, 40.0, 0.90, 0.05 } },
+        { "two-way",  { 60 * MINUTE_MSEC, 40.0, 0.40, 0.40 } },
+    };
+
+    for (const auto &pattern : patterns)
+    {
+        for (size_t carsPerShaft : { 1, 2 })
+        {
+            SimConfig config;
+            SimStats  total;
+            size_t    refusals = 0;
+            char      policy[32];
+
+            config.cars                = shafts * carsPerShaft;
+            config.carsPerShaft        = carsPerShaft;
+            config.destinationDispatch = true;
+
+            for (uint32_t seed = 1; seed <= SEEDS; ++seed)
+            {
+                Simulation sim(config, seed);
+
+                total.add(sim.run({ pattern.traffic }, 10 * MINUTE_MSEC));
+                for (size_t car = 0; car < config.cars; car += ElevatorShaft::CARS)
+                {
+                    refusals += sim.shaft(car) ? sim.shaft(car)->refusals() : 0;
+                }
+            }
+
+            snprintf(policy, sizeof(policy), "%s, %s", pattern.name,
+                     (carsPerShaft > 1) ? "twin" : "single");
+            printf("%-24s %8.1f %7.1f %7.1f %9.1f %7zu %8zu %9zu\n",
+                   policy, total.handlingCapacity(), total.meanWaitSec(),
+                   total.percentileWaitSec(90), total.meanJourneySec(),
+                   total.stops, total.emptyStops, refusals);
+        }
+    }
+}
+
+// Traffic modes: a synthetic weekday, from the quiet of the night through
+// the morning up-peak, lunch, and the evening down-peak, with the bank's
+// policies fixed and switched by the online traffic classifier. Waits for
+// the whole day, and for passengers arriving in each of the busy periods.
+void trafficModes()
+{
+    const uint64_t HOUR_MSEC = 60 * MINUTE_MSEC;
+    const std::vector<SimTraffic> day =
+    {
+        { 6 * HOUR_MSEC,        0.3,  0.30, 0.30 },     // 00:00 night
+        { 3 * HOUR_MSEC / 2,    4.0,  0.70, 0.10 },     // 06:00 early
+        { 2 * HOUR_MSEC,        24.0, 0.85, 0.05 },     // 07:30 up-peak
+        { 2 * HOUR_MSEC,        8.0,  0.35, 0.35 },     // 09:30 morning
+        { 2 * HOUR_MSEC,        18.0, 0.45, 0.45 },     // 11:30 lunch
+        { 3 * HOUR_MSEC,        8.0,  0.30, 0.30 },     // 13:30 afternoon
+        { 2 * HOUR_MSEC,        22.0, 0.05, 0.85 },     // 16:30 down-peak
+        { 5 * HOUR_MSEC / 2,    4.0,  0.20, 0.60 },     // 18:30 evening
+        { 3 * HOUR_MSEC,        0.5,  0.30, 0.30 },     // 21:00 late
+    };
+    const struct
+    {
+        const char *name;
+        size_t      first;      // Periods measured.
+        size_t      last;
+    } windows[] =
+    {
+        { "whole day",  0, 8 },
+        { "up-peak",    2, 2 },
+        { "lunch",      4, 4 },
+        { "down-peak",  6, 6 },
+    };
+
+    printf("\nTraffic modes over a day (4 cars, 12 floors, 13 passengers, %u seeds):\n", SEEDS);
+    printf("%-24s %8s %7s %7s %9s %7s %7s\n",
+           "policy", "HC/5min", "wait s", "p90 s", "journey s", "stops", "empty");
+
+    SimStats switched;
+
+    for (const auto &window : windows)
+    {
+        // Run the day up to the end of the window, measuring passengers who
+        // arrive from its start.
+        std::vector<SimTraffic> periods(day.begin(), day.begin() + window.last + 1);
+        uint64_t warmup = 0;
+
+        for (size_t period = 0; period < window.first; ++period)
+        {
+            warmup += day[period].durationMsec;
+        }
+
+        for (bool modes : { false, true })
+        {
+            SimConfig config;
+            char      policy[32];
+
+            config.trafficModes = modes;
+            SimStats stats = runSeeds(config, periods, warmup);
+
+            snprintf(policy, sizeof(policy), "%s, %s", window.name, modes ? "switched" : "fixed");
+            printf("%-24s %8.1f %7.1f %7.1f %9.1f %7zu %7zu\n",
+                   policy, stats.handlingCapacity(), stats.meanWaitSec(),
+                   stats.percentileWaitSec(90), stats.meanJourneySec(),
+                   stats.stops, stats.emptyStops);
+            if (modes && (window.last == day.size() - 1))
+            {
+                switched = stats;
+            }
+        }
+    }
+
+    printf("\nTime in each mode, switched (%zu switches a day):\n", switched.modeSwitches / SEEDS);
+    for (size_t mode = 0; mode < ElevatorTrafficClassifier::MODES; ++mode)
+    {
+        printf("%-24s %7.1f h\n",
+               ElevatorTrafficClassifier::modeName(static_cast<ElevatorTrafficClassifier::Mode>(mode)),
+               switched.modeMsec[mode] / static_cast<double>(SEEDS) / HOUR_MSEC);
+    }
+}
+
+// Energy: dispatch trading wait against the energy of each car's runs, at
+// increasing weights, under collective control and destination dispatch,
+// with a regenerative drive and without. A light car going up, or a heavy one
+// going down, regenerates, so the dispatcher favours such cars.
+void energyDispatch()
+{
+    printf("\nEnergy-weighted dispatch (4 cars, 12 floors, 13 passengers, two-way, %u seeds):\n",
+           SEEDS);
+    printf("%-32s %8s %7s %7s %7s %7s %9s %8s %7s\n",
+           "policy", "HC/5min", "wait s", "p50 s", "p90 s", "p99 s", "journey s",
+           "kWh/pass", "regen%");
+
+    const struct
+    {
+        const char *name;
+        SimTraffic  traffic;
+    } patterns[] =
+    {
+        { "light",  { 60 * MINUTE_MSEC, 8.0,  0.40, 0.40 } },
+        { "busy",   { 60 * MINUTE_MSEC, 20.0, 0.40, 0.40 } },
+    };
+
+    for (const auto &pattern : patterns)
+    {
+        for (bool destination : { false, true })
+        {
+            for (bool regen : { true, false })
+            {
+                for (size_t msecPerWh : { 0, 500, 2000 })
+                {
+                    SimConfig config;
+                    char      policy[48];
+
+                    config.destinationDispatch = destination;
+                    config.energyMsecPerWh     = msecPerWh;
+                    if (!regen)
+                    {
+                        config.energyProfile.regenPercent = 0.0;
+                    }
+
+                    SimStats stats = runSeeds(config, { pattern.traffic }, 10 * MINUTE_MSEC);
+                    double   drawnWh = stats.energyWh + stats.regeneratedWh;
+
+                    snprintf(policy, sizeof(policy), "%s, %s, %s, %zu ms/Wh", pattern.name,
+                             destination ? "DD" : "coll", regen ? "regen" : "plain", msecPerWh);
+                    printf("%-32s %8.1f %7.1f %7.1f %7.1f %7.1f %9.1f %8.4f %7.1f\n",
+                           policy, stats.handlingCapacity(), stats.meanWaitSec(),
+                           stats.percentileWaitSec(50), stats.percentileWaitSec(90),
+                           stats.percentileWaitSec(99), stats.meanJourneySec(),
+                           stats.kWhPerPassenger(),
+                           drawnWh ? (100.0 * stats.regeneratedWh / drawnWh) : 0.0);
+                }
+            }
+        }
+    }
+}
+
+// Fleet construction: 100k bench cars built one heap allocation at a time,
+// FSM and components apart, and as an ElevatorFleet in one cache-aligned
+// arena. Startup and teardown wall time, then trips round robin over every
+// car, and to cars in random order, so each event finds its car cold.
+template <typename Fleet>
+void fleetRun(const char *name, size_t bytesPerCar,
+              const std::vector<uint32_t> &order, Fleet build)
+{
+    const size_t CARS  = 100000;
+    const size_t TRIPS = 1000000;
+
+    auto start  = std::chrono::steady_clock::now();
+    auto fleet  = build(CARS);
+    std::chrono::duration<double, std::milli> startup = std::chrono::steady_clock::now() - start;
+
+    double roundRobin = benchNsec(TRIPS, [&](size_t trip)
+    {
+        fleet->car(trip % CARS).trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+    });
+    double random = benchNsec(TRIPS, [&](size_t trip)
+    {
+        fleet->car(order[trip]).trip(ElevatorFsm::GROUND_FLOOR + 1 + trip % 11);
+    });
+
+    start = std::chrono::steady_clock::now();
+    fleet.reset();
+    std::chrono::duration<double, std::milli> teardown = std::chrono::steady_clock::now() - start;
+
+    // Five events a trip.
+    printf("%-24s %9zu %10.1f %11.1f %13.2f %13.2f\n",
+           name, bytesPerCar, startup.count(), teardown.count(),
+           5e3 / roundRobin, 5e3 / random);
+}
+
+// Cars each built with their own allocations, as they are one at a time.
+struct HeapFleet
+{
+    explicit HeapFleet(size_t count)
+    {
+        cars.reserve(count);
+        fsms.reserve(count);
+        for (size_t id = 0; id < count; ++id)
+        {
+            cars.emplace_back(new BenchCar);
+            fsms.emplace_back(new ElevatorFsm(cars.back()->ui, cars.back()->door,
+                                              cars.back()->drive, cars.back()->timer));
+        }
+    }
+
+    BenchCar &car(size_t id) { return *cars[id]; }
+
+    std::vector<std::unique_ptr<BenchCar>>    cars;
+    std::vector<std::unique_ptr<ElevatorFsm>> fsms;
+};
+
+void fleetConstruction()
+{
+    const size_t CARS  = 100000;
+    const size_t TRIPS = 1000000;
+
+    printf("\nFleet construction (100k cars, %zu trips, 5 events each):\n", TRIPS);
+    printf("%-24s %9s %10s %11s %13s %13s\n",
+           "fleet", "bytes/car", "startup ms", "teardown ms", "M events/s RR", "M events/s rnd");
+
+    std::mt19937                            random(1);
+    std::uniform_int_distribution<uint32_t> pick(0, CARS - 1);
+    std::vector<uint32_t>                   order(TRIPS);
+    for (uint32_t &car : order)
+    {
+        car = pick(random);
+    }
+
+    fleetRun("heap, car by car", sizeof(BenchCar) + sizeof(ElevatorFsm), order, [](size_t cars)
+    {
+        return std::unique_ptr<HeapFleet>(new HeapFleet(cars));
+    });
+    fleetRun("arena", ElevatorFleet<BenchCar>::slotBytes(), order, [](size_t cars)
+    {
+        return std::unique_ptr<ElevatorFleet<BenchCar>>(new ElevatorFleet<BenchCar>(cars));
+    });
+}
+
+struct Experiment
+{
+    const char *name;
+    void      (*run)();
+};
+
+const Experiment experiments[] =
+{
+    { "load-skip",      upPeakLoadSkip },
+    { "destination",    upPeakDestinationDispatch },
+    { "kinematic",      kinematicDrive },
+    { "learned",        learnedTiming },
+    { "snapshot",       snapshotRestart },
+    { "standby",        hotStandby },
+    { "transition-log", transitionLog },
+    { "metrics",        metricsCounters },
+    { "timer",          timerCoalescing },
+    { "engine",         fsmEngine },
+    { "ingress",        ingressGateway },
+    { "twin",           twinCarShafts },
+    { "modes",          trafficModes },
+    { "energy",         energyDispatch },
+    { "fleet",          fleetConstruction },
+};
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    for (const Experiment &experiment : experiments)
+    {
+        bool selected = (argc < 2);
+
+        for (int arg = 1; arg < argc; ++arg)
+        {
+            selected = selected || (strcmp(argv[arg], experiment.name) == 0);
+        }
+
+        if (selected)
+        {
+            experiment.run();
+        }
+    }
+
+    return 0;
+}
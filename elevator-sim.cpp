@@ -0,0 +1,977 @@
+// Elevator simulator: discrete-event simulation of a bank of ElevatorFsm cars.
+//
+#include "elevator-sim.hpp"
+#include "elevator-snapshot.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+//---------- Struct SimStats Implementation -----------------------------------
+
+double SimStats::meanWaitSec() const
+{
+    if (waitMsec.empty())
+    {
+        return 0.0;
+    }
+
+    double total = 0.0;
+    for (uint64_t wait : waitMsec)
+    {
+        total += wait;
+    }
+    return total / waitMsec.size() / 1000.0;
+}
+
+double SimStats::percentileWaitSec(double percentile) const
+{
+    if (waitMsec.empty())
+    {
+        return 0.0;
+    }
+
+    std::vector<uint64_t> sorted(waitMsec);
+    size_t index = static_cast<size_t>(percentile / 100.0 * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+    return sorted[index] / 1000.0;
+}
+
+double SimStats::meanJourneySec() const
+{
+    if (journeyMsec.empty())
+    {
+        return 0.0;
+    }
+
+    double total = 0.0;
+    for (uint64_t journey : journeyMsec)
+    {
+        total += journey;
+    }
+    return total / journeyMsec.size() / 1000.0;
+}
+
+double SimStats::meanRoundTripSec() const
+{
+    return roundTrips ? (roundTripMsec / 1000.0 / roundTrips) : 0.0;
+}
+
+double SimStats::stopsPerRoundTrip() const
+{
+    return roundTrips ? (static_cast<double>(roundTripStops) / roundTrips) : 0.0;
+}
+
+double SimStats::handlingCapacity() const
+{
+    return measuredMsec ? (delivered * 300000.0 / measuredMsec) : 0.0;
+}
+
+double SimStats::kWhPerPassenger() const
+{
+    return delivered ? (energyWh / 1000.0 / delivered) : 0.0;
+}
+
+void SimStats::add(const SimStats &other)
+{
+    arrived          += other.arrived;
+    delivered        += other.delivered;
+    stops            += other.stops;
+    emptyStops       += other.emptyStops;
+    hallCallsSkipped += other.hallCallsSkipped;
+    timerCalls       += other.timerCalls;
+    measuredMsec     += other.measuredMsec;
+    roundTrips       += other.roundTrips;
+    roundTripStops   += other.roundTripStops;
+    roundTripMsec    += other.roundTripMsec;
+    modeSwitches     += other.modeSwitches;
+    runs             += other.runs;
+    energyWh         += other.energyWh;
+    regeneratedWh    += other.regeneratedWh;
+    for (size_t mode = 0; mode < ElevatorTrafficClassifier::MODES; ++mode)
+    {
+        modeMsec[mode] += other.modeMsec[mode];
+    }
+    waitMsec.insert(waitMsec.end(), other.waitMsec.begin(), other.waitMsec.end());
+    journeyMsec.insert(journeyMsec.end(), other.journeyMsec.begin(), other.journeyMsec.end());
+}
+
+//---------- Class SimCar Implementation --------------------------------------
+
+SimCar::SimCar(Simulation &sim, size_t id)
+    : sim_(sim)
+    , id_(id)
+    , direction_(1)
+    , dwellGeneration_(0)
+    , lobby_(ElevatorFsm::GROUND_FLOOR)
+    , lobbyMsec_(0)
+    , holdUntilMsec_(0)
+    , stopsAway_(0)
+    , ui_(*this)
+    , door_(*this)
+    , drive_(*this)
+    , timer_(*this)
+    , fsm_(ui_, door_, drive_, timer_)
+    , shaft_(sim.shaft(id))
+    , shaftCar_(id % ElevatorShaft::CARS)
+    , carCalls_(sim.config().floors + 1, false)
+    , hallCalls_(sim.config().floors + 1, false)
+    , skipped_(sim.config().floors + 1, false)
+{
+    fsm_.setFullLoadThreshold(sim.config().fullLoadPercent);
+    fsm_.setDriveModel(sim.driveModel());
+    fsm_.setTimerCoalescing(sim.config().coalesceTimers, sim.config().timerSlackMsec);
+
+    if (shaft_)
+    {
+        if (shaftCar_ == ElevatorShaft::UPPER_CAR)
+        {
+            // Start the upper car at the upper lobby level, as though the
+            // controller had restarted with it stopped there.
+            ElevatorSnapshot image = {};
+
+            lobby_         = ElevatorFsm::GROUND_FLOOR + 1;
+            drive_.floor_  = lobby_;
+            drive_.target_ = lobby_;
+
+            image.currentFloor     = static_cast<uint16_t>(lobby_);
+            image.destinationFloor = static_cast<uint16_t>(lobby_);
+            image.state            = ElevatorFsm::STATE_STOPPED;
+            image.seal(1);
+            fsm_.recover(&image);
+        }
+        fsm_.setShaft(shaft_, shaftCar_);
+    }
+}
+
+size_t SimCar::pendingStops() const
+{
+    size_t stops = 0;
+
+    for (size_t floor = ElevatorFsm::GROUND_FLOOR; floor < carCalls_.size(); ++floor)
+    {
+        if (carCalls_[floor] || hallCalls_[floor])
+        {
+            ++stops;
+        }
+    }
+
+    return stops;
+}
+
+bool SimCar::isDoorOpenAt(size_t floor) const
+{
+    return fsm_.isWaiting() && (drive_.floor_ == floor);
+}
+
+bool SimCar::hasRoom() const
+{
+    return passengers_.size() < sim_.config().capacity;
+}
+
+void SimCar::assignHallCall(size_t floor)
+{
+    hallCalls_[floor] = true;
+    sim_.schedule(0, [this]{ service(); });
+}
+
+void SimCar::board(const SimPassenger &passenger)
+{
+    passengers_.push_back(passenger);
+    passengers_.back().boardMsec = sim_.now();
+    carCalls_[passenger.destination] = true;
+}
+
+void SimCar::extendDwell()
+{
+    uint64_t delay = sim_.config().transferMsec;
+
+    // Walking in doesn't cut short a hold at the lobby.
+    if ((holdUntilMsec_ > sim_.now() + delay) && hasRoom())
+    {
+        delay = holdUntilMsec_ - sim_.now();
+    }
+
+    reportLoad();
+    closeAfter(delay);
+
+    for (size_t press = 0; press < sim_.config().openButtonPresses; ++press)
+    {
+        sim_.schedule(press * sim_.config().openButtonMsec, [this] { ui_.openButton(); });
+    }
+}
+
+void SimCar::service()
+{
+    if (sim_.isDestinationDispatch())
+    {
+        if (fsm_.isIdle())
+        {
+            sendStops();
+        }
+        if (fsm_.isIdle())
+        {
+            park();
+        }
+    }
+    else
+    {
+        serviceConventional();
+    }
+}
+
+void SimCar::sendStops()
+{
+    size_t stops[ElevatorFsm::MAX_STOPS];
+    size_t count = sim_.dispatcher().stopList(id_, drive_.target_, direction_,
+                                              stops, ElevatorFsm::MAX_STOPS);
+
+    // An idle car with nothing to do needs no list; a busy one gets an empty
+    // list to drop stops that are no longer needed.
+    if (fsm_.isInService() && ((count > 0) || !fsm_.isIdle()))
+    {
+        ui_.stopList(stops, count);
+    }
+}
+
+void SimCar::yieldShaft()
+{
+    size_t floor = shaft_ ? shaft_->yieldFloor(shaftCar_) : ElevatorShaft::NO_FLOOR;
+
+    // The other car is held until this one gets out of its way.
+    if (fsm_.isIdle() && (floor != ElevatorShaft::NO_FLOOR))
+    {
+        ui_.floorRequest(floor);
+    }
+}
+
+void SimCar::serviceConventional()
+{
+    while (fsm_.isIdle())
+    {
+        // Collective control: the nearest stop in the direction of travel,
+        // reversing when there are none left ahead.
+        size_t here   = drive_.floor_;
+        size_t target = orderedStop();
+
+        for (int pass = 0; (pass < 2) && (target == 0); ++pass)
+        {
+            size_t best = SIZE_MAX;
+
+            for (size_t floor = ElevatorFsm::GROUND_FLOOR; floor < carCalls_.size(); ++floor)
+            {
+                bool ahead    = (direction_ > 0) ? (floor >= here) : (floor <= here);
+                bool stopping = carCalls_[floor] || (hallCalls_[floor] && !skipped_[floor]);
+                size_t distance = (floor > here) ? (floor - here) : (here - floor);
+
+                if (ahead && stopping && (distance < best))
+                {
+                    best   = distance;
+                    target = floor;
+                }
+            }
+
+            if (target == 0)
+            {
+                direction_ = -direction_;
+            }
+        }
+
+        if (target == 0)
+        {
+            park();
+            return;
+        }
+
+        if (target != here)
+        {
+            direction_ = (target > here) ? 1 : -1;
+        }
+
+        if (carCalls_[target])
+        {
+            ui_.floorRequest(target);
+        }
+        else
+        {
+            // A skipped call is handed back and the car remains idle, so
+            // go around again for the next stop.
+            ui_.hallCall(target);
+        }
+    }
+}
+
+size_t SimCar::orderedStop() const
+{
+    if (!passengers_.empty())
+    {
+        return 0;
+    }
+
+    switch (sim_.policy().ordering)
+    {
+    case ElevatorTrafficPolicy::ORDER_LOBBY_FIRST:
+        return (hallCalls_[lobby_] && !skipped_[lobby_]) ? lobby_ : 0;
+
+    case ElevatorTrafficPolicy::ORDER_TOP_DOWN:
+        for (size_t floor = hallCalls_.size() - 1; floor >= ElevatorFsm::GROUND_FLOOR; --floor)
+        {
+            if (hallCalls_[floor] && !skipped_[floor])
+            {
+                return floor;
+            }
+        }
+        return 0;
+
+    default:
+        return 0;
+    }
+}
+
+void SimCar::park()
+{
+    size_t floor = sim_.parkingFloor(*this);
+
+    if ((floor != 0) && (floor != drive_.floor_) && fsm_.isInService())
+    {
+        ui_.floorRequest(floor);
+    }
+}
+
+void SimCar::onDoorsOpened()
+{
+    size_t floor     = drive_.floor_;
+    size_t transfers = passengers_.size();
+
+    auto alighting = std::partition(passengers_.begin(), passengers_.end(),
+        [floor](const SimPassenger &passenger) { return passenger.destination != floor; });
+    for (auto passenger = alighting; passenger != passengers_.end(); ++passenger)
+    {
+        sim_.delivered(*passenger);
+    }
+    passengers_.erase(alighting, passengers_.end());
+    transfers -= passengers_.size();
+
+    if (sim_.isDestinationDispatch())
+    {
+        sim_.dispatcher().alighted(id_, floor, transfers);
+    }
+
+    // Round trips run from one lobby stop to the next one after serving
+    // other floors.
+    if (floor == lobby_)
+    {
+        if (stopsAway_ > 0)
+        {
+            sim_.roundTrip(sim_.now() - lobbyMsec_, stopsAway_);
+        }
+        lobbyMsec_ = sim_.now();
+        stopsAway_ = 0;
+    }
+    else
+    {
+        ++stopsAway_;
+    }
+
+    carCalls_[floor]  = false;
+    hallCalls_[floor] = false;
+
+    size_t before = passengers_.size();
+    sim_.boardWaiting(*this, floor);
+    transfers += passengers_.size() - before;
+
+    sim_.stopped(transfers == 0);
+    reportLoad();
+    if (sim_.isDestinationDispatch())
+    {
+        sendStops();
+    }
+
+    // Under up-peak the bank holds the doors at the lobby for more
+    // passengers to fill the car.
+    uint64_t dwell     = std::max<uint64_t>(transfers, 1) * sim_.config().transferMsec;
+    uint64_t lobbyHold = (floor == lobby_) ? sim_.policy().lobbyDwellMsec : 0;
+
+    holdUntilMsec_ = 0;
+    if ((lobbyHold > dwell) && hasRoom())
+    {
+        dwell          = lobbyHold;
+        holdUntilMsec_ = sim_.now() + dwell;
+    }
+    closeAfter(dwell);
+}
+
+void SimCar::reportLoad()
+{
+    drive_.load(passengers_.size() * 100 / sim_.config().capacity);
+    std::fill(skipped_.begin(), skipped_.end(), false);
+    sim_.loadChanged(*this);
+}
+
+void SimCar::closeAfter(uint64_t delayMsec)
+{
+    uint64_t generation = ++dwellGeneration_;
+
+    sim_.schedule(delayMsec, [this, generation]
+    {
+        if (generation == dwellGeneration_)
+        {
+            ui_.closeButton();
+        }
+    });
+}
+
+//---------- Class SimCar::Ui Implementation ----------------------------------
+
+void SimCar::Ui::hallCallSkipped(size_t floor)
+{
+    car_.hallCalls_[floor] = false;
+    car_.skipped_[floor]   = true;
+    car_.sim_.hallCallSkipped(floor, car_);
+}
+
+//---------- Class SimCar::Door Implementation --------------------------------
+
+void SimCar::Door::open()
+{
+    car_.sim_.schedule(car_.sim_.config().doorOpenMsec, [this]
+    {
+        if (client_->handleOpened())
+        {
+            car_.onDoorsOpened();
+        }
+    });
+}
+
+void SimCar::Door::close()
+{
+    car_.sim_.schedule(car_.sim_.config().doorCloseMsec, [this]
+    {
+        client_->handleClosed();
+        car_.service();
+    });
+}
+
+//---------- Class SimCar::Drive Implementation -------------------------------
+
+void SimCar::Drive::goToFloor(size_t floor)
+{
+    uint64_t travel = car_.sim_.travelMsec(car_, floor_, floor);
+
+    target_ = floor;
+    car_.sim_.ran(car_, floor_, floor);
+    if (floor != floor_)
+    {
+        car_.direction_ = (floor > floor_) ? 1 : -1;
+    }
+
+    car_.sim_.schedule(travel, [this, floor]
+    {
+        floor_ = floor;
+        client_->handleArrived();
+    });
+}
+
+//---------- Class SimCar::Timer Implementation -------------------------------
+
+void SimCar::Timer::start(size_t msec)
+{
+    uint64_t generation = ++generation_;
+
+    car_.sim_.timerCalled();
+
+    car_.sim_.schedule(msec, [this, generation]
+    {
+        if (generation == generation_)
+        {
+            client_->handleExpired();
+        }
+    });
+}
+
+void SimCar::Timer::stop()
+{
+    ++generation_;
+    car_.sim_.timerCalled();
+}
+
+size_t SimCar::Timer::nowMsec() const
+{
+    return car_.sim_.now();
+}
+
+//---------- Class Simulation Implementation ----------------------------------
+
+Simulation::Simulation(const SimConfig &config, uint32_t seed)
+    : config_(config)
+    , driveModel_(config.driveProfile, config.floorHeight, config.floors)
+    , energyModel_(config.energyProfile, config.floorHeight, config.floors)
+    , random_(seed)
+    , now_(0)
+    , sequence_(0)
+    , warmupMsec_(0)
+    , waiting_(config.floors + 1)
+    , hallCallCar_(config.floors + 1, -1)
+    , dispatcher_(config.cars, config.capacity)
+    , classifier_(config.floors)
+    , policy_(ElevatorTrafficPolicy::forMode(ElevatorTrafficClassifier::MODE_IDLE))
+{
+    if (config_.etaDispatch)
+    {
+        dispatcher_.setDriveModel(&driveModel_);
+    }
+
+    if (config_.energyMsecPerWh)
+    {
+        dispatcher_.setEnergyModel(&energyModel_, config_.energyMsecPerWh);
+    }
+
+    if (config_.carsPerShaft > 1)
+    {
+        for (size_t car = 0; car < config_.cars; car += config_.carsPerShaft)
+        {
+            shafts_.emplace_back(new ElevatorShaft(config_.floors));
+        }
+
+        // Each car of a pair can reach all but the far end floor.
+        for (size_t car = 0; car < config_.cars; ++car)
+        {
+            if (car % ElevatorShaft::CARS == ElevatorShaft::UPPER_CAR)
+            {
+                dispatcher_.setReach(car, ElevatorFsm::GROUND_FLOOR + 1, config_.floors);
+            }
+            else
+            {
+                dispatcher_.setReach(car, ElevatorFsm::GROUND_FLOOR, config_.floors - 1);
+            }
+        }
+
+        schedule(config_.shaftYieldMsec, [this]{ yieldShafts(); });
+    }
+
+    if (config_.trafficModes)
+    {
+        schedule(config_.modeIntervalMsec, [this]{ classifyTraffic(); });
+    }
+
+    for (size_t car = 0; car < config_.cars; ++car)
+    {
+        cars_.emplace_back(new SimCar(*this, car));
+    }
+}
+
+const SimStats &Simulation::run(const std::vector<SimTraffic> &periods, uint64_t warmupMsec)
+{
+    uint64_t start = now_;
+
+    warmupMsec_ = start + warmupMsec;
+
+    for (const SimTraffic &traffic : periods)
+    {
+        std::exponential_distribution<double> interval(traffic.passengersPerMinute / 60000.0);
+        uint64_t end = start + traffic.durationMsec;
+
+        for (double at = start + interval(random_); at < end; at += interval(random_))
+        {
+            SimPassenger passenger = newPassenger(traffic, static_cast<uint64_t>(at));
+            schedule(passenger.arrivalMsec - now_, [this, passenger]{ arrive(passenger); });
+        }
+
+        start = end;
+    }
+
+    while (!events_.empty() && (events_.top().atMsec < start))
+    {
+        Event event = events_.top();
+        events_.pop();
+        now_ = event.atMsec;
+        event.action();
+    }
+
+    now_ = start;
+    stats_.measuredMsec = (now_ > warmupMsec_) ? (now_ - warmupMsec_) : 0;
+    return stats_;
+}
+
+void Simulation::schedule(uint64_t delayMsec, std::function<void()> action)
+{
+    events_.push(Event{ now_ + delayMsec, sequence_++, std::move(action) });
+}
+
+uint64_t Simulation::travelMsec(const SimCar &car, size_t fromFloor, size_t toFloor) const
+{
+    size_t   distance = (toFloor > fromFloor) ? (toFloor - fromFloor) : (fromFloor - toFloor);
+    uint64_t travel   = config_.kinematicDrive
+        ? driveModel_.travelMsec(fromFloor, toFloor)
+        : (distance ? (distance * config_.floorTravelMsec + config_.startStopMsec) : 0);
+
+    return (car.id() < config_.slowCars) ? (travel * config_.slowPercent / 100) : travel;
+}
+
+uint64_t Simulation::etaMsec(const SimCar &car, size_t toFloor) const
+{
+    size_t fromFloor = car.floor();
+    size_t distance  = (toFloor > fromFloor) ? (toFloor - fromFloor) : (fromFloor - toFloor);
+
+    if (config_.learnedEta && car.fsm().timing().travelSamples(distance))
+    {
+        return car.fsm().timing().travelMsec(distance);
+    }
+
+    return config_.etaDispatch ? driveModel_.travelMsec(fromFloor, toFloor)
+                               : distance * config_.floorTravelMsec;
+}
+
+SimPassenger Simulation::newPassenger(const SimTraffic &traffic, uint64_t atMsec)
+{
+    std::uniform_real_distribution<double> kind(0.0, 1.0);
+    std::uniform_int_distribution<size_t>  upper(ElevatorFsm::GROUND_FLOOR + 1, config_.floors);
+    SimPassenger passenger = { ElevatorFsm::GROUND_FLOOR, ElevatorFsm::GROUND_FLOOR, atMsec, 0, 0 };
+    double draw = kind(random_);
+
+    if (draw < traffic.upFraction)
+    {
+        passenger.destination = upper(random_);
+    }
+    else if (draw < traffic.upFraction + traffic.downFraction)
+    {
+        passenger.origin = upper(random_);
+    }
+    else
+    {
+        passenger.origin = upper(random_);
+        do
+        {
+            passenger.destination = upper(random_);
+        } while (passenger.destination == passenger.origin);
+    }
+
+    return passenger;
+}
+
+void Simulation::arrive(const SimPassenger &passenger)
+{
+    if (isMeasured(passenger))
+    {
+        ++stats_.arrived;
+    }
+
+    classifier_.arrival(passenger.origin, now_);
+
+    if (config_.destinationDispatch)
+    {
+        // The destination is entered at the keypad on arrival.
+        classifier_.floorRequest(passenger.origin, passenger.destination, now_);
+
+        SimPassenger assigned = passenger;
+
+        if (!dispatchDestinationCall(assigned))
+        {
+            unassigned_.push_back(assigned);
+        }
+        return;
+    }
+
+    waiting_[passenger.origin].push_back(passenger);
+
+    // Walk straight into a car that is already standing open at the floor.
+    for (auto &car : cars_)
+    {
+        if (car->isDoorOpenAt(passenger.origin) && car->hasRoom())
+        {
+            boardWaiting(*car, passenger.origin);
+            car->extendDwell();
+            return;
+        }
+    }
+
+    dispatchHallCall(passenger.origin);
+}
+
+void Simulation::dispatchHallCall(size_t floor)
+{
+    if ((hallCallCar_[floor] >= 0) || waiting_[floor].empty())
+    {
+        return;
+    }
+
+    SimCar *best     = nullptr;
+    int64_t bestCost = INT64_MAX;
+
+    for (auto &car : cars_)
+    {
+        // Don't offer the call to a car that has already refused it, or to a
+        // full car that is just leaving the floor.
+        if (!car->fsm().isInService() || car->isSkipping(floor) ||
+            (car->isDoorOpenAt(floor) && !car->hasRoom()))
+        {
+            continue;
+        }
+
+        int64_t cost = etaMsec(*car, floor) +
+                       (car->pendingStops() / 4) * config_.floorTravelMsec;
+
+        // The car's run to the call with whoever is aboard.
+        if (config_.energyMsecPerWh && energyModel_.hasFloor(car->floor()) &&
+            energyModel_.hasFloor(floor))
+        {
+            cost += static_cast<int64_t>(config_.energyMsecPerWh *
+                energyModel_.runWh(car->floor(), floor, car->passengers()));
+        }
+
+        if (cost < bestCost)
+        {
+            best     = car.get();
+            bestCost = cost;
+        }
+    }
+
+    if (best)
+    {
+        hallCallCar_[floor] = static_cast<int>(best->id());
+        best->assignHallCall(floor);
+    }
+}
+
+void Simulation::classifyTraffic()
+{
+    ElevatorTrafficClassifier::Mode before = classifier_.mode();
+    ElevatorTrafficClassifier::Mode after  = classifier_.classify(now_);
+
+    stats_.modeMsec[before] += config_.modeIntervalMsec;
+    if (after != before)
+    {
+        ++stats_.modeSwitches;
+        policy_ = ElevatorTrafficPolicy::forMode(after);
+
+        // Idle cars go to the new mode's parking floors.
+        for (auto &car : cars_)
+        {
+            car->service();
+        }
+    }
+
+    schedule(config_.modeIntervalMsec, [this]{ classifyTraffic(); });
+}
+
+size_t Simulation::parkingFloor(const SimCar &car)
+{
+    switch (policy_.parking)
+    {
+    case ElevatorTrafficPolicy::PARK_AT_LOBBY:
+        return car.lobby();
+
+    case ElevatorTrafficPolicy::PARK_AT_BUSIEST:
+        break;
+
+    default:
+        return 0;
+    }
+
+    // The floor with the most recent arrivals that no other car is resting
+    // at or parking at, staying put on a tie.
+    size_t   best      = 0;
+    uint32_t bestCount = 0;
+
+    for (size_t floor = ElevatorFsm::GROUND_FLOOR; floor <= config_.floors; ++floor)
+    {
+        uint32_t count   = classifier_.arrivals(floor, now_);
+        bool     better  = (count > bestCount) || ((count == bestCount) && (floor == car.floor()));
+        bool     claimed = false;
+
+        if (!better || (count == 0) || !dispatcher_.isReachable(car.id(), floor))
+        {
+            continue;
+        }
+
+        for (auto &other : cars_)
+        {
+            claimed = claimed || ((other.get() != &car) && (other->pendingStops() == 0) &&
+                                  (other->target() == floor));
+        }
+
+        if (!claimed)
+        {
+            best      = floor;
+            bestCount = count;
+        }
+    }
+
+    return best;
+}
+
+void Simulation::yieldShafts()
+{
+    for (auto &car : cars_)
+    {
+        car->yieldShaft();
+    }
+
+    schedule(config_.shaftYieldMsec, [this]{ yieldShafts(); });
+}
+
+bool Simulation::dispatchDestinationCall(SimPassenger &passenger)
+{
+    ElevatorDestinationCall call = { passenger.origin, passenger.destination, 1 };
+    size_t carFloors[ElevatorDestinationDispatcher::MAX_CARS];
+
+    for (auto &car : cars_)
+    {
+        carFloors[car->id()] = car->floor();
+    }
+
+    passenger.car = dispatcher_.assign(call, carFloors);
+    if (passenger.car == ElevatorDestinationDispatcher::NO_CAR)
+    {
+        return false;
+    }
+
+    SimCar &car = *cars_[passenger.car];
+
+    // From the upper lobby level, or to it, for an upper car.
+    passenger.origin      = dispatcher_.servedFloor(passenger.car, passenger.origin);
+    passenger.destination = dispatcher_.servedFloor(passenger.car, passenger.destination);
+    waiting_[passenger.origin].push_back(passenger);
+    if (car.isDoorOpenAt(passenger.origin))
+    {
+        boardWaiting(car, passenger.origin);
+        car.extendDwell();
+    }
+    else
+    {
+        car.sendStops();
+    }
+
+    return true;
+}
+
+void Simulation::hallCallSkipped(size_t floor, SimCar &car)
+{
+    ++stats_.hallCallsSkipped;
+    hallCallCar_[floor] = -1;
+    dispatchHallCall(floor);
+}
+
+void Simulation::loadChanged(SimCar &car)
+{
+    if (config_.destinationDispatch)
+    {
+        std::vector<SimPassenger> retry;
+
+        retry.swap(unassigned_);
+        for (SimPassenger &passenger : retry)
+        {
+            if (!dispatchDestinationCall(passenger))
+            {
+                unassigned_.push_back(passenger);
+            }
+        }
+        return;
+    }
+
+    // Calls no car would take may now find one.
+    for (size_t floor = ElevatorFsm::GROUND_FLOOR; floor < waiting_.size(); ++floor)
+    {
+        dispatchHallCall(floor);
+    }
+}
+
+void Simulation::boardWaiting(SimCar &car, size_t floor)
+{
+    if (config_.destinationDispatch)
+    {
+        // Passengers only board the car they were assigned.
+        std::vector<SimPassenger> &waiting = waiting_[floor];
+        auto boarding = std::stable_partition(waiting.begin(), waiting.end(),
+            [&car](const SimPassenger &passenger) { return passenger.car != car.id(); });
+
+        for (auto passenger = boarding; passenger != waiting.end(); ++passenger)
+        {
+            passenger->boardMsec = now_;
+            if (isMeasured(*passenger))
+            {
+                stats_.waitMsec.push_back(passenger->boardMsec - passenger->arrivalMsec);
+            }
+            car.board(*passenger);
+        }
+        waiting.erase(boarding, waiting.end());
+        dispatcher_.boarded(car.id(), floor);
+        return;
+    }
+
+    std::vector<SimPassenger> &waiting = waiting_[floor];
+    size_t boarded = 0;
+
+    while ((boarded < waiting.size()) && car.hasRoom())
+    {
+        SimPassenger &passenger = waiting[boarded++];
+
+        // Each passenger requests their floor on boarding.
+        classifier_.floorRequest(floor, passenger.destination, now_);
+        passenger.boardMsec = now_;
+        if (isMeasured(passenger))
+        {
+            stats_.waitMsec.push_back(passenger.boardMsec - passenger.arrivalMsec);
+        }
+        car.board(passenger);
+    }
+    waiting.erase(waiting.begin(), waiting.begin() + boarded);
+
+    // The call is served for everyone who got on; whoever is left behind
+    // needs another car.
+    if (hallCallCar_[floor] >= 0)
+    {
+        cars_[hallCallCar_[floor]]->cancelHallCall(floor);
+        hallCallCar_[floor] = -1;
+    }
+    dispatchHallCall(floor);
+}
+
+void Simulation::delivered(const SimPassenger &passenger)
+{
+    if (now_ >= warmupMsec_)
+    {
+        ++stats_.delivered;
+        if (isMeasured(passenger))
+        {
+            stats_.journeyMsec.push_back(now_ - passenger.arrivalMsec);
+        }
+    }
+}
+
+void Simulation::roundTrip(uint64_t msec, size_t stops)
+{
+    if (now_ >= warmupMsec_)
+    {
+        ++stats_.roundTrips;
+        stats_.roundTripStops += stops;
+        stats_.roundTripMsec  += msec;
+    }
+}
+
+void Simulation::ran(const SimCar &car, size_t fromFloor, size_t toFloor)
+{
+    // The model stops at its MAX_FLOORS; runs above it go unaccounted.
+    if ((now_ < warmupMsec_) || (fromFloor == toFloor) ||
+        !energyModel_.hasFloor(fromFloor) || !energyModel_.hasFloor(toFloor))
+    {
+        return;
+    }
+
+    double wh = energyModel_.runWh(fromFloor, toFloor, car.passengers());
+
+    ++stats_.runs;
+    stats_.energyWh += wh;
+    if (wh < 0.0)
+    {
+        stats_.regeneratedWh -= wh;
+    }
+}
+
+void Simulation::stopped(bool empty)
+{
+    ++stats_.stops;
+    if (empty)
+    {
+        ++stats_.emptyStops;
+    }
+}
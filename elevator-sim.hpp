@@ -0,0 +1,393 @@
+// Elevator simulator: a discrete-event simulation of a bank of cars, each
+// controlled by an ElevatorFsm, for measuring control and dispatch policies
+// off-target.
+//
+// The simulated components stand in for the target-specific concrete classes:
+// each car has a UI, door, drive, and timer that implement the FSM's API's
+// against a virtual clock. Following the component architecture, the car's UI
+// owns the queue of pending stops and feeds the FSM the next floor whenever it
+// is idle; the bank dispatcher assigns hall calls to cars.
+//
+#ifndef ELEVATOR_SIM_HPP
+#define ELEVATOR_SIM_HPP
+
+#include "elevator-dispatch.hpp"
+#include "elevator-drive-model.hpp"
+#include "elevator-energy-model.hpp"
+#include "elevator-fsm.hpp"
+#include "elevator-shaft.hpp"
+#include "elevator-traffic-mode.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <random>
+#include <vector>
+
+class Simulation;
+
+//---------- Simulation parameters --------------------------------------------
+
+struct SimConfig
+{
+    size_t floors          = 12;    // Floors served, GROUND_FLOOR..floors.
+    size_t cars            = 4;
+    size_t capacity        = 13;    // Passengers per car at rated load.
+    size_t floorTravelMsec = 1500;  // Per floor at rated speed.
+    size_t startStopMsec   = 4000;  // Acceleration plus deceleration per trip.
+
+    // Kinematic drive: travel times from the drive model instead of the
+    // linear per-floor time, and the FSM's move timeouts derived from it.
+    bool   kinematicDrive  = false;
+    bool   etaDispatch     = false;  // Dispatcher costs travel with the model.
+    ElevatorDriveProfile driveProfile = { 2.5, 1.0, 1.2 };
+    double floorHeight     = 4.0;    // Meters.
+
+    // Older cars: the first slowCars cars travel slower than rated, and the
+    // dispatcher may cost travel with each car's learned times.
+    size_t slowCars        = 0;
+    size_t slowPercent     = 130;
+    bool   learnedEta      = false;
+    size_t doorOpenMsec    = 2000;
+    size_t doorCloseMsec   = 3000;
+    size_t transferMsec    = 1000;  // Per passenger boarding or alighting.
+    size_t fullLoadPercent = ElevatorFsm::FULL_LOAD_PERCENT;
+    bool   destinationDispatch = false;  // Else hall-call collective control.
+
+    // FSM timer coalescing, and how many times a passenger who walks in while
+    // the doors are open presses the open button, a press every
+    // openButtonMsec.
+    bool   coalesceTimers    = false;
+    size_t timerSlackMsec    = 0;
+    size_t openButtonPresses = 0;
+    size_t openButtonMsec    = 200;
+
+    // Twin cars: with two cars to a shaft, cars 2s and 2s+1 are the lower
+    // and upper cars of shaft s. The upper car starts on, and serves the
+    // lobby from, the upper level of a two-level lobby, the floor above the
+    // ground floor. Needs destination dispatch, to keep passengers to cars
+    // that reach their floors.
+    size_t carsPerShaft      = 1;
+    size_t shaftYieldMsec    = ElevatorFsm::TIMER_SHAFT_RETRY_MSEC;
+
+    // Traffic modes: classify the traffic as it comes, every modeIntervalMsec,
+    // and switch the bank's parking, lobby dwell, and first stop ordering to
+    // the mode's policy. Otherwise the bank keeps the idle mode's policy.
+    bool   trafficModes      = false;
+    size_t modeIntervalMsec  = ElevatorSlidingCounter::BUCKET_MSEC;
+
+    // Energy: every run is charged to the stats by the energy model. With a
+    // weight, dispatch adds the energy a car would spend on a call to its
+    // cost, at energyMsecPerWh of wait per watt-hour.
+    ElevatorEnergyProfile energyProfile = { 1000.0, 45.0, 75.0, 800.0, 2.0, 80.0, 65.0 };
+    size_t energyMsecPerWh   = 0;
+};
+
+// Passenger arrivals for one period of the day. Arrivals are Poisson; each
+// passenger is up (lobby to an upper floor), down (upper floor to lobby), or
+// interfloor (between upper floors).
+struct SimTraffic
+{
+    uint64_t durationMsec;
+    double   passengersPerMinute;
+    double   upFraction;
+    double   downFraction;
+};
+
+struct SimPassenger
+{
+    size_t   origin;
+    size_t   destination;
+    uint64_t arrivalMsec;
+    uint64_t boardMsec;
+    size_t   car;       // Assigned car under destination dispatch.
+};
+
+struct SimStats
+{
+    size_t arrived          = 0;
+    size_t delivered        = 0;  // Deliveries after warm-up.
+    size_t stops            = 0;  // Door cycles.
+    size_t emptyStops       = 0;  // Door cycles where nobody boarded or alighted.
+    size_t hallCallsSkipped = 0;
+    size_t timerCalls       = 0;  // Timer starts and stops the FSMs issued.
+    uint64_t measuredMsec   = 0;
+    size_t   roundTrips     = 0;  // Lobby to lobby.
+    size_t   roundTripStops = 0;
+    uint64_t roundTripMsec  = 0;
+    std::vector<uint64_t> waitMsec;     // Arrival to boarding.
+    std::vector<uint64_t> journeyMsec;  // Arrival to delivery.
+    size_t   modeSwitches   = 0;
+    uint64_t modeMsec[ElevatorTrafficClassifier::MODES] = {};   // Time in each.
+    size_t   runs           = 0;
+    double   energyWh       = 0.0;  // From the mains, net of regeneration.
+    double   regeneratedWh  = 0.0;  // Returned to the mains.
+
+    double meanWaitSec() const;
+    double percentileWaitSec(double percentile) const;
+    double meanJourneySec() const;
+    double meanRoundTripSec() const;
+    double stopsPerRoundTrip() const;
+
+    // Passengers delivered per 5 minutes, the usual handling capacity measure.
+    double handlingCapacity() const;
+
+    double kWhPerPassenger() const;
+
+    // Accumulate another run, e.g. the same traffic with a different seed.
+    void add(const SimStats &other);
+};
+
+//---------- Simulated car ----------------------------------------------------
+
+class SimCar
+{
+public:
+    SimCar(Simulation &sim, size_t id);
+
+    size_t id() const { return id_; }
+    size_t floor() const { return drive_.floor_; }
+    size_t target() const { return drive_.target_; }
+    size_t lobby() const { return lobby_; }
+    size_t passengers() const { return passengers_.size(); }
+    size_t pendingStops() const;
+    bool   isDoorOpenAt(size_t floor) const;
+    bool   hasRoom() const;
+
+    const ElevatorFsm &fsm() const { return fsm_; }
+
+    // Dispatcher interface.
+    void assignHallCall(size_t floor);
+    void cancelHallCall(size_t floor) { hallCalls_[floor] = false; }
+    bool isSkipping(size_t floor) const { return skipped_[floor]; }
+
+    // Board a passenger while the doors are open.
+    void board(const SimPassenger &passenger);
+
+    // Hold the doors for passengers who walked in after the car opened.
+    void extendDwell();
+
+    // Issue the next stop to the FSM if it is idle.
+    void service();
+
+    // Destination dispatch: give the FSM the car's current stop list.
+    void sendStops();
+
+    // Twin cars: move the car, if it's idle, out of the way of the other car
+    // in its shaft.
+    void yieldShaft();
+
+private:
+    class Ui
+        : public ElevatorUiApi
+    {
+    public:
+        Ui(SimCar &car) : car_(car) {}
+
+        virtual void arrived(size_t floor) {}
+        virtual void inService() {}
+        virtual void outOfService() {}
+        virtual void alarmOn() {}
+        virtual void alarmOff() {}
+        virtual void hallCallSkipped(size_t floor);
+
+        bool floorRequest(size_t floor) { return client_->handleFloorRequest(floor); }
+        bool hallCall(size_t floor)     { return client_->handleHallCall(floor); }
+        bool stopList(const size_t *floors, size_t count)
+        {
+            return client_->handleStopList(floors, count);
+        }
+        bool openButton()               { return client_->handleOpenButton(); }
+        bool closeButton()              { return client_->handleCloseButton(); }
+
+    private:
+        SimCar &car_;
+    };
+
+    class Door
+        : public ElevatorDoorApi
+    {
+    public:
+        Door(SimCar &car) : car_(car) {}
+
+        virtual void open();
+        virtual void close();
+
+    private:
+        SimCar &car_;
+    };
+
+    class Drive
+        : public ElevatorDriveApi
+    {
+    public:
+        Drive(SimCar &car)
+            : car_(car)
+            , floor_(ElevatorFsm::GROUND_FLOOR)
+            , target_(ElevatorFsm::GROUND_FLOOR)
+            {}
+
+        virtual void   goToFloor(size_t floor);
+        virtual void   stop() {}
+        virtual void   start() {}
+        virtual size_t getFloor() const { return floor_; }
+        virtual bool   isAtFloor() const { return true; }
+
+        bool load(size_t percent) { return client_->handleLoad(percent); }
+
+    private:
+        friend SimCar;
+        SimCar &car_;
+        size_t  floor_;
+        size_t  target_;
+    };
+
+    class Timer
+        : public ElevatorTimerApi
+    {
+    public:
+        Timer(SimCar &car) : car_(car), generation_(0) {}
+
+        virtual void   start(size_t msec);
+        virtual void   stop();
+        virtual size_t nowMsec() const;
+
+    private:
+        SimCar  &car_;
+        uint64_t generation_;
+    };
+
+    void onDoorsOpened();
+    void reportLoad();
+    void closeAfter(uint64_t delayMsec);
+    void serviceConventional();
+
+    // The first stop for an empty car by the bank's ordering policy, or 0
+    // to take the nearest.
+    size_t orderedStop() const;
+
+    // Send an idle car with nothing to do to the bank's parking floor.
+    void park();
+
+    Simulation &sim_;
+    size_t      id_;
+    int         direction_;
+    uint64_t    dwellGeneration_;
+    size_t      lobby_;           // Floor the car serves the lobby from.
+    uint64_t    lobbyMsec_;       // Last door opening at the lobby.
+    uint64_t    holdUntilMsec_;   // Doors held open at the lobby until.
+    size_t      stopsAway_;       // Stops since leaving the lobby.
+
+    Ui    ui_;
+    Door  door_;
+    Drive drive_;
+    Timer timer_;
+
+    ElevatorFsm fsm_;
+
+    ElevatorShaft *shaft_;
+    size_t         shaftCar_;
+
+    std::vector<SimPassenger> passengers_;
+    std::vector<bool>         carCalls_;
+    std::vector<bool>         hallCalls_;
+    std::vector<bool>         skipped_;
+};
+
+//---------- Simulation -------------------------------------------------------
+
+class Simulation
+{
+public:
+    Simulation(const SimConfig &config, uint32_t seed = 1);
+
+    // Run the traffic periods back to back, measuring passengers who arrive
+    // after the warm-up period.
+    const SimStats &run(const std::vector<SimTraffic> &periods, uint64_t warmupMsec);
+
+    const SimConfig &config() const { return config_; }
+    const SimCar &car(size_t id) const { return *cars_[id]; }
+
+    // The shaft a car shares, or null if it has a shaft to itself.
+    ElevatorShaft *shaft(size_t car) const
+    {
+        return (config_.carsPerShaft > 1) ? shafts_[car / config_.carsPerShaft].get() : nullptr;
+    }
+    uint64_t now() const { return now_; }
+
+    void schedule(uint64_t delayMsec, std::function<void()> action);
+
+    // How long the drive takes between floors, and the dispatcher's estimate.
+    uint64_t travelMsec(const SimCar &car, size_t fromFloor, size_t toFloor) const;
+    uint64_t etaMsec(const SimCar &car, size_t toFloor) const;
+
+    const ElevatorDriveModel *driveModel() const
+    {
+        return config_.kinematicDrive ? &driveModel_ : nullptr;
+    }
+
+    // Called by cars.
+    void hallCallSkipped(size_t floor, SimCar &car);
+    void loadChanged(SimCar &car);
+    void boardWaiting(SimCar &car, size_t floor);
+    void delivered(const SimPassenger &passenger);
+    void stopped(bool empty);
+    void roundTrip(uint64_t msec, size_t stops);
+    void timerCalled() { ++stats_.timerCalls; }
+    void ran(const SimCar &car, size_t fromFloor, size_t toFloor);
+
+    // Traffic modes.
+    const ElevatorTrafficPolicy &policy() const { return policy_; }
+    size_t parkingFloor(const SimCar &car);
+
+    // Destination dispatch.
+    ElevatorDestinationDispatcher &dispatcher() { return dispatcher_; }
+    bool isDestinationDispatch() const { return config_.destinationDispatch; }
+
+private:
+    struct Event
+    {
+        uint64_t              atMsec;
+        uint64_t              sequence;
+        std::function<void()> action;
+
+        bool operator>(const Event &other) const
+        {
+            return (atMsec != other.atMsec) ? (atMsec > other.atMsec)
+                                            : (sequence > other.sequence);
+        }
+    };
+
+    SimPassenger newPassenger(const SimTraffic &traffic, uint64_t atMsec);
+    void arrive(const SimPassenger &passenger);
+    void dispatchHallCall(size_t floor);
+    void yieldShafts();
+    void classifyTraffic();
+    bool dispatchDestinationCall(SimPassenger &passenger);
+    bool isMeasured(const SimPassenger &passenger) const
+    {
+        return passenger.arrivalMsec >= warmupMsec_;
+    }
+
+    SimConfig config_;
+    ElevatorDriveModel driveModel_;
+    ElevatorEnergyModel energyModel_;
+    std::mt19937 random_;
+    uint64_t now_;
+    uint64_t sequence_;
+    uint64_t warmupMsec_;
+    std::priority_queue<Event, std::vector<Event>, std::greater<Event>> events_;
+
+    std::vector<std::unique_ptr<ElevatorShaft>> shafts_;
+    std::vector<std::unique_ptr<SimCar>>   cars_;
+    std::vector<std::vector<SimPassenger>> waiting_;   // Per floor.
+    std::vector<int>                       hallCallCar_; // Per floor, -1 if none.
+    ElevatorDestinationDispatcher          dispatcher_;
+    std::vector<SimPassenger>              unassigned_;  // No car had room.
+    ElevatorTrafficClassifier              classifier_;
+    ElevatorTrafficPolicy                  policy_;
+    SimStats stats_;
+};
+
+#endif // ELEVATOR_SIM_HPP
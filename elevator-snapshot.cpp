@@ -0,0 +1,141 @@
+// Elevator snapshot: FSM images for warm restart.
+//
+#include "elevator-snapshot.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+static_assert(sizeof(ElevatorSnapshot) == 60, "snapshot layout changed; bump VERSION");
+static_assert(offsetof(ElevatorSnapshot, checksum) % sizeof(uint32_t) == 0,
+              "checksum covers whole words");
+
+namespace
+{
+
+// FNV-1a over everything but the checksum itself, a 32-bit word at a time:
+// the image is written on every state change, and a byte at a time would
+// cost as much as the rest of the change.
+uint32_t computeChecksum(const ElevatorSnapshot &snapshot)
+{
+    const uint8_t *data  = reinterpret_cast<const uint8_t *>(&snapshot);
+    size_t         words = offsetof(ElevatorSnapshot, checksum) / sizeof(uint32_t);
+    uint32_t       hash  = 2166136261u;
+
+    for (size_t word = 0; word < words; ++word)
+    {
+        uint32_t value;
+
+        memcpy(&value, data + word * sizeof(value), sizeof(value));
+        hash = (hash ^ value) * 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+//---------- Struct ElevatorSnapshot Implementation ---------------------------
+
+void ElevatorSnapshot::seal(uint32_t sequenceNumber)
+{
+    magic    = MAGIC;
+    version  = VERSION;
+    sequence = sequenceNumber;
+    memset(reserved, 0, sizeof(reserved));
+    checksum = computeChecksum(*this);
+}
+
+bool ElevatorSnapshot::isValid() const
+{
+    return (magic == MAGIC) &&
+           (version == VERSION) &&
+           (stopCount <= MAX_STOPS) &&
+           (nextStop <= stopCount) &&
+           (checksum == computeChecksum(*this));
+}
+
+//---------- Struct ElevatorSnapshotSlot Implementation -----------------------
+
+const ElevatorSnapshot *ElevatorSnapshotSlot::latest() const
+{
+    const ElevatorSnapshot *first  = copies[0].isValid() ? &copies[0] : nullptr;
+    const ElevatorSnapshot *second = copies[1].isValid() ? &copies[1] : nullptr;
+
+    if (!first || !second)
+    {
+        return first ? first : second;
+    }
+
+    // Sequence numbers wrap; the newer is the one a small step ahead.
+    return (static_cast<int32_t>(second->sequence - first->sequence) > 0) ? second : first;
+}
+
+//---------- Class ElevatorSnapshotFile Implementation ------------------------
+
+ElevatorSnapshotFile::ElevatorSnapshotFile()
+    : fd_(-1)
+    , cars_(0)
+    , slots_(nullptr)
+{
+}
+
+ElevatorSnapshotFile::~ElevatorSnapshotFile()
+{
+    close();
+}
+
+bool ElevatorSnapshotFile::open(const char *path, size_t cars)
+{
+    size_t bytes = cars * sizeof(ElevatorSnapshotSlot);
+
+    close();
+
+    fd_ = ::open(path, O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    // Growing the file zero-fills it; a file for more cars keeps its size.
+    struct stat status;
+    if ((fstat(fd_, &status) != 0) ||
+        ((static_cast<size_t>(status.st_size) < bytes) && (ftruncate(fd_, bytes) != 0)))
+    {
+        close();
+        return false;
+    }
+
+    void *map = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+
+    slots_ = static_cast<ElevatorSnapshotSlot *>(map);
+    cars_  = cars;
+    return true;
+}
+
+void ElevatorSnapshotFile::close()
+{
+    if (slots_)
+    {
+        munmap(slots_, cars_ * sizeof(ElevatorSnapshotSlot));
+        slots_ = nullptr;
+        cars_  = 0;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool ElevatorSnapshotFile::flush()
+{
+    return slots_ && (msync(slots_, cars_ * sizeof(ElevatorSnapshotSlot), MS_SYNC) == 0);
+}
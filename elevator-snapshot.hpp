@@ -0,0 +1,92 @@
+// Elevator snapshot: a compact, versioned image of an ElevatorFsm's state for
+// warm restart after a controller reboot.
+//
+// The FSM writes its snapshot on every state change into a slot that holds
+// two copies, alternating between them, so a write torn by a crash leaves the
+// previous copy intact. Slots live in a memory-mapped file, one per car, so a
+// write is a plain memory copy and the kernel persists it.
+//
+// Images are in native byte order: they are only read back by the controller
+// that wrote them.
+//
+#ifndef ELEVATOR_SNAPSHOT_HPP
+#define ELEVATOR_SNAPSHOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+struct ElevatorSnapshot
+{
+    enum Image
+    {
+        MAGIC     = 0x4e534c45,     // "ELSN"
+        VERSION   = 1,
+        MAX_STOPS = 16,
+    };
+
+    uint32_t magic;
+    uint32_t sequence;              // Increments with every write.
+    uint32_t timerRemainingMsec;    // Left on the timer when written.
+    uint16_t version;
+    uint16_t currentFloor;
+    uint16_t destinationFloor;
+    uint8_t  state;                 // ElevatorFsm::StateId.
+    uint8_t  stopCount;
+    uint8_t  nextStop;
+    uint8_t  reserved[3];
+    uint16_t stops[MAX_STOPS];
+    uint32_t checksum;
+
+    // Stamp the header and checksum after filling in the fields.
+    void seal(uint32_t sequenceNumber);
+
+    // Is this a complete image of this version?
+    bool isValid() const;
+};
+
+// Two copies of a car's snapshot, written alternately.
+struct ElevatorSnapshotSlot
+{
+    ElevatorSnapshot copies[2];
+
+    // Overwrites the copy chosen by the sealed snapshot's sequence number, so
+    // consecutive writes alternate.
+    void write(const ElevatorSnapshot &snapshot)
+    {
+        copies[snapshot.sequence & 1] = snapshot;
+    }
+
+    // The newest valid copy, or null if neither is valid.
+    const ElevatorSnapshot *latest() const;
+};
+
+// Snapshot slots for a bank of cars in a memory-mapped file, created zeroed
+// (no valid snapshots) if it doesn't exist.
+class ElevatorSnapshotFile
+{
+public:
+    ElevatorSnapshotFile();
+    ~ElevatorSnapshotFile();
+
+    bool open(const char *path, size_t cars);
+    void close();
+
+    // Force written snapshots to storage, for an orderly shutdown. The
+    // kernel writes them back on its own otherwise, and they survive the
+    // process crashing.
+    bool flush();
+
+    bool   isOpen() const { return slots_ != nullptr; }
+    size_t cars() const { return cars_; }
+    ElevatorSnapshotSlot *slot(size_t car) { return &slots_[car]; }
+
+private:
+    ElevatorSnapshotFile(const ElevatorSnapshotFile &) = delete;
+    ElevatorSnapshotFile &operator=(const ElevatorSnapshotFile &) = delete;
+
+    int                   fd_;
+    size_t                cars_;
+    ElevatorSnapshotSlot *slots_;
+};
+
+#endif // ELEVATOR_SNAPSHOT_HPP
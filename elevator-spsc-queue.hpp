@@ -0,0 +1,91 @@
+// Single-producer, single-consumer queue: a fixed-size lock-free ring for
+// passing records between two threads, or two processes when placed in
+// shared memory.
+//
+// The queue is self-contained, with no pointers or allocation, so it can be
+// constructed in a shared mapping. Each side keeps its own index on its own
+// cache line and a cached copy of the other side's, so the common case
+// touches no shared line written by the other side.
+//
+#ifndef ELEVATOR_SPSC_QUEUE_HPP
+#define ELEVATOR_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+template <typename T, size_t CAPACITY>
+class ElevatorSpscQueue
+{
+public:
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+    ElevatorSpscQueue()
+        : head_(0)
+        , tailCache_(0)
+        , tail_(0)
+        , headCache_(0)
+        {}
+
+    // Producer: returns false, dropping the record, if the queue is full.
+    bool push(const T &item)
+    {
+        uint32_t head = head_.load(std::memory_order_relaxed);
+
+        if (head - tailCache_ == CAPACITY)
+        {
+            tailCache_ = tail_.load(std::memory_order_acquire);
+            if (head - tailCache_ == CAPACITY)
+            {
+                return false;
+            }
+        }
+
+        items_[head & (CAPACITY - 1)] = item;
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: returns false if the queue is empty.
+    bool pop(T &item)
+    {
+        uint32_t tail = tail_.load(std::memory_order_relaxed);
+
+        if (tail == headCache_)
+        {
+            headCache_ = head_.load(std::memory_order_acquire);
+            if (tail == headCache_)
+            {
+                return false;
+            }
+        }
+
+        item = items_[tail & (CAPACITY - 1)];
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate when called concurrently with the other side.
+    size_t size() const
+    {
+        return head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire);
+    }
+
+private:
+    enum Layout
+    {
+        CACHE_LINE_BYTES = 64,
+    };
+
+    // Producer's line.
+    alignas(CACHE_LINE_BYTES) std::atomic<uint32_t> head_;
+    uint32_t                                        tailCache_;
+
+    // Consumer's line.
+    alignas(CACHE_LINE_BYTES) std::atomic<uint32_t> tail_;
+    uint32_t                                        headCache_;
+
+    alignas(CACHE_LINE_BYTES) T items_[CAPACITY];
+};
+
+#endif // ELEVATOR_SPSC_QUEUE_HPP
@@ -0,0 +1,180 @@
+// Elevator hot standby: event mirroring and failover.
+//
+#include "elevator-standby.hpp"
+#include "elevator-snapshot.hpp"
+
+//---------- Class ElevatorEventMirror Implementation -------------------------
+
+ElevatorEventMirror::ElevatorEventMirror(
+        ElevatorFsm           &fsm,
+        ElevatorMirrorChannel &channel,
+        ElevatorUiApi         &ui,
+        ElevatorDoorApi       &door,
+        ElevatorDriveApi      &drive,
+        ElevatorTimerApi      &timer)
+        : fsm_(fsm)
+        , channel_(channel)
+{
+    ui.init(this);
+    door.init(this);
+    drive.init(this);
+    timer.init(this);
+}
+
+bool ElevatorEventMirror::handleStopList(const size_t *floors, size_t count)
+{
+    ElevatorEvent event;
+    bool          handled = fsm_.handleStopList(floors, count);
+
+    event.type      = ElevatorEvent::STOP_LIST;
+    event.state     = static_cast<uint8_t>(fsm_.stateId());
+    event.stopCount = static_cast<uint8_t>((count < ElevatorFsm::MAX_STOPS) ? count
+                                                                            : ElevatorFsm::MAX_STOPS);
+    event.handled   = handled;
+    event.value     = 0;
+    for (size_t stop = 0; stop < event.stopCount; ++stop)
+    {
+        event.stops[stop] = static_cast<uint16_t>(floors[stop]);
+    }
+    send(event);
+    return handled;
+}
+
+void ElevatorEventMirror::send(const ElevatorEvent &event)
+{
+    // Never hold up the car for the standby. A lost event puts the shadow out
+    // of step; it will resume from the snapshot instead of its own state.
+    if (!channel_.events.push(event))
+    {
+        channel_.dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+//---------- Class ElevatorStandby Implementation -----------------------------
+
+ElevatorStandby::ElevatorStandby(
+        ElevatorMirrorChannel      &channel,
+        ElevatorUiApi              &ui,
+        ElevatorDoorApi            &door,
+        ElevatorDriveApi           &drive,
+        ElevatorTimerApi           &timer,
+        const ElevatorSnapshotSlot *primarySnapshots)
+        : channel_(channel)
+        , primarySnapshots_(primarySnapshots)
+        , active_(false)
+        , ui_(ui, active_)
+        , door_(door, active_)
+        , drive_(drive, active_)
+        , timer_(timer, active_)
+        , shadow_(ui_, door_, drive_, timer_)
+        , lastHeartbeat_(channel.heartbeats.load(std::memory_order_acquire))
+        , lastHeartbeatMsec_(timer_.nowMsec())
+        , applied_(0)
+        , divergences_(0)
+        , dropped_(0)
+{
+}
+
+bool ElevatorStandby::poll()
+{
+    ElevatorEvent event;
+    size_t        now = timer_.nowMsec();
+
+    if (active_)
+    {
+        return true;
+    }
+
+    // Events published before the last heartbeat are all here by now.
+    uint32_t heartbeat = channel_.heartbeats.load(std::memory_order_acquire);
+
+    while (channel_.events.pop(event))
+    {
+        apply(event);
+    }
+    dropped_ = channel_.dropped.load(std::memory_order_relaxed);
+
+    if (heartbeat != lastHeartbeat_)
+    {
+        lastHeartbeat_     = heartbeat;
+        lastHeartbeatMsec_ = now;
+    }
+    else if (now - lastHeartbeatMsec_ >= HEARTBEAT_TIMEOUT_MSEC)
+    {
+        takeOver();
+    }
+
+    return active_;
+}
+
+void ElevatorStandby::apply(const ElevatorEvent &event)
+{
+    size_t stops[ElevatorFsm::MAX_STOPS];
+    // The channel is shared with the primary, which may have died mid-write.
+    size_t count = (event.stopCount < ElevatorFsm::MAX_STOPS) ? event.stopCount
+                                                              : ElevatorFsm::MAX_STOPS;
+
+    switch (event.type)
+    {
+    case ElevatorEvent::FLOOR_REQUEST:   shadow_.handleFloorRequest(event.value);  break;
+    case ElevatorEvent::HALL_CALL:       shadow_.handleHallCall(event.value);      break;
+    case ElevatorEvent::STOP_LIST:
+        for (size_t stop = 0; stop < count; ++stop)
+        {
+            stops[stop] = event.stops[stop];
+        }
+        shadow_.handleStopList(stops, count);
+        break;
+    case ElevatorEvent::OPEN_BUTTON:     shadow_.handleOpenButton();       break;
+    case ElevatorEvent::CLOSE_BUTTON:    shadow_.handleCloseButton();      break;
+    case ElevatorEvent::STOP_BUTTON:     shadow_.handleStopButton();       break;
+    case ElevatorEvent::RESTORE_SERVICE: shadow_.handleRestoreService();   break;
+    case ElevatorEvent::OPENED:          shadow_.handleOpened();           break;
+    case ElevatorEvent::CLOSED:          shadow_.handleClosed();           break;
+    case ElevatorEvent::DOOR_FAULT:      shadow_.handleDoorFault();        break;
+    case ElevatorEvent::ARRIVED:         shadow_.handleArrived();          break;
+    case ElevatorEvent::DRIVE_FAULT:     shadow_.handleDriveFault();       break;
+    case ElevatorEvent::LOAD:            shadow_.handleLoad(event.value);  break;
+    case ElevatorEvent::EXPIRED:         shadow_.handleExpired();          break;
+    default:                                                               break;
+    }
+
+    ++applied_;
+    if (shadow_.stateId() != event.state)
+    {
+        ++divergences_;
+    }
+}
+
+void ElevatorStandby::takeOver()
+{
+    ElevatorSnapshot        image;
+    const ElevatorSnapshot *resume = &image;
+
+    if (active_)
+    {
+        return;
+    }
+
+    // Resume from the shadow's own state if it stayed in step, otherwise
+    // from the primary's last snapshot, if any. Either way the current
+    // state's commands are reissued, in case the primary failed between
+    // an event and its commands.
+    if (isInStep())
+    {
+        shadow_.snapshot(image);
+        image.seal(0);
+    }
+    else
+    {
+        resume = primarySnapshots_ ? primarySnapshots_->latest() : nullptr;
+    }
+
+    active_ = true;
+    shadow_.recover(resume);
+
+    ui_.bind();
+    door_.bind();
+    drive_.bind();
+    timer_.bind();
+}
@@ -0,0 +1,313 @@
+// Elevator hot standby: a shadow ElevatorFsm kept in step with the primary by
+// mirroring every event the primary handles, ready to take over the car's
+// components when the primary stops responding.
+//
+// On the primary, an ElevatorEventMirror sits between the components and the
+// FSM: it forwards each event, then publishes it with the state the primary
+// reached to an ElevatorMirrorChannel, a lock-free SPSC queue plus a
+// heartbeat counter. The channel has no pointers, so it can be placed in
+// memory shared with a standby process.
+//
+// On the standby, an ElevatorStandby replays the events into its shadow FSM
+// and cross-checks the shadow's state against the primary's. The shadow runs
+// against proxy components that discard commands until takeover. When the
+// heartbeat stops, the standby takes over: it resumes the shadow from its own
+// state, or from the primary's snapshot if the two diverged, and binds the
+// components' events to itself.
+//
+#ifndef ELEVATOR_STANDBY_HPP
+#define ELEVATOR_STANDBY_HPP
+
+#include "elevator-fsm.hpp"
+#include "elevator-spsc-queue.hpp"
+
+#include <atomic>
+#include <cstdint>
+
+struct ElevatorSnapshotSlot;
+
+// An event handled by the primary, and the state it reached.
+struct ElevatorEvent
+{
+    enum Type
+    {
+        FLOOR_REQUEST,
+        HALL_CALL,
+        STOP_LIST,
+        OPEN_BUTTON,
+        CLOSE_BUTTON,
+        STOP_BUTTON,
+        RESTORE_SERVICE,
+        OPENED,
+        CLOSED,
+        DOOR_FAULT,
+        ARRIVED,
+        DRIVE_FAULT,
+        LOAD,
+        EXPIRED,
+    };
+
+    uint8_t  type;
+    uint8_t  state;         // ElevatorFsm::StateId after handling.
+    uint8_t  stopCount;
+    uint8_t  handled;       // The handler's result.
+    uint32_t value;         // Floor or load percent.
+    uint16_t stops[ElevatorFsm::MAX_STOPS];
+};
+
+struct ElevatorMirrorChannel
+{
+    enum Limits
+    {
+        QUEUE_EVENTS = 256,
+    };
+
+    ElevatorMirrorChannel()
+        : heartbeats(0)
+        , dropped(0)
+        {}
+
+    ElevatorSpscQueue<ElevatorEvent, QUEUE_EVENTS> events;
+    std::atomic<uint32_t> heartbeats;   // Incremented by the primary.
+    std::atomic<uint32_t> dropped;      // Events lost to a full queue.
+};
+
+// Primary side: binds the components' events to itself, forwards them to the
+// FSM, and mirrors them.
+class ElevatorEventMirror
+    : public ElevatorUiClient
+    , public ElevatorDoorClient
+    , public ElevatorDriveClient
+    , public ElevatorTimerClient
+{
+public:
+    ElevatorEventMirror(
+        ElevatorFsm           &fsm,
+        ElevatorMirrorChannel &channel,
+        ElevatorUiApi         &ui,
+        ElevatorDoorApi       &door,
+        ElevatorDriveApi      &drive,
+        ElevatorTimerApi      &timer);
+
+    // Call at least every ElevatorStandby::HEARTBEAT_PERIOD_MSEC.
+    void heartbeat() { channel_.heartbeats.fetch_add(1, std::memory_order_release); }
+
+    virtual bool handleFloorRequest(size_t floor)
+    {
+        return publish(ElevatorEvent::FLOOR_REQUEST, fsm_.handleFloorRequest(floor), floor);
+    }
+    virtual bool handleHallCall(size_t floor)
+    {
+        return publish(ElevatorEvent::HALL_CALL, fsm_.handleHallCall(floor), floor);
+    }
+    virtual bool handleStopList(const size_t *floors, size_t count);
+    virtual bool handleOpenButton()
+    {
+        return publish(ElevatorEvent::OPEN_BUTTON, fsm_.handleOpenButton());
+    }
+    virtual bool handleCloseButton()
+    {
+        return publish(ElevatorEvent::CLOSE_BUTTON, fsm_.handleCloseButton());
+    }
+    virtual bool handleStopButton()
+    {
+        return publish(ElevatorEvent::STOP_BUTTON, fsm_.handleStopButton());
+    }
+    virtual bool handleRestoreService()
+    {
+        return publish(ElevatorEvent::RESTORE_SERVICE, fsm_.handleRestoreService());
+    }
+
+    virtual bool handleOpened()     { return publish(ElevatorEvent::OPENED, fsm_.handleOpened()); }
+    virtual bool handleClosed()     { return publish(ElevatorEvent::CLOSED, fsm_.handleClosed()); }
+    virtual bool handleDoorFault()  { return publish(ElevatorEvent::DOOR_FAULT, fsm_.handleDoorFault()); }
+
+    virtual bool handleArrived()    { return publish(ElevatorEvent::ARRIVED, fsm_.handleArrived()); }
+    virtual bool handleDriveFault() { return publish(ElevatorEvent::DRIVE_FAULT, fsm_.handleDriveFault()); }
+    virtual bool handleLoad(size_t percent)
+    {
+        return publish(ElevatorEvent::LOAD, fsm_.handleLoad(percent), percent);
+    }
+
+    virtual bool handleExpired()    { return publish(ElevatorEvent::EXPIRED, fsm_.handleExpired()); }
+
+private:
+    bool publish(ElevatorEvent::Type type, bool handled, size_t value = 0)
+    {
+        ElevatorEvent event;
+
+        event.type      = static_cast<uint8_t>(type);
+        event.state     = static_cast<uint8_t>(fsm_.stateId());
+        event.stopCount = 0;
+        event.handled   = handled;
+        event.value     = static_cast<uint32_t>(value);
+        send(event);
+        return handled;
+    }
+
+    void send(const ElevatorEvent &event);
+
+    ElevatorFsm           &fsm_;
+    ElevatorMirrorChannel &channel_;
+};
+
+// Standby side: the shadow FSM and the proxy components it runs against.
+class ElevatorStandby
+{
+public:
+    // The primary's snapshot slot, if it writes one, is the fallback for a
+    // shadow that lost step with it.
+    ElevatorStandby(
+        ElevatorMirrorChannel      &channel,
+        ElevatorUiApi              &ui,
+        ElevatorDoorApi            &door,
+        ElevatorDriveApi           &drive,
+        ElevatorTimerApi           &timer,
+        const ElevatorSnapshotSlot *primarySnapshots = nullptr);
+
+    enum Heartbeat
+    {
+        // Failover within one door timer period: detection takes at most
+        // the timeout plus one poll.
+        HEARTBEAT_PERIOD_MSEC  = 100,
+        HEARTBEAT_TIMEOUT_MSEC = 500,
+        POLL_PERIOD_MSEC       = 10,
+    };
+
+    // Replay mirrored events, then take over if the heartbeat has stopped.
+    // Call every POLL_PERIOD_MSEC. Returns true once active.
+    bool poll();
+
+    // Take over the components now.
+    void takeOver();
+
+    bool   isActive() const { return active_; }
+    bool   isInStep() const { return divergences_ == 0 && dropped_ == 0; }
+    size_t applied() const { return applied_; }
+    size_t divergences() const { return divergences_; }
+
+    // The shadow, for configuration like the primary's.
+    ElevatorFsm &fsm() { return shadow_; }
+
+private:
+    // Proxies: commands reach the component only once active; queries and
+    // the clock always do. Once bound, the component's events pass through
+    // to the shadow.
+    class Ui
+        : public ElevatorUiApi
+        , public ElevatorUiClient
+    {
+    public:
+        Ui(ElevatorUiApi &ui, const bool &active) : ui_(ui), active_(active) {}
+
+        void bind() { ui_.init(this); }
+
+        virtual void arrived(size_t floor)          { if (active_) ui_.arrived(floor); }
+        virtual void inService()                    { if (active_) ui_.inService(); }
+        virtual void outOfService()                 { if (active_) ui_.outOfService(); }
+        virtual void alarmOn()                      { if (active_) ui_.alarmOn(); }
+        virtual void alarmOff()                     { if (active_) ui_.alarmOff(); }
+        virtual void hallCallSkipped(size_t floor)  { if (active_) ui_.hallCallSkipped(floor); }
+
+        virtual bool handleFloorRequest(size_t floor) { return client_->handleFloorRequest(floor); }
+        virtual bool handleHallCall(size_t floor)     { return client_->handleHallCall(floor); }
+        virtual bool handleStopList(const size_t *floors, size_t count)
+        {
+            return client_->handleStopList(floors, count);
+        }
+        virtual bool handleOpenButton()     { return client_->handleOpenButton(); }
+        virtual bool handleCloseButton()    { return client_->handleCloseButton(); }
+        virtual bool handleStopButton()     { return client_->handleStopButton(); }
+        virtual bool handleRestoreService() { return client_->handleRestoreService(); }
+
+    private:
+        ElevatorUiApi &ui_;
+        const bool    &active_;
+    };
+
+    class Door
+        : public ElevatorDoorApi
+        , public ElevatorDoorClient
+    {
+    public:
+        Door(ElevatorDoorApi &door, const bool &active) : door_(door), active_(active) {}
+
+        void bind() { door_.init(this); }
+
+        virtual void open()  { if (active_) door_.open(); }
+        virtual void close() { if (active_) door_.close(); }
+
+        virtual bool handleOpened()    { return client_->handleOpened(); }
+        virtual bool handleClosed()    { return client_->handleClosed(); }
+        virtual bool handleDoorFault() { return client_->handleDoorFault(); }
+
+    private:
+        ElevatorDoorApi &door_;
+        const bool      &active_;
+    };
+
+    class Drive
+        : public ElevatorDriveApi
+        , public ElevatorDriveClient
+    {
+    public:
+        Drive(ElevatorDriveApi &drive, const bool &active) : drive_(drive), active_(active) {}
+
+        void bind() { drive_.init(this); }
+
+        virtual void   goToFloor(size_t floor) { if (active_) drive_.goToFloor(floor); }
+        virtual void   stop()                  { if (active_) drive_.stop(); }
+        virtual void   start()                 { if (active_) drive_.start(); }
+        virtual size_t getFloor() const        { return drive_.getFloor(); }
+        virtual bool   isAtFloor() const       { return drive_.isAtFloor(); }
+
+        virtual bool handleArrived()            { return client_->handleArrived(); }
+        virtual bool handleDriveFault()         { return client_->handleDriveFault(); }
+        virtual bool handleLoad(size_t percent) { return client_->handleLoad(percent); }
+
+    private:
+        ElevatorDriveApi &drive_;
+        const bool       &active_;
+    };
+
+    class Timer
+        : public ElevatorTimerApi
+        , public ElevatorTimerClient
+    {
+    public:
+        Timer(ElevatorTimerApi &timer, const bool &active) : timer_(timer), active_(active) {}
+
+        void bind() { timer_.init(this); }
+
+        virtual void   start(size_t msec)  { if (active_) timer_.start(msec); }
+        virtual void   stop()              { if (active_) timer_.stop(); }
+        virtual size_t nowMsec() const     { return timer_.nowMsec(); }
+
+        virtual bool handleExpired() { return client_->handleExpired(); }
+
+    private:
+        ElevatorTimerApi &timer_;
+        const bool       &active_;
+    };
+
+    void apply(const ElevatorEvent &event);
+
+    ElevatorMirrorChannel      &channel_;
+    const ElevatorSnapshotSlot *primarySnapshots_;
+    bool                        active_;
+
+    Ui    ui_;
+    Door  door_;
+    Drive drive_;
+    Timer timer_;
+
+    ElevatorFsm shadow_;
+
+    uint32_t lastHeartbeat_;
+    size_t   lastHeartbeatMsec_;    // Standby clock when it last changed.
+    size_t   applied_;
+    size_t   divergences_;
+    uint32_t dropped_;
+};
+
+#endif // ELEVATOR_STANDBY_HPP
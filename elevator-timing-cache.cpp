@@ -0,0 +1,185 @@
+// Elevator timing cache: learned travel and door times.
+//
+#include "elevator-timing-cache.hpp"
+
+#include <cstdio>
+
+namespace
+{
+
+void put16(uint8_t *&out, uint16_t value)
+{
+    *out++ = static_cast<uint8_t>(value);
+    *out++ = static_cast<uint8_t>(value >> 8);
+}
+
+void put32(uint8_t *&out, uint32_t value)
+{
+    put16(out, static_cast<uint16_t>(value));
+    put16(out, static_cast<uint16_t>(value >> 16));
+}
+
+uint16_t get16(const uint8_t *&in)
+{
+    uint16_t value = in[0] | (in[1] << 8);
+    in += 2;
+    return value;
+}
+
+uint32_t get32(const uint8_t *&in)
+{
+    uint32_t low = get16(in);
+    return low | (static_cast<uint32_t>(get16(in)) << 16);
+}
+
+// FNV-1a.
+uint32_t checksum(const uint8_t *data, size_t bytes)
+{
+    uint32_t hash = 2166136261u;
+
+    while (bytes--)
+    {
+        hash = (hash ^ *data++) * 16777619u;
+    }
+    return hash;
+}
+
+} // namespace
+
+//---------- Class ElevatorTimingCache Implementation -------------------------
+
+ElevatorTimingCache::ElevatorTimingCache()
+{
+    for (size_t bucket = 0; bucket < DISTANCE_BUCKETS; ++bucket)
+    {
+        travel_[bucket]        = 0;
+        travelSamples_[bucket] = 0;
+    }
+    for (size_t action = 0; action < DOOR_ACTIONS; ++action)
+    {
+        door_[action]        = 0;
+        doorSamples_[action] = 0;
+    }
+}
+
+void ElevatorTimingCache::recordTravel(size_t floors, size_t msec)
+{
+    if (floors)
+    {
+        update(travel_[bucket(floors)], travelSamples_[bucket(floors)], msec);
+    }
+}
+
+void ElevatorTimingCache::recordDoor(Door action, size_t msec)
+{
+    update(door_[action], doorSamples_[action], msec);
+}
+
+void ElevatorTimingCache::update(uint32_t &average, uint16_t &samples, size_t msec)
+{
+    int64_t sample = static_cast<int64_t>(msec) << FRACTION_BITS;
+
+    // The first sample seeds the average rather than pulling it up from 0.
+    if (samples == 0)
+    {
+        average = static_cast<uint32_t>(sample);
+    }
+    else
+    {
+        average = static_cast<uint32_t>(average + ((sample - average) >> WEIGHT_SHIFT));
+    }
+
+    if (samples < UINT16_MAX)
+    {
+        ++samples;
+    }
+}
+
+size_t ElevatorTimingCache::save(uint8_t *image, size_t bytes) const
+{
+    uint8_t *out = image;
+
+    if (bytes < IMAGE_BYTES)
+    {
+        return 0;
+    }
+
+    put32(out, IMAGE_MAGIC);
+    put16(out, IMAGE_VERSION);
+    put16(out, DISTANCE_BUCKETS);
+    for (size_t bucket = 0; bucket < DISTANCE_BUCKETS; ++bucket)
+    {
+        put32(out, travel_[bucket]);
+        put16(out, travelSamples_[bucket]);
+    }
+    for (size_t action = 0; action < DOOR_ACTIONS; ++action)
+    {
+        put32(out, door_[action]);
+        put16(out, doorSamples_[action]);
+    }
+    put32(out, checksum(image, out - image));
+
+    return out - image;
+}
+
+bool ElevatorTimingCache::load(const uint8_t *image, size_t bytes)
+{
+    const uint8_t *in = image;
+
+    if ((bytes < IMAGE_BYTES) ||
+        (get32(in) != IMAGE_MAGIC) ||
+        (get16(in) != IMAGE_VERSION) ||
+        (get16(in) != DISTANCE_BUCKETS))
+    {
+        return false;
+    }
+
+    const uint8_t *end = image + IMAGE_BYTES - 4;
+    if (get32(end) != checksum(image, IMAGE_BYTES - 4))
+    {
+        return false;
+    }
+
+    for (size_t bucket = 0; bucket < DISTANCE_BUCKETS; ++bucket)
+    {
+        travel_[bucket]        = get32(in);
+        travelSamples_[bucket] = get16(in);
+    }
+    for (size_t action = 0; action < DOOR_ACTIONS; ++action)
+    {
+        door_[action]        = get32(in);
+        doorSamples_[action] = get16(in);
+    }
+
+    return true;
+}
+
+bool ElevatorTimingCache::saveFile(const char *path) const
+{
+    uint8_t image[IMAGE_BYTES];
+    size_t  bytes = save(image, sizeof(image));
+    FILE   *file  = fopen(path, "wb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    bool result = (fwrite(image, 1, bytes, file) == bytes);
+    return (fclose(file) == 0) && result;
+}
+
+bool ElevatorTimingCache::loadFile(const char *path)
+{
+    uint8_t image[IMAGE_BYTES];
+    FILE   *file = fopen(path, "rb");
+
+    if (!file)
+    {
+        return false;
+    }
+
+    size_t bytes = fread(image, 1, sizeof(image), file);
+    fclose(file);
+    return load(image, bytes);
+}
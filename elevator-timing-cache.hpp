@@ -0,0 +1,85 @@
+// Elevator timing cache: how long this car's drive and doors actually take,
+// learned from live operation.
+//
+// Keeps exponentially weighted moving averages of travel time per trip
+// distance in floors, and of door opening and closing times, in a small
+// fixed-size table. Updates and queries are O(1) and never allocate. The
+// table serializes to a compact versioned binary image so it survives
+// restarts.
+//
+#ifndef ELEVATOR_TIMING_CACHE_HPP
+#define ELEVATOR_TIMING_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+class ElevatorTimingCache
+{
+public:
+    ElevatorTimingCache();
+
+    enum Limits
+    {
+        DISTANCE_BUCKETS = 16,  // 1..15 floors; longer trips share the last.
+        WEIGHT_SHIFT     = 3,   // Each sample moves the average 1/8 of the way.
+        FRACTION_BITS    = 4,   // Averages are kept in 1/16 msec.
+    };
+
+    enum Door
+    {
+        DOOR_OPEN,
+        DOOR_CLOSE,
+        DOOR_ACTIONS,
+    };
+
+    enum Image
+    {
+        IMAGE_MAGIC   = 0x43544c45,     // "ELTC"
+        IMAGE_VERSION = 1,
+        IMAGE_BYTES   = 12 + 6 * (int(DISTANCE_BUCKETS) + int(DOOR_ACTIONS)),
+    };
+
+    void recordTravel(size_t floors, size_t msec);
+    void recordDoor(Door action, size_t msec);
+
+    // Learned average, or 0 if nothing has been observed yet.
+    size_t travelMsec(size_t floors) const
+    {
+        return floors ? (travel_[bucket(floors)] >> FRACTION_BITS) : 0;
+    }
+    size_t doorMsec(Door action) const { return door_[action] >> FRACTION_BITS; }
+
+    size_t travelSamples(size_t floors) const
+    {
+        return floors ? travelSamples_[bucket(floors)] : 0;
+    }
+    size_t doorSamples(Door action) const { return doorSamples_[action]; }
+
+    // Binary image: little-endian header (magic, version, bucket count),
+    // averages and sample counts, and a checksum. Returns bytes written, or
+    // 0 if the buffer is too small.
+    size_t save(uint8_t *image, size_t bytes) const;
+
+    // Returns false, leaving the cache unchanged, if the image is not a
+    // valid image of this version and shape.
+    bool load(const uint8_t *image, size_t bytes);
+
+    // File helpers around save() and load().
+    bool saveFile(const char *path) const;
+    bool loadFile(const char *path);
+
+private:
+    static size_t bucket(size_t floors)
+    {
+        return ((floors < DISTANCE_BUCKETS) ? floors : DISTANCE_BUCKETS) - 1;
+    }
+
+    static void update(uint32_t &average, uint16_t &samples, size_t msec);
+
+    uint32_t travel_[DISTANCE_BUCKETS];
+    uint32_t door_[DOOR_ACTIONS];
+    uint16_t travelSamples_[DISTANCE_BUCKETS];
+    uint16_t doorSamples_[DOOR_ACTIONS];
+};
+
+#endif // ELEVATOR_TIMING_CACHE_HPP
@@ -0,0 +1,133 @@
+// Elevator traffic mode: sliding-window traffic classification and the
+// policies for each mode.
+//
+#include "elevator-traffic-mode.hpp"
+#include "elevator-fsm.hpp"
+
+//---------- Class ElevatorSlidingCounter Implementation ----------------------
+
+ElevatorSlidingCounter::ElevatorSlidingCounter()
+    : epoch_(0)
+    , total_(0)
+{
+    for (size_t bucket = 0; bucket < BUCKETS; ++bucket)
+    {
+        buckets_[bucket] = 0;
+    }
+}
+
+void ElevatorSlidingCounter::advance(uint64_t epoch)
+{
+    if (epoch <= epoch_)
+    {
+        return;
+    }
+
+    // However long it's been, no more than the whole window to clear.
+    uint64_t stale = epoch - epoch_;
+    for (uint64_t step = 1; step <= stale && step <= BUCKETS; ++step)
+    {
+        uint32_t &bucket = buckets_[(epoch_ + step) % BUCKETS];
+
+        total_ -= bucket;
+        bucket  = 0;
+    }
+    epoch_ = epoch;
+}
+
+//---------- Class ElevatorTrafficClassifier Implementation -------------------
+
+ElevatorTrafficClassifier::ElevatorTrafficClassifier(size_t floors)
+    : floors_((floors < MAX_FLOORS) ? floors : MAX_FLOORS)
+    , mode_(MODE_IDLE)
+{
+}
+
+const char *ElevatorTrafficClassifier::modeName(Mode mode)
+{
+    static const char *const names[MODES] =
+    {
+        "idle",
+        "up-peak",
+        "down-peak",
+        "two-way",
+    };
+
+    return (static_cast<size_t>(mode) < MODES) ? names[mode] : "?";
+}
+
+void ElevatorTrafficClassifier::arrival(size_t floor, uint64_t nowMsec)
+{
+    arrivals_[clamp(floor)].add(nowMsec);
+}
+
+void ElevatorTrafficClassifier::floorRequest(size_t origin, size_t destination, uint64_t nowMsec)
+{
+    requests_.add(nowMsec);
+    destinations_[clamp(destination)].add(nowMsec);
+
+    if (origin == ElevatorFsm::GROUND_FLOOR)
+    {
+        fromLobby_.add(nowMsec);
+    }
+    else if (destination == ElevatorFsm::GROUND_FLOOR)
+    {
+        toLobby_.add(nowMsec);
+    }
+}
+
+ElevatorTrafficClassifier::Mode ElevatorTrafficClassifier::classify(uint64_t nowMsec)
+{
+    uint32_t requests = requests_.total(nowMsec);
+
+    if (requests < IDLE_REQUESTS)
+    {
+        mode_ = MODE_IDLE;
+        return mode_;
+    }
+
+    uint32_t upPercent   = fromLobby_.total(nowMsec) * 100 / requests;
+    uint32_t downPercent = toLobby_.total(nowMsec) * 100 / requests;
+
+    // Stay in a peak until it has clearly passed.
+    if (((mode_ == MODE_UP_PEAK) && (upPercent >= PEAK_LEAVE_PERCENT)) ||
+        ((mode_ == MODE_DOWN_PEAK) && (downPercent >= PEAK_LEAVE_PERCENT)))
+    {
+        return mode_;
+    }
+
+    if (upPercent >= PEAK_ENTER_PERCENT)
+    {
+        mode_ = MODE_UP_PEAK;
+    }
+    else if (downPercent >= PEAK_ENTER_PERCENT)
+    {
+        mode_ = MODE_DOWN_PEAK;
+    }
+    else
+    {
+        mode_ = MODE_TWO_WAY;
+    }
+    return mode_;
+}
+
+//---------- Struct ElevatorTrafficPolicy Implementation ----------------------
+
+ElevatorTrafficPolicy ElevatorTrafficPolicy::forMode(ElevatorTrafficClassifier::Mode mode)
+{
+    switch (mode)
+    {
+    case ElevatorTrafficClassifier::MODE_UP_PEAK:
+        // Bring cars back to the lobby and fill them there.
+        return { PARK_AT_LOBBY, ORDER_LOBBY_FIRST, LOBBY_DWELL_MSEC };
+
+    case ElevatorTrafficClassifier::MODE_DOWN_PEAK:
+        return { PARK_AT_BUSIEST, ORDER_TOP_DOWN, 0 };
+
+    case ElevatorTrafficClassifier::MODE_TWO_WAY:
+        return { PARK_AT_BUSIEST, ORDER_NEAREST, 0 };
+
+    default:
+        return { PARK_IN_PLACE, ORDER_NEAREST, 0 };
+    }
+}
@@ -0,0 +1,144 @@
+// Elevator traffic mode: an online classifier of a bank's traffic into
+// up-peak, down-peak, two-way, and idle, and the bank policies for each.
+//
+// The classifier counts recent floor requests by origin and destination, and
+// passengers arriving at each landing, in sliding windows of time buckets.
+// Updates are O(1) and never allocate: moving a window on clears at most its
+// fixed number of buckets. Up-peak is most requests from the lobby, down-peak
+// most requests to it, and two-way anything else busy enough not to be idle.
+// A mode is only left once its share has fallen clearly below the share that
+// entered it, so the bank doesn't flap between policies at a boundary.
+//
+// Fed from the bank controller's thread; not thread-safe.
+//
+#ifndef ELEVATOR_TRAFFIC_MODE_HPP
+#define ELEVATOR_TRAFFIC_MODE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// A count over the last BUCKETS buckets of time.
+class ElevatorSlidingCounter
+{
+public:
+    enum Window
+    {
+        BUCKETS     = 10,
+        BUCKET_MSEC = 30000,
+        WINDOW_MSEC = BUCKETS * BUCKET_MSEC,
+    };
+
+    ElevatorSlidingCounter();
+
+    void add(uint64_t nowMsec, uint32_t count = 1)
+    {
+        advance(nowMsec / BUCKET_MSEC);
+        buckets_[epoch_ % BUCKETS] += count;
+        total_                     += count;
+    }
+
+    uint32_t total(uint64_t nowMsec)
+    {
+        advance(nowMsec / BUCKET_MSEC);
+        return total_;
+    }
+
+private:
+    // Drop the buckets that have fallen out of the window by the epoch.
+    void advance(uint64_t epoch);
+
+    uint64_t epoch_;    // Bucket the latest count went into.
+    uint32_t total_;
+    uint32_t buckets_[BUCKETS];
+};
+
+class ElevatorTrafficClassifier
+{
+public:
+    explicit ElevatorTrafficClassifier(size_t floors);
+
+    enum Mode
+    {
+        MODE_IDLE,
+        MODE_UP_PEAK,
+        MODE_DOWN_PEAK,
+        MODE_TWO_WAY,
+        MODES,
+    };
+
+    enum Limits
+    {
+        MAX_FLOORS = 63,
+    };
+
+    enum Thresholds
+    {
+        IDLE_REQUESTS      = 6,     // Per window: fewer is idle.
+        PEAK_ENTER_PERCENT = 60,    // Of requests, from or to the lobby.
+        PEAK_LEAVE_PERCENT = 45,
+    };
+
+    static const char *modeName(Mode mode);
+
+    // A passenger arrived at a landing: a hall call, or a destination keypad
+    // entry at its origin.
+    void arrival(size_t floor, uint64_t nowMsec);
+
+    // A floor requested from a car at the origin, or at a destination keypad.
+    void floorRequest(size_t origin, size_t destination, uint64_t nowMsec);
+
+    // Reclassify from the windows as of now.
+    Mode classify(uint64_t nowMsec);
+
+    Mode mode() const { return mode_; }
+
+    // Counts in the window.
+    uint32_t requests(uint64_t nowMsec) { return requests_.total(nowMsec); }
+    uint32_t arrivals(size_t floor, uint64_t nowMsec) { return arrivals_[clamp(floor)].total(nowMsec); }
+    uint32_t destinations(size_t floor, uint64_t nowMsec) { return destinations_[clamp(floor)].total(nowMsec); }
+
+private:
+    size_t clamp(size_t floor) const { return (floor <= floors_) ? floor : floors_; }
+
+    size_t floors_;
+    Mode   mode_;
+
+    ElevatorSlidingCounter requests_;
+    ElevatorSlidingCounter fromLobby_;
+    ElevatorSlidingCounter toLobby_;
+    ElevatorSlidingCounter arrivals_[MAX_FLOORS + 1];
+    ElevatorSlidingCounter destinations_[MAX_FLOORS + 1];
+};
+
+// What the bank does differently in each traffic mode.
+struct ElevatorTrafficPolicy
+{
+    enum Parking
+    {
+        PARK_IN_PLACE,      // Idle cars stay where they stopped.
+        PARK_AT_LOBBY,
+        PARK_AT_BUSIEST,    // Spread over the floors with the most arrivals.
+    };
+
+    enum Ordering
+    {
+        ORDER_NEAREST,      // An empty car's first stop is the nearest.
+        ORDER_LOBBY_FIRST,  // The lobby, if it's calling.
+        ORDER_TOP_DOWN,     // The highest call, collecting on the way down.
+    };
+
+    enum Dwell
+    {
+        // Within the FSM's dwell, so the doors aren't closed on the bank.
+        LOBBY_DWELL_MSEC = 6000,
+    };
+
+    Parking  parking;
+    Ordering ordering;
+    size_t   lobbyDwellMsec;    // Hold doors open at the lobby to fill cars.
+
+    // The policy for a mode. Idle is also the policy without classifying.
+    static ElevatorTrafficPolicy forMode(ElevatorTrafficClassifier::Mode mode);
+};
+
+#endif // ELEVATOR_TRAFFIC_MODE_HPP
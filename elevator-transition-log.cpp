@@ -0,0 +1,444 @@
+// Elevator transition log: columnar block writer and memory-mapped reader.
+//
+#include "elevator-transition-log.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+static_assert(sizeof(ElevatorTransitionBlock) == 64, "block header layout is persisted");
+static_assert(ElevatorFsm::STATE_IDS <= 16, "state ids must pack into nibbles");
+
+namespace
+{
+
+size_t putVarint(uint8_t *out, uint64_t value)
+{
+    size_t bytes = 0;
+
+    while (value >= 0x80)
+    {
+        out[bytes++] = static_cast<uint8_t>(value | 0x80);
+        value >>= 7;
+    }
+    out[bytes++] = static_cast<uint8_t>(value);
+    return bytes;
+}
+
+// Decode within the column: the header checksum doesn't cover the columns,
+// so a corrupt byte must not run the decoder past the column's end. A varint
+// cut off by the end is what it has so far, and any after it are 0.
+uint64_t getVarint(const uint8_t *&in, const uint8_t *end)
+{
+    uint64_t value = 0;
+
+    for (unsigned shift = 0; in < end; shift += 7)
+    {
+        uint8_t byte = *in++;
+
+        if (shift < 64)
+        {
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        }
+        if (!(byte & 0x80))
+        {
+            break;
+        }
+    }
+    return value;
+}
+
+// Times are almost always in order, so deltas are small and non-negative;
+// zigzag keeps an out-of-order one small too.
+uint64_t zigzag(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+int64_t unzigzag(uint64_t value)
+{
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+} // namespace
+
+//---------- Struct ElevatorTransitionBlock Implementation --------------------
+
+uint32_t ElevatorTransitionBlock::computeChecksum() const
+{
+    ElevatorTransitionBlock copy = *this;
+    uint8_t                 bytes[sizeof(copy)];
+    uint32_t                hash = 2166136261u;     // FNV-1a.
+
+    copy.headerChecksum = 0;
+    memcpy(bytes, &copy, sizeof(bytes));
+    for (uint8_t byte : bytes)
+    {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    return hash;
+}
+
+//---------- Class ElevatorTransitionLog Implementation -----------------------
+
+ElevatorTransitionLog::ElevatorTransitionLog()
+    : fd_(-1)
+    , epochMsec_(0)
+    , lastTimeMsec_(0)
+    , rows_(0)
+    , blocks_(0)
+    , fileBytes_(0)
+    , failedWrites_(0)
+{
+    block_.reserve(sizeof(header_) + sizeof(times_) + sizeof(states_) +
+                   sizeof(cars_) + sizeof(floors_) + 8);
+    startBlock();
+}
+
+ElevatorTransitionLog::~ElevatorTransitionLog()
+{
+    close();
+}
+
+bool ElevatorTransitionLog::open(const char *path, uint64_t epochMsec)
+{
+    close();
+
+    fd_ = ::open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    fileBytes_ = (fstat(fd_, &status) == 0) ? static_cast<size_t>(status.st_size) : 0;
+    epochMsec_ = epochMsec;
+    return true;
+}
+
+void ElevatorTransitionLog::close()
+{
+    if (fd_ >= 0)
+    {
+        flush();
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+void ElevatorTransitionLog::startBlock()
+{
+    memset(&header_, 0, sizeof(header_));
+    header_.magic   = ElevatorTransitionBlock::MAGIC;
+    header_.version = ElevatorTransitionBlock::VERSION;
+    timeBytes_  = 0;
+    carBytes_   = 0;
+    floorBytes_ = 0;
+}
+
+void ElevatorTransitionLog::record(size_t car, ElevatorFsm::StateId from, ElevatorFsm::StateId to,
+                                   size_t floor, size_t nowMsec)
+{
+    uint64_t timeMsec = epochMsec_ + nowMsec;
+    uint16_t car16    = static_cast<uint16_t>(car);
+    uint16_t floor16  = static_cast<uint16_t>(floor);
+
+    if (header_.rows == 0)
+    {
+        header_.firstTimeMsec = timeMsec;
+        header_.minTimeMsec   = timeMsec;
+        header_.maxTimeMsec   = timeMsec;
+        header_.minCar        = car16;
+        header_.maxCar        = car16;
+        header_.minFloor      = floor16;
+        header_.maxFloor      = floor16;
+        lastTimeMsec_         = timeMsec;
+    }
+
+    timeBytes_  += putVarint(&times_[timeBytes_],
+                             zigzag(static_cast<int64_t>(timeMsec - lastTimeMsec_)));
+    carBytes_   += putVarint(&cars_[carBytes_], car16);
+    floorBytes_ += putVarint(&floors_[floorBytes_], floor16);
+    states_[header_.rows] = static_cast<uint8_t>((from << 4) | to);
+    lastTimeMsec_ = timeMsec;
+
+    header_.minTimeMsec = std::min(header_.minTimeMsec, timeMsec);
+    header_.maxTimeMsec = std::max(header_.maxTimeMsec, timeMsec);
+    header_.minCar      = std::min(header_.minCar, car16);
+    header_.maxCar      = std::max(header_.maxCar, car16);
+    header_.minFloor    = std::min(header_.minFloor, floor16);
+    header_.maxFloor    = std::max(header_.maxFloor, floor16);
+    header_.fromStates |= static_cast<uint16_t>(1u << from);
+    header_.toStates   |= static_cast<uint16_t>(1u << to);
+    ++rows_;
+
+    if (++header_.rows == ElevatorTransitionBlock::MAX_ROWS)
+    {
+        flush();
+    }
+}
+
+bool ElevatorTransitionLog::flush()
+{
+    if (header_.rows == 0)
+    {
+        return true;
+    }
+
+    header_.timeBytes      = static_cast<uint32_t>(timeBytes_);
+    header_.carBytes       = static_cast<uint32_t>(carBytes_);
+    header_.floorBytes     = static_cast<uint32_t>(floorBytes_);
+    header_.headerChecksum = header_.computeChecksum();
+
+    const uint8_t *header = reinterpret_cast<const uint8_t *>(&header_);
+
+    block_.assign(header, header + sizeof(header_));
+    block_.insert(block_.end(), times_, times_ + timeBytes_);
+    block_.insert(block_.end(), states_, states_ + header_.rows);
+    block_.insert(block_.end(), cars_, cars_ + carBytes_);
+    block_.insert(block_.end(), floors_, floors_ + floorBytes_);
+    block_.resize(header_.bytes(), 0);
+
+    // One write per block: a crash leaves at most a torn tail. Without a
+    // file the block is dropped, like one lost in a crash.
+    bool written = (fd_ >= 0) &&
+        (::write(fd_, block_.data(), block_.size()) == static_cast<ssize_t>(block_.size()));
+
+    if (written)
+    {
+        fileBytes_ += block_.size();
+        ++blocks_;
+    }
+    else
+    {
+        ++failedWrites_;
+    }
+
+    startBlock();
+    return written;
+}
+
+//---------- Class ElevatorTransitionLogReader Implementation -----------------
+
+ElevatorTransitionLogReader::ElevatorTransitionLogReader()
+    : fd_(-1)
+    , map_(nullptr)
+    , bytes_(0)
+    , indexedBytes_(0)
+{
+}
+
+ElevatorTransitionLogReader::~ElevatorTransitionLogReader()
+{
+    close();
+}
+
+bool ElevatorTransitionLogReader::open(const char *path)
+{
+    close();
+
+    fd_ = ::open(path, O_RDONLY);
+    if (fd_ < 0)
+    {
+        return false;
+    }
+
+    struct stat status;
+    if (fstat(fd_, &status) != 0)
+    {
+        close();
+        return false;
+    }
+
+    bytes_ = static_cast<size_t>(status.st_size);
+    if (bytes_ == 0)
+    {
+        return true;
+    }
+
+    void *map = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (map == MAP_FAILED)
+    {
+        close();
+        return false;
+    }
+    map_ = static_cast<const uint8_t *>(map);
+
+    // Index by walking the headers; the columns aren't touched until a query
+    // needs them.
+    size_t offset = 0;
+    while (bytes_ - offset >= sizeof(ElevatorTransitionBlock))
+    {
+        const ElevatorTransitionBlock *block =
+            reinterpret_cast<const ElevatorTransitionBlock *>(map_ + offset);
+
+        if ((block->magic != ElevatorTransitionBlock::MAGIC) ||
+            (block->version != ElevatorTransitionBlock::VERSION) ||
+            (block->headerChecksum != block->computeChecksum()) ||
+            (block->rows == 0) || (block->rows > ElevatorTransitionBlock::MAX_ROWS) ||
+            (block->bytes() > bytes_ - offset))
+        {
+            break;
+        }
+
+        blocks_.push_back(block);
+        offset += block->bytes();
+    }
+
+    indexedBytes_ = offset;
+    return true;
+}
+
+void ElevatorTransitionLogReader::close()
+{
+    blocks_.clear();
+    if (map_)
+    {
+        munmap(const_cast<uint8_t *>(map_), bytes_);
+        map_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    bytes_        = 0;
+    indexedBytes_ = 0;
+}
+
+void ElevatorTransitionLogReader::times(size_t index, uint64_t *timeMsec) const
+{
+    decodeTimes(index, timeMsec, block(index).rows);
+}
+
+void ElevatorTransitionLogReader::decodeTimes(size_t index, uint64_t *timeMsec, size_t rows) const
+{
+    const ElevatorTransitionBlock &header = block(index);
+    const uint8_t *in   = column(index, header.timeOffset());
+    const uint8_t *end  = in + header.timeBytes;
+    uint64_t       time = header.firstTimeMsec;
+
+    for (size_t row = 0; row < rows; ++row)
+    {
+        time += static_cast<uint64_t>(unzigzag(getVarint(in, end)));
+        timeMsec[row] = time;
+    }
+}
+
+void ElevatorTransitionLogReader::states(size_t index, uint8_t *from, uint8_t *to) const
+{
+    const ElevatorTransitionBlock &header = block(index);
+    const uint8_t *in = column(index, header.stateOffset());
+
+    for (size_t row = 0; row < header.rows; ++row)
+    {
+        from[row] = in[row] >> 4;
+        to[row]   = in[row] & 0x0f;
+    }
+}
+
+void ElevatorTransitionLogReader::cars(size_t index, uint16_t *car) const
+{
+    decodeCars(index, car, block(index).rows);
+}
+
+void ElevatorTransitionLogReader::decodeCars(size_t index, uint16_t *car, size_t rows) const
+{
+    const uint8_t *in  = column(index, block(index).carOffset());
+    const uint8_t *end = in + block(index).carBytes;
+
+    for (size_t row = 0; row < rows; ++row)
+    {
+        car[row] = static_cast<uint16_t>(getVarint(in, end));
+    }
+}
+
+void ElevatorTransitionLogReader::floors(size_t index, uint16_t *floor) const
+{
+    const ElevatorTransitionBlock &header = block(index);
+    const uint8_t *in  = column(index, header.floorOffset());
+    const uint8_t *end = in + header.floorBytes;
+
+    for (size_t row = 0; row < header.rows; ++row)
+    {
+        floor[row] = static_cast<uint16_t>(getVarint(in, end));
+    }
+}
+
+size_t ElevatorTransitionLogReader::countPerCarDay(ElevatorFsm::StateId from, ElevatorFsm::StateId to,
+                                                   CarDayCounts &counts) const
+{
+    const uint8_t packed = static_cast<uint8_t>((from << 4) | to);
+    uint16_t      matches[ElevatorTransitionBlock::MAX_ROWS];
+    uint64_t      timeMsec[ElevatorTransitionBlock::MAX_ROWS];
+    uint16_t      car[ElevatorTransitionBlock::MAX_ROWS];
+    size_t        read = 0;
+
+    for (size_t index = 0; index < blocks_.size(); ++index)
+    {
+        const ElevatorTransitionBlock &header = block(index);
+
+        if (!(header.fromStates & (1u << from)) || !(header.toStates & (1u << to)))
+        {
+            continue;
+        }
+
+        // Match on the packed state bytes without decoding them.
+        const uint8_t *state = column(index, header.stateOffset());
+        size_t         found = 0;
+
+        ++read;
+        for (size_t row = 0; row < header.rows; ++row)
+        {
+            if (state[row] == packed)
+            {
+                matches[found++] = static_cast<uint16_t>(row);
+            }
+        }
+
+        if (found == 0)
+        {
+            continue;
+        }
+
+        // Varints decode in sequence, so only up to the last match, and not
+        // at all where the index pins the column to one value.
+        size_t rows     = matches[found - 1] + 1;
+        bool   oneCar   = (header.minCar == header.maxCar);
+        bool   oneDay   = (header.minTimeMsec / DAY_MSEC == header.maxTimeMsec / DAY_MSEC);
+
+        if (!oneDay)
+        {
+            decodeTimes(index, timeMsec, rows);
+        }
+        if (!oneCar)
+        {
+            decodeCars(index, car, rows);
+        }
+        for (size_t match = 0; match < found; ++match)
+        {
+            size_t row = matches[match];
+            ++counts[std::make_pair(size_t(oneCar ? header.minCar : car[row]),
+                                    (oneDay ? header.minTimeMsec : timeMsec[row]) / DAY_MSEC)];
+        }
+    }
+
+    return read;
+}
+
+bool ElevatorTransitionLogReader::parseState(const char *name, ElevatorFsm::StateId &state)
+{
+    for (size_t id = 0; id < ElevatorFsm::STATE_IDS; ++id)
+    {
+        if (strcmp(name, ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(id))) == 0)
+        {
+            state = static_cast<ElevatorFsm::StateId>(id);
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,225 @@
+// Elevator transition log: long-term, append-only history of ElevatorFsm
+// state changes for maintenance analytics, such as how often each car's door
+// fails to open.
+//
+// Transitions are stored in columnar blocks of up to MAX_ROWS rows. Each
+// column is encoded on its own, so a query reads only the columns it needs:
+// - time: milliseconds since the Unix epoch, as zigzag varint deltas from the
+//   previous row, starting from the block's first time;
+// - states: one byte per row, the from and to StateIds packed in nibbles;
+// - car and floor: varints.
+// The block header indexes the block with the time, car, and floor ranges and
+// the sets of from and to states present, so a query can skip whole blocks.
+//
+// The writer encodes each transition into the open block as it happens and
+// appends the block to the file with one write when it fills, so a block is
+// either wholly in the file or, after a crash mid-write, a torn tail the
+// reader ignores. Transitions in the open block are lost in a crash; flush()
+// at shutdown. Reopening a file appends to it.
+//
+// record() is not thread-safe: a log shared by a bank of cars whose FSMs run
+// on different threads needs a lock around it, or a log per thread.
+//
+// The header checksum covers the header and its column sizes, not the
+// columns. The reader decodes each column within its size, so a corrupt
+// column byte garbles that column's values but never reads past it.
+//
+// Blocks are in native byte order: they are read back on the controller or a
+// maintenance host of the same architecture.
+//
+#ifndef ELEVATOR_TRANSITION_LOG_HPP
+#define ELEVATOR_TRANSITION_LOG_HPP
+
+#include "elevator-fsm.hpp"
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+struct ElevatorTransitionBlock
+{
+    enum Format
+    {
+        MAGIC    = 0x4c544c45,      // "ELTL"
+        VERSION  = 1,
+        MAX_ROWS = 4096,
+    };
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t rows;
+    uint32_t timeBytes;
+    uint32_t carBytes;
+    uint32_t floorBytes;            // The state column is one byte per row.
+    uint32_t headerChecksum;
+    uint64_t firstTimeMsec;
+    uint64_t minTimeMsec;
+    uint64_t maxTimeMsec;
+    uint16_t minCar;
+    uint16_t maxCar;
+    uint16_t minFloor;
+    uint16_t maxFloor;
+    uint16_t fromStates;            // Bit per StateId present.
+    uint16_t toStates;
+    uint32_t reserved;
+
+    // Bytes of header and columns, padded so the next header is aligned.
+    size_t bytes() const
+    {
+        return (sizeof(*this) + timeBytes + rows + carBytes + floorBytes + 7) & ~size_t(7);
+    }
+
+    // Column offsets from the header.
+    size_t timeOffset() const  { return sizeof(*this); }
+    size_t stateOffset() const { return timeOffset() + timeBytes; }
+    size_t carOffset() const   { return stateOffset() + rows; }
+    size_t floorOffset() const { return carOffset() + carBytes; }
+
+    uint32_t computeChecksum() const;
+};
+
+// Writer for one file, shared by a bank of cars through a recorder per car.
+class ElevatorTransitionLog
+{
+public:
+    ElevatorTransitionLog();
+    ~ElevatorTransitionLog();
+
+    // Append to the file, creating it if need be. The FSM's clock reads
+    // epochMsec, Unix time in milliseconds, at nowMsec() == 0.
+    bool open(const char *path, uint64_t epochMsec);
+
+    // Flush and close.
+    void close();
+
+    // Append the open block, even if it isn't full.
+    bool flush();
+
+    void record(size_t car, ElevatorFsm::StateId from, ElevatorFsm::StateId to,
+                size_t floor, size_t nowMsec);
+
+    bool   isOpen() const { return fd_ >= 0; }
+    size_t rows() const { return rows_; }
+    size_t blocks() const { return blocks_; }
+    size_t fileBytes() const { return fileBytes_; }
+    size_t failedWrites() const { return failedWrites_; }
+
+private:
+    ElevatorTransitionLog(const ElevatorTransitionLog &) = delete;
+    ElevatorTransitionLog &operator=(const ElevatorTransitionLog &) = delete;
+
+    enum Limits
+    {
+        // Longest varint for each column.
+        TIME_BYTES  = 10,
+        VALUE_BYTES = 3,
+    };
+
+    void startBlock();
+
+    int      fd_;
+    uint64_t epochMsec_;
+    uint64_t lastTimeMsec_;
+    size_t   rows_;
+    size_t   blocks_;
+    size_t   fileBytes_;
+    size_t   failedWrites_;
+
+    ElevatorTransitionBlock header_;
+    size_t  timeBytes_;
+    size_t  carBytes_;
+    size_t  floorBytes_;
+    uint8_t times_[ElevatorTransitionBlock::MAX_ROWS * TIME_BYTES];
+    uint8_t states_[ElevatorTransitionBlock::MAX_ROWS];
+    uint8_t cars_[ElevatorTransitionBlock::MAX_ROWS * VALUE_BYTES];
+    uint8_t floors_[ElevatorTransitionBlock::MAX_ROWS * VALUE_BYTES];
+    std::vector<uint8_t> block_;    // Assembled for the write.
+};
+
+// Records one car's transitions into a shared log.
+class ElevatorTransitionRecorder
+    : public ElevatorTransitionObserver
+{
+public:
+    ElevatorTransitionRecorder(ElevatorTransitionLog &log, size_t car)
+        : log_(log)
+        , car_(car)
+        {}
+
+    virtual void onTransition(
+        ElevatorFsm::StateId from,
+        ElevatorFsm::StateId to,
+        size_t               floor,
+        size_t               nowMsec)
+    {
+        log_.record(car_, from, to, floor, nowMsec);
+    }
+
+private:
+    ElevatorTransitionLog &log_;
+    size_t                 car_;
+};
+
+// Memory-mapped reader for queries.
+class ElevatorTransitionLogReader
+{
+public:
+    ElevatorTransitionLogReader();
+    ~ElevatorTransitionLogReader();
+
+    // Map the file and index its blocks, up to the first torn or corrupt one.
+    bool open(const char *path);
+    void close();
+
+    size_t blocks() const { return blocks_.size(); }
+    const ElevatorTransitionBlock &block(size_t index) const { return *blocks_[index]; }
+    size_t fileBytes() const { return bytes_; }
+    size_t indexedBytes() const { return indexedBytes_; }
+
+    // Decode one column of a block into arrays of block().rows entries.
+    void times(size_t index, uint64_t *timeMsec) const;
+    void states(size_t index, uint8_t *from, uint8_t *to) const;
+    void cars(size_t index, uint16_t *car) const;
+    void floors(size_t index, uint16_t *floor) const;
+
+    // Per (car, UTC day number) counts.
+    typedef std::map<std::pair<size_t, uint64_t>, size_t> CarDayCounts;
+
+    // Count transitions from one state to another per car per day. Reads the
+    // state column of blocks whose index says both states are present, then
+    // the time and car columns of blocks with a match, up to the last match,
+    // unless the index pins the block to one car or day. Returns the number
+    // of blocks whose columns were read.
+    size_t countPerCarDay(ElevatorFsm::StateId from, ElevatorFsm::StateId to,
+                          CarDayCounts &counts) const;
+
+    enum Time
+    {
+        DAY_MSEC = 24 * 60 * 60 * 1000,
+    };
+
+    // The state named as by ElevatorFsm::stateName(). Returns false for an
+    // unknown name.
+    static bool parseState(const char *name, ElevatorFsm::StateId &state);
+
+private:
+    ElevatorTransitionLogReader(const ElevatorTransitionLogReader &) = delete;
+    ElevatorTransitionLogReader &operator=(const ElevatorTransitionLogReader &) = delete;
+
+    void decodeTimes(size_t index, uint64_t *timeMsec, size_t rows) const;
+    void decodeCars(size_t index, uint16_t *car, size_t rows) const;
+
+    const uint8_t *column(size_t index, size_t offset) const
+    {
+        return reinterpret_cast<const uint8_t *>(blocks_[index]) + offset;
+    }
+
+    int            fd_;
+    const uint8_t *map_;
+    size_t         bytes_;
+    size_t         indexedBytes_;
+    std::vector<const ElevatorTransitionBlock *> blocks_;
+};
+
+#endif // ELEVATOR_TRANSITION_LOG_HPP
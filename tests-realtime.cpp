@@ -0,0 +1,718 @@
+// Realtime guarantees for the FSM hot path: event handlers must never
+// allocate, and must have a bounded worst-case execution time.
+//
+// This program replaces the global allocator entry points, operator new and
+// malloc and friends, with ones that count calls on the calling thread while
+// a check is armed. The checks arm around each event handler call only, so
+// building the FSM and Google Test's own bookkeeping are free to allocate.
+//
+// The latency test drives cars through millions of randomized events and
+// records the cycles each handler call takes, the worst seen per (state,
+// event) pair. Recorded to a baseline file on the target, it's a regression
+// gate: a later run fails if any pair's worst case overruns the baseline
+// times the margin plus the slack, seen at least twice so one preemption
+// doesn't fail the run.
+//
+// Usage: runTestsRealtime [gtest options] [--events=N] [--record=FILE]
+//                         [--baseline=FILE] [--margin=X] [--slack=CYCLES]
+//
+#include "elevator-fsm.cpp"
+#include "elevator-drive-model.cpp"
+#include "elevator-timing-cache.cpp"
+#include "elevator-snapshot.cpp"
+#include "elevator-transition-log.cpp"
+#include "elevator-metrics.cpp"
+#include "elevator-shaft.cpp"
+#include "elevator-bench.hpp"
+#include "elevator-fleet.hpp"
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+//---------- Allocation counting ----------------------------------------------
+
+extern "C"
+{
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *memory, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void  __libc_free(void *memory);
+}
+
+namespace
+{
+
+// Constant-initialized, so reading them never allocates.
+thread_local bool   allocationsArmed = false;
+thread_local size_t threadAllocations   = 0;
+thread_local size_t threadDeallocations = 0;
+
+inline void countAllocation()
+{
+    if (allocationsArmed)
+    {
+        ++threadAllocations;
+    }
+}
+
+}
+
+extern "C"
+{
+
+void *malloc(size_t size) noexcept
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *memory, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_realloc(memory, size);
+}
+
+void *aligned_alloc(size_t alignment, size_t size) noexcept
+{
+    countAllocation();
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void **memory, size_t alignment, size_t size) noexcept
+{
+    countAllocation();
+    *memory = __libc_memalign(alignment, size);
+    return *memory ? 0 : ENOMEM;
+}
+
+void free(void *memory) noexcept
+{
+    if (memory && allocationsArmed)
+    {
+        ++threadDeallocations;
+    }
+    __libc_free(memory);
+}
+
+}
+
+// Through malloc, so each allocation counts once.
+void *operator new(size_t size)
+{
+    void *memory = malloc(size ? size : 1);
+    if (!memory)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t &) noexcept
+{
+    return malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+    return malloc(size ? size : 1);
+}
+
+void operator delete(void *memory) noexcept               { free(memory); }
+void operator delete[](void *memory) noexcept             { free(memory); }
+void operator delete(void *memory, size_t) noexcept       { free(memory); }
+void operator delete[](void *memory, size_t) noexcept     { free(memory); }
+
+namespace
+{
+
+// Counts the allocations and frees on this thread while in scope.
+class AllocationCheck
+{
+public:
+    AllocationCheck()
+        : allocations_(threadAllocations)
+        , deallocations_(threadDeallocations)
+    {
+        allocationsArmed = true;
+    }
+
+    ~AllocationCheck()
+    {
+        allocationsArmed = false;
+    }
+
+    size_t allocations() const { return threadAllocations - allocations_; }
+    size_t deallocations() const { return threadDeallocations - deallocations_; }
+
+private:
+    size_t allocations_;
+    size_t deallocations_;
+};
+
+//---------- Options ----------------------------------------------------------
+
+size_t      eventsOption   = 2000000;
+double      marginOption   = 2.0;
+uint64_t    slackOption    = 300;
+const char *baselineOption = nullptr;
+const char *recordOption   = nullptr;
+
+//---------- Cycle counting ---------------------------------------------------
+
+// Time stamp counter cycles on x86, fenced so the handler runs between the
+// reads; steady clock nanoseconds elsewhere.
+inline uint64_t cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_lfence();
+    uint64_t now = __rdtsc();
+    _mm_lfence();
+    return now;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+//---------- Randomized events ------------------------------------------------
+
+// The FSM's events, and recovery from a snapshot.
+enum RealtimeEvent
+{
+    EVENT_RECOVER = ElevatorFsm::EVENT_IDS,
+    EVENTS,
+};
+
+const char *realtimeEventName(size_t event)
+{
+    return (event == EVENT_RECOVER) ? "Recover"
+                                    : ElevatorFsm::eventName(static_cast<ElevatorFsm::EventId>(event));
+}
+
+// A car on bench components, built before any check is armed.
+struct RealtimeCar
+{
+    enum
+    {
+        FLOORS = 20,
+    };
+
+    enum Collaborators
+    {
+        BARE,
+        HOT_PATH,   // Drive model, metrics, snapshot slot, timer coalescing,
+                    // and a shaft shared with a parked upper car.
+        LOGGED,     // And a transition log, which writes a block at a time.
+    };
+
+    RealtimeCar(Collaborators collaborators, ElevatorTransitionLog &log)
+        : fsm(bench.ui, bench.door, bench.drive, bench.timer)
+        , driveModel(ElevatorDriveProfile{ 2.5, 1.0, 1.2 }, 3.5, FLOORS)
+        , metrics(1)
+        , recorder(log, 0)
+        , slot()
+        , shaft(ElevatorFsm::GROUND_FLOOR + FLOORS - 1)
+    {
+        if (collaborators != BARE)
+        {
+            fsm.setDriveModel(&driveModel);
+            fsm.setMetrics(&metrics, 0);
+            fsm.setSnapshotSlot(&slot);
+            fsm.setTimerCoalescing(true, 500);
+
+            // The upper car never moves, so trips past it are reordered or
+            // held, as well as reserved.
+            shaft.park(ElevatorShaft::UPPER_CAR, ElevatorFsm::GROUND_FLOOR + FLOORS * 3 / 4);
+            fsm.setShaft(&shaft, ElevatorShaft::LOWER_CAR);
+        }
+        if (collaborators == LOGGED)
+        {
+            fsm.setTransitionObserver(&recorder);
+        }
+        fsm.snapshot(image);
+        image.seal(1);
+    }
+
+    BenchCar                   bench;
+    ElevatorFsm                fsm;
+    ElevatorDriveModel         driveModel;
+    ElevatorMetrics            metrics;
+    ElevatorTransitionRecorder recorder;
+    ElevatorSnapshotSlot       slot;
+    ElevatorShaft              shaft;
+    ElevatorSnapshot           image;      // Recovered from.
+};
+
+// An event with its parameters drawn, so drawing them isn't timed.
+struct RealtimeCall
+{
+    size_t event;
+    size_t value;
+    size_t floors[ElevatorFsm::MAX_STOPS + 2];
+    size_t count;
+
+    void draw(std::mt19937 &random)
+    {
+        event = random() % EVENTS;
+        value = ElevatorFsm::GROUND_FLOOR + random() % RealtimeCar::FLOORS;
+        count = random() % (ElevatorFsm::MAX_STOPS + 2);
+        for (size_t stop = 0; stop < count; ++stop)
+        {
+            floors[stop] = ElevatorFsm::GROUND_FLOOR + random() % RealtimeCar::FLOORS;
+        }
+    }
+
+    void fire(RealtimeCar &car) const
+    {
+        ElevatorFsm &fsm = car.fsm;
+
+        switch (event)
+        {
+        case ElevatorFsm::EVENT_FLOOR_REQUEST:
+            fsm.handleFloorRequest(value);
+            break;
+        case ElevatorFsm::EVENT_HALL_CALL:
+            fsm.handleHallCall(value);
+            break;
+        case ElevatorFsm::EVENT_STOP_LIST:
+            fsm.handleStopList(floors, count);
+            break;
+        case ElevatorFsm::EVENT_OPEN_BUTTON:
+            fsm.handleOpenButton();
+            break;
+        case ElevatorFsm::EVENT_CLOSE_BUTTON:
+            fsm.handleCloseButton();
+            break;
+        case ElevatorFsm::EVENT_STOP_BUTTON:
+            fsm.handleStopButton();
+            break;
+        case ElevatorFsm::EVENT_RESTORE_SERVICE:
+            fsm.handleRestoreService();
+            break;
+        case ElevatorFsm::EVENT_DOORS_OPENED:
+            fsm.handleOpened();
+            break;
+        case ElevatorFsm::EVENT_DOORS_CLOSED:
+            fsm.handleClosed();
+            break;
+        case ElevatorFsm::EVENT_DOOR_FAULT:
+            fsm.handleDoorFault();
+            break;
+        case ElevatorFsm::EVENT_ARRIVED:
+            fsm.handleArrived();
+            break;
+        case ElevatorFsm::EVENT_DRIVE_FAULT:
+            fsm.handleDriveFault();
+            break;
+        case ElevatorFsm::EVENT_TIMER:
+            fsm.handleExpired();
+            break;
+        default:
+            fsm.recover(&car.image);
+            break;
+        }
+    }
+};
+
+//---------- Latency table ----------------------------------------------------
+
+// Worst and second worst cycles per (state, event) pair.
+class LatencyTable
+{
+public:
+    LatencyTable()
+        : entries_()
+        {}
+
+    void record(ElevatorFsm::StateId state, size_t event, uint64_t cycles)
+    {
+        Entry &entry = entries_[state][event];
+
+        ++entry.count;
+        if (cycles > entry.worst)
+        {
+            entry.second = entry.worst;
+            entry.worst  = cycles;
+        }
+        else if (cycles > entry.second)
+        {
+            entry.second = cycles;
+        }
+    }
+
+    enum Column
+    {
+        SECOND_WORST,   // As gated.
+        WORST,
+    };
+
+    // Worst or second worst case in thousands of cycles, a row per state;
+    // "-" for pairs never seen.
+    void print(Column column) const
+    {
+        printf("%-14s", "kcycles");
+        for (size_t event = 0; event < EVENTS; ++event)
+        {
+            printf(" %6.6s", realtimeEventName(event));
+        }
+        printf("\n");
+
+        for (size_t state = 0; state < ElevatorFsm::STATE_IDS; ++state)
+        {
+            printf("%-14s", ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(state)));
+            for (size_t event = 0; event < EVENTS; ++event)
+            {
+                const Entry &entry = entries_[state][event];
+                if (entry.count)
+                {
+                    printf(" %6.1f", ((column == WORST) ? entry.worst : entry.second) / 1000.0);
+                }
+                else
+                {
+                    printf(" %6s", "-");
+                }
+            }
+            printf("\n");
+        }
+    }
+
+    // One line per pair seen: state, event, worst cycles.
+    bool save(const char *path) const
+    {
+        FILE *file = fopen(path, "w");
+        if (!file)
+        {
+            return false;
+        }
+
+        for (size_t state = 0; state < ElevatorFsm::STATE_IDS; ++state)
+        {
+            for (size_t event = 0; event < EVENTS; ++event)
+            {
+                const Entry &entry = entries_[state][event];
+                if (entry.count)
+                {
+                    fprintf(file, "%s %s %llu\n",
+                            ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(state)),
+                            realtimeEventName(event),
+                            static_cast<unsigned long long>(entry.worst));
+                }
+            }
+        }
+        return fclose(file) == 0;
+    }
+
+    // Pairs whose second worst case overruns the baseline's worst times the
+    // margin plus the slack, one per line. Pairs not in the baseline aren't
+    // gated.
+    bool check(const char *path, double margin, uint64_t slack, std::string &overruns) const
+    {
+        FILE *file = fopen(path, "r");
+        if (!file)
+        {
+            return false;
+        }
+
+        char               stateName[32];
+        char               eventName[32];
+        unsigned long long baseline;
+        while (fscanf(file, "%31s %31s %llu", stateName, eventName, &baseline) == 3)
+        {
+            for (size_t state = 0; state < ElevatorFsm::STATE_IDS; ++state)
+            {
+                for (size_t event = 0; event < EVENTS; ++event)
+                {
+                    const Entry &entry = entries_[state][event];
+                    if ((strcmp(stateName, ElevatorFsm::stateName(static_cast<ElevatorFsm::StateId>(state))) == 0) &&
+                        (strcmp(eventName, realtimeEventName(event)) == 0) &&
+                        (entry.second > baseline * margin + slack))
+                    {
+                        char line[160];
+                        snprintf(line, sizeof(line), "%s %s: %llu cycles (worst %llu), baseline %llu\n",
+                                 stateName, eventName,
+                                 static_cast<unsigned long long>(entry.second),
+                                 static_cast<unsigned long long>(entry.worst), baseline);
+                        overruns += line;
+                    }
+                }
+            }
+        }
+        fclose(file);
+        return true;
+    }
+
+    size_t pairs() const
+    {
+        size_t seen = 0;
+        for (size_t state = 0; state < ElevatorFsm::STATE_IDS; ++state)
+        {
+            for (size_t event = 0; event < EVENTS; ++event)
+            {
+                seen += entries_[state][event].count ? 1 : 0;
+            }
+        }
+        return seen;
+    }
+
+private:
+    struct Entry
+    {
+        uint64_t count;
+        uint64_t worst;
+        uint64_t second;
+    };
+
+    Entry entries_[ElevatorFsm::STATE_IDS][EVENTS];
+};
+
+}
+
+//---------- Given_AllocationCheck --------------------------------------------
+
+TEST(Given_AllocationCheck, Should_CountAllocations_When_Armed)
+{
+    size_t newed;
+    size_t malloced;
+    size_t freed;
+    size_t unarmed;
+
+    {
+        AllocationCheck check;
+        delete new int(1);
+        newed = check.allocations();
+        free(malloc(16));
+        malloced = check.allocations() - newed;
+        freed    = check.deallocations();
+    }
+    {
+        AllocationCheck check;
+        unarmed = check.allocations();
+    }
+
+    ASSERT_EQ(1u, newed);
+    ASSERT_EQ(1u, malloced);
+    ASSERT_EQ(2u, freed);
+    ASSERT_EQ(0u, unarmed);
+}
+
+TEST(Given_AllocationCheck, Should_AllocateOnce_When_FleetBuilt)
+{
+    size_t allocations;
+    size_t deallocations;
+
+    {
+        AllocationCheck check;
+        {
+            ElevatorFleet<BenchCar> fleet(4000);
+        }
+        allocations   = check.allocations();
+        deallocations = check.deallocations();
+    }
+
+    ASSERT_EQ(1u, allocations);
+    ASSERT_EQ(1u, deallocations);
+}
+
+//---------- Given_RealtimeCar ------------------------------------------------
+
+class Given_RealtimeCar: public ::testing::Test {
+public:
+    enum
+    {
+        SEQUENCE_EVENTS = 200,
+        TWINS           = 2,
+    };
+
+    Given_RealtimeCar()
+        : random_(42)
+        , shaftRefusals_(0)
+    {
+        for (size_t twin = 0; twin < TWINS; ++twin)
+        {
+            paths_[twin] = "/tmp/elevator-realtime-test-" + std::to_string(getpid()) + "-" +
+                           std::to_string(twin) + ".log";
+        }
+    }
+
+    void SetUp( ) {
+        for (size_t twin = 0; twin < TWINS; ++twin)
+        {
+            ASSERT_TRUE(logs_[twin].open(paths_[twin].c_str(), 0));
+        }
+    }
+
+    void TearDown( ) {
+        for (size_t twin = 0; twin < TWINS; ++twin)
+        {
+            logs_[twin].close();
+            unlink(paths_[twin].c_str());
+        }
+    }
+
+    // Fire events in sequences on fresh cars, each handler call checked
+    // for allocations and timed. Twin cars, each with its own collaborators,
+    // take the same events, and a call's time is the faster twin's, so an
+    // interrupt or preemption has to hit both to count. Returns the first
+    // pair that allocated, if any, as "state event".
+    std::string run(size_t events, RealtimeCar::Collaborators collaborators, LatencyTable *table)
+    {
+        std::unique_ptr<RealtimeCar> cars[TWINS];
+        RealtimeCall                 call;
+
+        for (size_t fired = 0; fired < events; ++fired)
+        {
+            if (fired % SEQUENCE_EVENTS == 0)
+            {
+                if (cars[0])
+                {
+                    shaftRefusals_ += cars[0]->shaft.refusals();
+                }
+                for (size_t twin = 0; twin < TWINS; ++twin)
+                {
+                    cars[twin].reset(new RealtimeCar(collaborators, logs_[twin]));
+                }
+            }
+
+            call.draw(random_);
+            size_t advance  = random_() % 4000;
+            bool   snapshot = (random_() % 16 == 0);   // For a later recovery.
+
+            ElevatorFsm::StateId state  = cars[0]->fsm.stateId();
+            uint64_t             fastest = UINT64_MAX;
+            for (size_t twin = 0; twin < TWINS; ++twin)
+            {
+                RealtimeCar &car = *cars[twin];
+                size_t       allocated;
+                uint64_t     start;
+                uint64_t     end;
+
+                car.bench.timer.advance(advance);
+                if (snapshot)
+                {
+                    car.fsm.snapshot(car.image);
+                    car.image.seal(1);
+                }
+                {
+                    AllocationCheck check;
+
+                    start = cycles();
+                    call.fire(car);
+                    end = cycles();
+                    allocated = check.allocations() + check.deallocations();
+                }
+
+                if (allocated)
+                {
+                    return std::string(ElevatorFsm::stateName(state)) + " " + realtimeEventName(call.event);
+                }
+                fastest = std::min(fastest, end - start);
+            }
+
+            EXPECT_EQ(cars[0]->fsm.stateId(), cars[1]->fsm.stateId());
+            if (table)
+            {
+                table->record(state, call.event, fastest);
+            }
+        }
+        return std::string();
+    }
+
+    std::string           paths_[TWINS];
+    ElevatorTransitionLog logs_[TWINS];
+    std::mt19937          random_;
+    size_t                shaftRefusals_;   // Of the first twin's shafts.
+};
+
+TEST_F(Given_RealtimeCar, Should_NotAllocate_When_RandomEventsHandled)
+{
+    ASSERT_EQ("", run(100000, RealtimeCar::BARE, nullptr));
+}
+
+TEST_F(Given_RealtimeCar, Should_NotAllocate_When_EveryCollaboratorAttached)
+{
+    // Long enough for the transition log to write blocks.
+    ASSERT_EQ("", run(200000, RealtimeCar::LOGGED, nullptr));
+    ASSERT_GT(logs_[0].blocks(), 0u);
+    ASSERT_GT(shaftRefusals_, 0u);
+}
+
+TEST_F(Given_RealtimeCar, Should_StayWithinBaseline_When_RandomSequencesHandled)
+{
+    LatencyTable table;
+
+    // Not logged: writing a log block is a system call, with no bound.
+    ASSERT_EQ("", run(eventsOption, RealtimeCar::HOT_PATH, &table));
+
+    // The gate takes the second worst, so show the worst beside it: a
+    // one-off spike is still visible.
+    printf("Second worst case per state and event over %zu events, as gated:\n", eventsOption);
+    table.print(LatencyTable::SECOND_WORST);
+    printf("Worst case:\n");
+    table.print(LatencyTable::WORST);
+
+    // Every state is reachable, and each sees most events.
+    ASSERT_GT(table.pairs(), size_t(ElevatorFsm::STATE_IDS * EVENTS / 2));
+
+    if (recordOption)
+    {
+        ASSERT_TRUE(table.save(recordOption)) << recordOption;
+    }
+    if (baselineOption)
+    {
+        std::string overruns;
+        ASSERT_TRUE(table.check(baselineOption, marginOption, slackOption, overruns)) << baselineOption;
+        ASSERT_EQ("", overruns);
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+
+    for (int arg = 1; arg < argc; ++arg)
+    {
+        if (strncmp(argv[arg], "--events=", 9) == 0)
+        {
+            eventsOption = strtoull(argv[arg] + 9, nullptr, 10);
+        }
+        else if (strncmp(argv[arg], "--margin=", 9) == 0)
+        {
+            marginOption = strtod(argv[arg] + 9, nullptr);
+        }
+        else if (strncmp(argv[arg], "--slack=", 8) == 0)
+        {
+            slackOption = strtoull(argv[arg] + 8, nullptr, 10);
+        }
+        else if (strncmp(argv[arg], "--baseline=", 11) == 0)
+        {
+            baselineOption = argv[arg] + 11;
+        }
+        else if (strncmp(argv[arg], "--record=", 9) == 0)
+        {
+            recordOption = argv[arg] + 9;
+        }
+    }
+
+    return RUN_ALL_TESTS();
+}
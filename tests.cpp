@@ -1,6 +1,20 @@
 #include "elevator-fsm.cpp"
+#include "elevator-dispatch.cpp"
+#include "elevator-drive-model.cpp"
+#include "elevator-energy-model.cpp"
+#include "elevator-timing-cache.cpp"
+#include "elevator-snapshot.cpp"
+#include "elevator-standby.cpp"
+#include "elevator-transition-log.cpp"
+#include "elevator-metrics.cpp"
+#include "elevator-shaft.cpp"
+#include "elevator-traffic-mode.cpp"
+#include "elevator-ingress.cpp"
+#include "elevator-bench.hpp"
+#include "elevator-fleet.hpp"
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
+#include <thread>
 
 using ::testing::Return;
 
@@ -17,8 +31,14 @@ public:
     MOCK_METHOD(void, outOfService, (), (override));
     MOCK_METHOD(void, alarmOn, (), (override));
     MOCK_METHOD(void, alarmOff, (), (override));
+    MOCK_METHOD(void, hallCallSkipped, (size_t floor), (override));
 
     bool mockFloorRequest(size_t floor) { return client_->handleFloorRequest(floor); }
+    bool mockHallCall(size_t floor)     { return client_->handleHallCall(floor); }
+    bool mockStopList(const size_t *floors, size_t count)
+    {
+        return client_->handleStopList(floors, count);
+    }
     bool mockOpenButtonEvent()          { return client_->handleOpenButton(); }
     bool mockCloseButtonEvent()         { return client_->handleCloseButton(); }
     bool mockStopButtonEvent()          { return client_->handleStopButton(); }
@@ -52,6 +72,7 @@ public:
 
     bool mockArrivedEvent() { return client_->handleArrived(); }
     bool mockFaultEvent()   { return client_->handleDriveFault(); }
+    bool mockLoadEvent(size_t percent) { return client_->handleLoad(percent); }
 };
 
 class MockElevatorTimer : public ElevatorTimerApi
@@ -61,6 +82,7 @@ public:
 
     MOCK_METHOD(void, start, (size_t msec), (override));
     MOCK_METHOD(void, stop, (), (override));
+    MOCK_METHOD(size_t, nowMsec, (), (const, override));
 
     bool mockExpired() { return client_->handleExpired(); }
 };
@@ -72,6 +94,8 @@ public:
     TestElevatorFsmBuilder()
     {
         EXPECT_CALL(ui_, inService());
+        EXPECT_CALL(timer_, nowMsec())
+            .Times(::testing::AnyNumber());
         fsm_ = new ElevatorFsm(ui_, door_, drive_, timer_);
     }
 
@@ -178,6 +202,159 @@ TEST_F(Given_StoppedElevator, Should_GoOutOfService_When_SameFloorRequestedAndDo
     ASSERT_FALSE(fsm_->isInService());
 }
 
+TEST_F(Given_StoppedElevator, Should_MoveToFloor_When_HallCallRequested)
+{
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockHallCall(ElevatorFsm::GROUND_FLOOR + 1));
+}
+
+TEST_F(Given_StoppedElevator, Should_ServeStopsInOrder_When_StopListGiven)
+{
+    const size_t stops[] = { ElevatorFsm::GROUND_FLOOR + 2, ElevatorFsm::GROUND_FLOOR + 1 };
+
+    EXPECT_CALL(door_, open())
+        .Times(2);
+    EXPECT_CALL(timer_, start(::testing::_))
+        .Times(::testing::AnyNumber());
+    {
+        ::testing::InSequence sequence;
+        EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 2));
+        EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 2));
+        EXPECT_CALL(door_, close());
+        EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+        EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+        EXPECT_CALL(door_, close());
+    }
+
+    ASSERT_TRUE(ui_.mockStopList(stops, 2));
+    for (size_t stop = 0; stop < 2; ++stop)
+    {
+        ASSERT_TRUE(drive_.mockArrivedEvent());
+        ASSERT_TRUE(door_.mockOpenedEvent());
+        ASSERT_TRUE(ui_.mockCloseButtonEvent());
+        ASSERT_TRUE(door_.mockClosedEvent());
+    }
+
+    ASSERT_TRUE(fsm_->isIdle());
+    ASSERT_FALSE(fsm_->hasPendingStops());
+}
+
+TEST_F(Given_StoppedElevator, Should_OpenDoor_When_StopListStartsAtCurrentFloor)
+{
+    const size_t stops[] = { ElevatorFsm::GROUND_FLOOR, ElevatorFsm::GROUND_FLOOR + 1 };
+
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+
+    ASSERT_TRUE(ui_.mockStopList(stops, 2));
+
+    ASSERT_TRUE(fsm_->hasPendingStops());
+}
+
+TEST_F(Given_StoppedElevator, Should_TimeMoveByDriveModel_When_ModelGiven)
+{
+    const ElevatorDriveProfile profile = { 2.5, 1.0, 1.2 };
+    ElevatorDriveModel model(profile, 4.0, 12);
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(model.moveTimeoutMsec(ElevatorFsm::GROUND_FLOOR,
+                                                    ElevatorFsm::GROUND_FLOOR + 1)));
+
+    fsm_->setDriveModel(&model);
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+}
+
+TEST_F(Given_StoppedElevator, Should_AllowLearnedTravelTime_When_CarIsSlowerThanModel)
+{
+    const ElevatorDriveProfile profile = { 2.5, 1.0, 1.2 };
+    ElevatorDriveModel model(profile, 4.0, 12);
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorDriveModel::timeoutMsec(20000)));
+
+    fsm_->setDriveModel(&model);
+    fsm_->timing().recordTravel(1, 20000);
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+}
+
+TEST_F(Given_StoppedElevator, Should_UseFlatTimeout_When_FloorBeyondDriveModel)
+{
+    const ElevatorDriveProfile profile = { 2.5, 1.0, 1.2 };
+    ElevatorDriveModel model(profile, 4.0, 12);
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 80));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    fsm_->setDriveModel(&model);
+    ASSERT_FALSE(model.hasFloor(ElevatorFsm::GROUND_FLOOR + 80));
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 80));
+}
+
+TEST_F(Given_StoppedElevator, Should_UseLearnedTime_When_FloorBeyondDriveModel)
+{
+    const ElevatorDriveProfile profile = { 2.5, 1.0, 1.2 };
+    ElevatorDriveModel model(profile, 4.0, 12);
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 12));
+    EXPECT_CALL(timer_, start(ElevatorDriveModel::timeoutMsec(30000)));
+
+    fsm_->setDriveModel(&model);
+    fsm_->timing().recordTravel(12, 30000);
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 12));
+}
+
+//---------- Given_FullElevator -----------------------------------------------
+
+class Given_FullElevator: public TestElevatorFsmBuilder {
+public:
+    void SetUp( ) {
+        ASSERT_TRUE(drive_.mockLoadEvent(ElevatorFsm::FULL_LOAD_PERCENT));
+        ASSERT_TRUE(fsm_->isFull());
+    }
+
+    void TearDown( ) {
+    }
+};
+
+TEST_F(Given_FullElevator, Should_SkipHallCall_When_HallCallRequested)
+{
+    EXPECT_CALL(ui_, hallCallSkipped(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(drive_, goToFloor(::testing::_)).Times(0);
+
+    ASSERT_TRUE(ui_.mockHallCall(ElevatorFsm::GROUND_FLOOR + 1));
+
+    ASSERT_TRUE(fsm_->isIdle());
+}
+
+TEST_F(Given_FullElevator, Should_MoveToFloor_When_CarCallRequested)
+{
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+}
+
+TEST_F(Given_FullElevator, Should_MoveToFloor_When_HallCallRequestedAfterUnloading)
+{
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(drive_.mockLoadEvent(ElevatorFsm::FULL_LOAD_PERCENT - 1));
+    ASSERT_TRUE(ui_.mockHallCall(ElevatorFsm::GROUND_FLOOR + 1));
+}
+
+TEST_F(Given_FullElevator, Should_MoveToFloor_When_SkippingDisabled)
+{
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    fsm_->setFullLoadThreshold(101);
+    ASSERT_TRUE(ui_.mockHallCall(ElevatorFsm::GROUND_FLOOR + 1));
+}
+
 //---------- Given_MovingElevator ----------------------------------------------
 
 class Given_MovingElevator: public TestElevatorFsmBuilder {
@@ -212,6 +389,72 @@ TEST_F(Given_MovingElevator, Should_BeWaiting_When_Arrived)
     ASSERT_TRUE(fsm_->isWaiting());
 }
 
+TEST_F(Given_MovingElevator, Should_OpenDoor_When_ArrivedFloorRequestedAgain)
+{
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1))
+        .Times(2);
+    EXPECT_CALL(door_, open())
+        .Times(2);
+    EXPECT_CALL(door_, close());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC))
+        .Times(2);
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_WAITING_MSEC));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_CLOSE_MSEC));
+
+    // Complete a stop at the new floor, then request it again.
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+    ASSERT_TRUE(door_.mockOpenedEvent());
+    ASSERT_TRUE(ui_.mockCloseButtonEvent());
+    ASSERT_TRUE(door_.mockClosedEvent());
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+}
+
+TEST_F(Given_MovingElevator, Should_ContinueToNextStop_When_StopListGivenWhileMoving)
+{
+    const size_t stops[] = { ElevatorFsm::GROUND_FLOOR + 1, ElevatorFsm::GROUND_FLOOR + 3 };
+
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(door_, close());
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 3));
+    EXPECT_CALL(timer_, start(::testing::_))
+        .Times(::testing::AnyNumber());
+
+    // The list repeats the floor the car is going to; it isn't served twice.
+    ASSERT_TRUE(ui_.mockStopList(stops, 2));
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+    ASSERT_TRUE(door_.mockOpenedEvent());
+    ASSERT_TRUE(ui_.mockCloseButtonEvent());
+    ASSERT_TRUE(door_.mockClosedEvent());
+
+    ASSERT_FALSE(fsm_->isIdle());
+}
+
+TEST_F(Given_MovingElevator, Should_LearnTravelAndDoorTimes_When_StopCompletes)
+{
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(door_, close());
+    EXPECT_CALL(timer_, start(::testing::_))
+        .Times(::testing::AnyNumber());
+    EXPECT_CALL(timer_, nowMsec())
+        .WillOnce(Return(7000))     // Arrived; opening.
+        .WillOnce(Return(7000))
+        .WillOnce(Return(9500))     // Opened; waiting.
+        .WillOnce(Return(9500))
+        .WillOnce(Return(12000))    // Closing.
+        .WillOnce(Return(15000));   // Closed.
+
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+    ASSERT_TRUE(door_.mockOpenedEvent());
+    ASSERT_TRUE(ui_.mockCloseButtonEvent());
+    ASSERT_TRUE(door_.mockClosedEvent());
+
+    ASSERT_EQ(7000u, fsm_->timing().travelMsec(1));
+    ASSERT_EQ(2500u, fsm_->timing().doorMsec(ElevatorTimingCache::DOOR_OPEN));
+    ASSERT_EQ(3000u, fsm_->timing().doorMsec(ElevatorTimingCache::DOOR_CLOSE));
+}
+
 TEST_F(Given_MovingElevator, Should_Stop_When_StopButtonPushed)
 {
     EXPECT_CALL(ui_, alarmOn());
@@ -227,8 +470,35 @@ TEST_F(Given_MovingElevator, Should_Resume_When_StopButtonPushedTwice)
     EXPECT_CALL(drive_, stop());
     EXPECT_CALL(drive_, start());
 
+    // Resuming moves on to Moving, reissuing the trip and its timeout.
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockStopButtonEvent());
+    ASSERT_TRUE(ui_.mockStopButtonEvent());
+
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, fsm_->stateId());
+}
+
+TEST_F(Given_MovingElevator, Should_BeWaiting_When_ArrivedAfterResuming)
+{
+    EXPECT_CALL(ui_, alarmOn());
+    EXPECT_CALL(ui_, alarmOff());
+    EXPECT_CALL(drive_, stop());
+    EXPECT_CALL(drive_, start());
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_WAITING_MSEC));
+
     ASSERT_TRUE(ui_.mockStopButtonEvent());
     ASSERT_TRUE(ui_.mockStopButtonEvent());
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+    ASSERT_TRUE(door_.mockOpenedEvent());
+
+    ASSERT_TRUE(fsm_->isWaiting());
 }
 
 TEST_F(Given_MovingElevator, Should_GoOutOfService_When_DriveTimesOut)
@@ -387,10 +657,1506 @@ TEST_F(Given_OutOfServiceElevator, Should_MoveToGround_When_ServiceRestoredAtOth
     ASSERT_TRUE(fsm_->isInService());
 }
 
-//---------- Main program -----------------------------------------------------
+TEST_F(Given_OutOfServiceElevator, Should_RejectStopList_When_OutOfService)
+{
+    const size_t stops[] = { ElevatorFsm::GROUND_FLOOR + 2 };
 
-int main(int argc, char **argv) {
-    testing::InitGoogleTest(&argc, argv);
-    return RUN_ALL_TESTS();
+    ASSERT_FALSE(ui_.mockStopList(stops, 1));
+    ASSERT_FALSE(fsm_->hasPendingStops());
+}
+
+//---------- Given_DestinationDispatcher ---------------------------------------
+
+class Given_DestinationDispatcher: public ::testing::Test {
+public:
+    Given_DestinationDispatcher()
+        : dispatcher_(CARS, CAPACITY)
+    {
+        for (size_t car = 0; car < CARS; ++car)
+        {
+            carFloors_[car] = ElevatorFsm::GROUND_FLOOR;
+        }
+    }
+
+    enum { CARS = 2, CAPACITY = 4 };
+
+    ElevatorDestinationDispatcher dispatcher_;
+    size_t carFloors_[CARS];
+};
+
+TEST_F(Given_DestinationDispatcher, Should_GroupCalls_When_SameDestination)
+{
+    const ElevatorDestinationCall toFive = { ElevatorFsm::GROUND_FLOOR, 5, 1 };
+    const ElevatorDestinationCall toNine = { ElevatorFsm::GROUND_FLOOR, 9, 1 };
+
+    size_t first = dispatcher_.assign(toFive, carFloors_);
+    ASSERT_EQ(first, dispatcher_.assign(toFive, carFloors_));
+    ASSERT_NE(first, dispatcher_.assign(toNine, carFloors_));
+}
+
+TEST_F(Given_DestinationDispatcher, Should_SplitGroup_When_CarHasNoRoom)
+{
+    const ElevatorDestinationCall group = { ElevatorFsm::GROUND_FLOOR, 5, 3 };
+
+    size_t first = dispatcher_.assign(group, carFloors_);
+    ASSERT_NE(first, dispatcher_.assign(group, carFloors_));
+    ASSERT_EQ(ElevatorDestinationDispatcher::NO_CAR, dispatcher_.assign(group, carFloors_));
+}
+
+TEST_F(Given_DestinationDispatcher, Should_RejectCall_When_FloorBeyondMasks)
+{
+    const ElevatorDestinationCall toHigh   = { ElevatorFsm::GROUND_FLOOR, 64, 1 };
+    const ElevatorDestinationCall fromHigh = { 100, ElevatorFsm::GROUND_FLOOR, 1 };
+    const ElevatorDestinationCall toTop    = { ElevatorFsm::GROUND_FLOOR,
+                                               ElevatorDestinationDispatcher::MAX_FLOORS, 1 };
+
+    ASSERT_EQ(ElevatorDestinationDispatcher::NO_CAR, dispatcher_.assign(toHigh, carFloors_));
+    ASSERT_EQ(ElevatorDestinationDispatcher::NO_CAR, dispatcher_.assign(fromHigh, carFloors_));
+    for (size_t car = 0; car < CARS; ++car)
+    {
+        ASSERT_FALSE(dispatcher_.hasStops(car));
+        ASSERT_EQ(0u, dispatcher_.committed(car));
+    }
+
+    ASSERT_NE(ElevatorDestinationDispatcher::NO_CAR, dispatcher_.assign(toTop, carFloors_));
+}
+
+TEST_F(Given_DestinationDispatcher, Should_ListStopsInSweepOrder_When_PassengersBoard)
+{
+    const ElevatorDestinationCall up   = { 3, 7, 1 };
+    const ElevatorDestinationCall down = { 6, 2, 1 };
+    size_t stops[ElevatorFsm::MAX_STOPS];
+
+    // A single car takes both calls.
+    ElevatorDestinationDispatcher dispatcher(1, CAPACITY);
+    size_t car = dispatcher.assign(up, carFloors_);
+    ASSERT_EQ(car, dispatcher.assign(down, carFloors_));
+
+    // Pickups first: destinations aren't stops until passengers are aboard.
+    ASSERT_EQ(2u, dispatcher.stopList(car, ElevatorFsm::GROUND_FLOOR, 1, stops, ElevatorFsm::MAX_STOPS));
+    ASSERT_EQ(3u, stops[0]);
+    ASSERT_EQ(6u, stops[1]);
+
+    dispatcher.boarded(car, 3);
+    dispatcher.boarded(car, 6);
+    ASSERT_EQ(2u, dispatcher.stopList(car, 6, 1, stops, ElevatorFsm::MAX_STOPS));
+    ASSERT_EQ(7u, stops[0]);
+    ASSERT_EQ(2u, stops[1]);
+
+    dispatcher.alighted(car, 7, 1);
+    dispatcher.alighted(car, 2, 1);
+    ASSERT_FALSE(dispatcher.hasStops(car));
+    ASSERT_EQ(0u, dispatcher.committed(car));
+}
+
+TEST_F(Given_DestinationDispatcher, Should_AssignWithinReach_When_CarsShareShaft)
+{
+    const ElevatorDestinationCall toTop   = { ElevatorFsm::GROUND_FLOOR, 12, 1 };
+    const ElevatorDestinationCall toThree = { 3, ElevatorFsm::GROUND_FLOOR, 1 };
+    size_t stops[ElevatorFsm::MAX_STOPS];
+
+    // Car 0 is the lower car and car 1 the upper car of a twin pair.
+    dispatcher_.setReach(0, ElevatorFsm::GROUND_FLOOR, 11);
+    dispatcher_.setReach(1, ElevatorFsm::GROUND_FLOOR + 1, 12);
+
+    // Only the upper car reaches the top, and it takes the call at the upper
+    // lobby level.
+    ASSERT_EQ(1u, dispatcher_.assign(toTop, carFloors_));
+    ASSERT_EQ(1u, dispatcher_.stopList(1, ElevatorFsm::GROUND_FLOOR, 1, stops, ElevatorFsm::MAX_STOPS));
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 1, stops[0]);
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 1, dispatcher_.servedFloor(1, ElevatorFsm::GROUND_FLOOR));
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR, dispatcher_.servedFloor(0, ElevatorFsm::GROUND_FLOOR));
+
+    // A call both reach goes by cost as usual.
+    ASSERT_NE(ElevatorDestinationDispatcher::NO_CAR, dispatcher_.assign(toThree, carFloors_));
+}
+
+TEST_F(Given_DestinationDispatcher, Should_PreferRegeneratingCar_When_EnergyWeighted)
+{
+    const ElevatorEnergyProfile   profile = { 300.0, 50.0, 75.0, 500.0, 2.0, 80.0, 65.0 };
+    const ElevatorEnergyModel     model(profile, 4.0, 12);
+    const ElevatorDestinationCall call    = { 5, 8, 1 };
+
+    // Empty cars as far above the origin as below: the first is as good as
+    // any on time alone.
+    carFloors_[0] = 9;
+    carFloors_[1] = 1;
+    ElevatorDestinationDispatcher timeOnly(CARS, CAPACITY);
+    ASSERT_EQ(0u, timeOnly.assign(call, carFloors_));
+
+    // Light, the car below regenerates going up, and the one above has to be
+    // driven down.
+    dispatcher_.setEnergyModel(&model, 1000);
+    ASSERT_EQ(1u, dispatcher_.assign(call, carFloors_));
+}
+
+TEST_F(Given_DestinationDispatcher, Should_AssignOnTime_When_EnergyModelLacksFloor)
+{
+    const ElevatorEnergyProfile   profile = { 300.0, 50.0, 75.0, 500.0, 2.0, 80.0, 65.0 };
+    const ElevatorEnergyModel     model(profile, 4.0, 12);
+    const ElevatorDestinationCall toHigh  = { 9, 20, 1 };
+
+    // The destination is above the model's floors, so neither car can be
+    // priced, and the nearer one takes the call as it would on time alone.
+    carFloors_[0] = ElevatorFsm::GROUND_FLOOR;
+    carFloors_[1] = 10;
+    ElevatorDestinationDispatcher timeOnly(CARS, CAPACITY);
+    ASSERT_EQ(1u, timeOnly.assign(toHigh, carFloors_));
+
+    dispatcher_.setEnergyModel(&model, 1000);
+    ASSERT_EQ(1u, dispatcher_.assign(toHigh, carFloors_));
+}
+
+//---------- Given_DriveModel -------------------------------------------------
+
+class Given_DriveModel: public ::testing::Test {
+public:
+    Given_DriveModel()
+        : profile_({ 2.5, 1.0, 1.2 })
+        , model_(profile_, 4.0, 12)
+    {
+    }
+
+    ElevatorDriveProfile profile_;
+    ElevatorDriveModel   model_;
+};
+
+TEST_F(Given_DriveModel, Should_CruiseAtRatedSpeed_When_TripIsLong)
+{
+    // Distance at speed plus the time lost accelerating and decelerating.
+    ASSERT_NEAR(40.0 / 2.5 + 2.5 / 1.0 + 1.0 / 1.2,
+                ElevatorDriveModel::travelSec(profile_, 40.0), 1e-9);
+}
+
+TEST_F(Given_DriveModel, Should_IncreaseSmoothly_When_TripCrossesProfileCases)
+{
+    double previous = ElevatorDriveModel::travelSec(profile_, 0.5);
+
+    // Continuous and increasing across the short and long trip cases.
+    for (double meters = 0.55; meters < 20.0; meters += 0.05)
+    {
+        double sec = ElevatorDriveModel::travelSec(profile_, meters);
+
+        ASSERT_GT(sec, previous);
+        ASSERT_LT(sec - previous, 0.1);
+        previous = sec;
+    }
+}
+
+TEST_F(Given_DriveModel, Should_LookUpSameTime_When_EitherDirection)
+{
+    for (size_t from = ElevatorFsm::GROUND_FLOOR; from <= 12; ++from)
+    {
+        ASSERT_EQ(0u, model_.travelMsec(from, from));
+
+        for (size_t to = from + 1; to <= 12; ++to)
+        {
+            double sec = ElevatorDriveModel::travelSec(profile_, 4.0 * (to - from));
+
+            ASSERT_EQ(model_.travelMsec(from, to), model_.travelMsec(to, from));
+            ASSERT_GE(model_.travelMsec(from, to), sec * 1000.0);
+            ASSERT_LT(model_.travelMsec(from, to), sec * 1000.0 + ElevatorDriveModel::TICK_MSEC);
+        }
+    }
+}
+
+TEST_F(Given_DriveModel, Should_TimeOutSoonerThanFlatTimeout_When_TripIsShort)
+{
+    ASSERT_LT(model_.moveTimeoutMsec(ElevatorFsm::GROUND_FLOOR, ElevatorFsm::GROUND_FLOOR + 1),
+              ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC / 4);
+}
+
+//---------- Given_EnergyModel ------------------------------------------------
+
+class Given_EnergyModel: public ::testing::Test {
+public:
+    Given_EnergyModel()
+        : profile_({ 1000.0, 45.0, 75.0, 800.0, 2.0, 80.0, 65.0 })
+        , model_(profile_, 4.0, 12)
+    {
+    }
+
+    ElevatorEnergyProfile profile_;
+    ElevatorEnergyModel   model_;
+};
+
+TEST_F(Given_EnergyModel, Should_Regenerate_When_LightCarGoesUpOrHeavyCarGoesDown)
+{
+    ASSERT_LT(model_.runWh(ElevatorFsm::GROUND_FLOOR, 10, 0), 0.0);
+    ASSERT_LT(model_.runWh(10, ElevatorFsm::GROUND_FLOOR, 13), 0.0);
+    ASSERT_GT(model_.runWh(10, ElevatorFsm::GROUND_FLOOR, 0), 0.0);
+    ASSERT_GT(model_.runWh(ElevatorFsm::GROUND_FLOOR, 10, 13), 0.0);
+    ASSERT_EQ(0.0, model_.runWh(5, 5, 13));
+}
+
+TEST_F(Given_EnergyModel, Should_PayOnlyLosses_When_LoadBalanced)
+{
+    // Six passengers make 45% of rated load: only friction and the run.
+    double lossesWh = profile_.runWh + 800.0 * 40.0 * 100.0 / 80.0 / 3600.0;
+
+    ASSERT_NEAR(lossesWh, model_.runWh(ElevatorFsm::GROUND_FLOOR, 11, 6), 1e-9);
+    ASSERT_NEAR(lossesWh, model_.runWh(11, ElevatorFsm::GROUND_FLOOR, 6), 1e-9);
+}
+
+TEST_F(Given_EnergyModel, Should_ReturnNothing_When_DriveNotRegenerative)
+{
+    profile_.regenPercent = 0.0;
+    ElevatorEnergyModel plain(profile_, 4.0, 12);
+
+    // The energy gravity gives back goes to the braking resistor, but the
+    // friction it overcomes on the way is free.
+    ASSERT_DOUBLE_EQ(profile_.runWh, plain.runWh(ElevatorFsm::GROUND_FLOOR, 10, 0));
+    ASSERT_LT(model_.runWh(ElevatorFsm::GROUND_FLOOR, 10, 0), plain.runWh(ElevatorFsm::GROUND_FLOOR, 10, 0));
+}
+
+//---------- Given_TimingCache -------------------------------------------------
+
+class Given_TimingCache: public ::testing::Test {
+public:
+    ElevatorTimingCache cache_;
+};
+
+TEST_F(Given_TimingCache, Should_KnowNothing_When_NothingRecorded)
+{
+    ASSERT_EQ(0u, cache_.travelMsec(1));
+    ASSERT_EQ(0u, cache_.travelSamples(1));
+    ASSERT_EQ(0u, cache_.doorMsec(ElevatorTimingCache::DOOR_OPEN));
+}
+
+TEST_F(Given_TimingCache, Should_ConvergeOnNewTime_When_CarSlowsDown)
+{
+    cache_.recordTravel(3, 8000);
+    ASSERT_EQ(8000u, cache_.travelMsec(3));
+
+    // One sample moves the average an eighth of the way.
+    cache_.recordTravel(3, 16000);
+    ASSERT_EQ(9000u, cache_.travelMsec(3));
+
+    for (int trip = 0; trip < 100; ++trip)
+    {
+        cache_.recordTravel(3, 16000);
+    }
+    ASSERT_NEAR(16000.0, cache_.travelMsec(3), 1.0);
+    ASSERT_EQ(0u, cache_.travelMsec(2));
+}
+
+TEST_F(Given_TimingCache, Should_ShareLastBucket_When_TripIsLong)
+{
+    cache_.recordTravel(40, 50000);
+
+    ASSERT_EQ(50000u, cache_.travelMsec(ElevatorTimingCache::DISTANCE_BUCKETS));
+    ASSERT_EQ(50000u, cache_.travelMsec(60));
 }
 
+TEST_F(Given_TimingCache, Should_RestoreTable_When_ImageLoaded)
+{
+    uint8_t image[ElevatorTimingCache::IMAGE_BYTES];
+    ElevatorTimingCache restored;
+
+    cache_.recordTravel(2, 6500);
+    cache_.recordDoor(ElevatorTimingCache::DOOR_CLOSE, 3100);
+
+    ASSERT_EQ(sizeof(image), cache_.save(image, sizeof(image)));
+    ASSERT_TRUE(restored.load(image, sizeof(image)));
+    ASSERT_EQ(6500u, restored.travelMsec(2));
+    ASSERT_EQ(1u, restored.travelSamples(2));
+    ASSERT_EQ(3100u, restored.doorMsec(ElevatorTimingCache::DOOR_CLOSE));
+}
+
+TEST_F(Given_TimingCache, Should_RejectImage_When_Corrupted)
+{
+    uint8_t image[ElevatorTimingCache::IMAGE_BYTES];
+    ElevatorTimingCache restored;
+
+    cache_.recordTravel(2, 6500);
+    cache_.save(image, sizeof(image));
+    image[20] ^= 0x01;
+
+    ASSERT_FALSE(restored.load(image, sizeof(image)));
+    ASSERT_FALSE(restored.load(image, sizeof(image) - 1));
+    ASSERT_EQ(0u, restored.travelMsec(2));
+}
+
+//---------- Given_SnapshotSlot -----------------------------------------------
+
+class Given_SnapshotSlot: public TestElevatorFsmBuilder {
+public:
+    void SetUp( ) {
+        memset(&slot_, 0, sizeof(slot_));
+        fsm_->setSnapshotSlot(&slot_);
+    }
+
+    void TearDown( ) {
+    }
+
+    ElevatorSnapshotSlot slot_;
+};
+
+TEST_F(Given_SnapshotSlot, Should_WriteSnapshot_When_StateChanges)
+{
+    const size_t stops[] = { ElevatorFsm::GROUND_FLOOR + 2, ElevatorFsm::GROUND_FLOOR + 4 };
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 2));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockStopList(stops, 2));
+
+    const ElevatorSnapshot *snapshot = slot_.latest();
+    ASSERT_NE(nullptr, snapshot);
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, snapshot->state);
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR, snapshot->currentFloor);
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 2, snapshot->destinationFloor);
+    ASSERT_EQ(2u, snapshot->stopCount);
+    ASSERT_EQ(1u, snapshot->nextStop);
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 4, snapshot->stops[1]);
+    ASSERT_EQ(static_cast<uint32_t>(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC),
+              snapshot->timerRemainingMsec);
+}
+
+TEST_F(Given_SnapshotSlot, Should_KeepPreviousCopy_When_WriteIsTorn)
+{
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+
+    ElevatorSnapshot *newest = const_cast<ElevatorSnapshot *>(slot_.latest());
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, newest->state);
+
+    newest->destinationFloor = 0;
+    ASSERT_EQ(ElevatorFsm::STATE_STOPPED, slot_.latest()->state);
+}
+
+TEST_F(Given_SnapshotSlot, Should_ResumeTrip_When_RestartedWhileMoving)
+{
+    EXPECT_CALL(ui_, inService());
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 3))
+        .Times(2);
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(false));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC))
+        .Times(2);
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 3));
+
+    ElevatorFsm restarted(ui_, door_, drive_, timer_, slot_.latest());
+
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, restarted.stateId());
+}
+
+TEST_F(Given_SnapshotSlot, Should_ResumeNewStops_When_RestartedAfterStopListWhileMoving)
+{
+    const size_t stops[] = { ElevatorFsm::GROUND_FLOOR + 5, ElevatorFsm::GROUND_FLOOR + 7 };
+
+    EXPECT_CALL(ui_, inService());
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 3))
+        .Times(2);
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(false));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC))
+        .Times(2);
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 3));
+    ASSERT_TRUE(ui_.mockStopList(stops, 2));
+
+    // Accepted without a transition, and written all the same.
+    ASSERT_EQ(2u, slot_.latest()->stopCount);
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 7, slot_.latest()->stops[1]);
+
+    ElevatorFsm restarted(ui_, door_, drive_, timer_, slot_.latest());
+
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, restarted.stateId());
+    ASSERT_TRUE(restarted.hasPendingStops());
+}
+
+TEST_F(Given_SnapshotSlot, Should_FinishDwell_When_RestartedWhileWaiting)
+{
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(ui_, inService());
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(true));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_WAITING_MSEC))
+        .Times(2);
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR));
+    ASSERT_TRUE(door_.mockOpenedEvent());
+
+    // No door commands: the doors are still open.
+    ElevatorFsm restarted(ui_, door_, drive_, timer_, slot_.latest());
+
+    ASSERT_TRUE(restarted.isWaiting());
+}
+
+TEST_F(Given_SnapshotSlot, Should_ReturnToGround_When_CarMovedWhileRestarting)
+{
+    EXPECT_CALL(ui_, inService())
+        .Times(2);
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR + 2))
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR + 2));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(true))
+        .WillOnce(Return(true));
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    // Idle at the ground floor when the snapshot was written.
+    ElevatorFsm restarted(ui_, door_, drive_, timer_, slot_.latest());
+
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, restarted.stateId());
+}
+
+TEST_F(Given_SnapshotSlot, Should_StayOutOfService_When_RestartedOutOfService)
+{
+    EXPECT_CALL(ui_, inService());
+    EXPECT_CALL(ui_, outOfService())
+        .Times(2);
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(false));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+    ASSERT_TRUE(drive_.mockFaultEvent());
+
+    ElevatorFsm restarted(ui_, door_, drive_, timer_, slot_.latest());
+
+    ASSERT_FALSE(restarted.isInService());
+}
+
+TEST_F(Given_SnapshotSlot, Should_RestoreService_When_NoValidSnapshot)
+{
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(ui_, inService())
+        .Times(2);
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(true));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+
+    memset(&slot_, 0, sizeof(slot_));
+    ElevatorFsm restarted(ui_, door_, drive_, timer_, slot_.latest());
+
+    ASSERT_EQ(ElevatorFsm::STATE_OPENING, restarted.stateId());
+}
+
+//---------- Given_SpscQueue --------------------------------------------------
+
+TEST(Given_SpscQueue, Should_DeliverInOrder_When_NotFull)
+{
+    ElevatorSpscQueue<int, 4> queue;
+    int item = 0;
+
+    ASSERT_FALSE(queue.pop(item));
+    for (int push = 1; push <= 4; ++push)
+    {
+        ASSERT_TRUE(queue.push(push));
+    }
+    ASSERT_FALSE(queue.push(5));
+
+    for (int pop = 1; pop <= 4; ++pop)
+    {
+        ASSERT_TRUE(queue.pop(item));
+        ASSERT_EQ(pop, item);
+    }
+    ASSERT_FALSE(queue.pop(item));
+    ASSERT_TRUE(queue.push(6));
+}
+
+//---------- Given_HotStandby -------------------------------------------------
+
+class Given_HotStandby: public TestElevatorFsmBuilder {
+public:
+    Given_HotStandby()
+        : now_(0)
+    {
+        EXPECT_CALL(timer_, nowMsec())
+            .WillRepeatedly(::testing::ReturnPointee(&now_));
+        mirror_  = new ElevatorEventMirror(*fsm_, channel_, ui_, door_, drive_, timer_);
+        standby_ = new ElevatorStandby(channel_, ui_, door_, drive_, timer_, &slot_);
+        memset(&slot_, 0, sizeof(slot_));
+        fsm_->setSnapshotSlot(&slot_);
+    }
+
+    virtual ~Given_HotStandby()
+    {
+        delete standby_;
+        delete mirror_;
+    }
+
+    size_t                now_;
+    ElevatorMirrorChannel channel_;
+    ElevatorSnapshotSlot  slot_;
+    ElevatorEventMirror  *mirror_;
+    ElevatorStandby      *standby_;
+};
+
+TEST_F(Given_HotStandby, Should_FollowPrimary_When_EventsMirrored)
+{
+    // Only the primary commands the components.
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+    ASSERT_FALSE(standby_->poll());
+
+    ASSERT_EQ(2u, standby_->applied());
+    ASSERT_TRUE(standby_->isInStep());
+    ASSERT_EQ(ElevatorFsm::STATE_OPENING, standby_->fsm().stateId());
+}
+
+TEST_F(Given_HotStandby, Should_CountDivergence_When_StatesDisagree)
+{
+    ElevatorEvent event = {};
+
+    event.type  = ElevatorEvent::OPEN_BUTTON;
+    event.state = ElevatorFsm::STATE_WAITING;
+    ASSERT_TRUE(channel_.events.push(event));
+    ASSERT_FALSE(standby_->poll());
+
+    ASSERT_EQ(1u, standby_->divergences());
+    ASSERT_FALSE(standby_->isInStep());
+}
+
+TEST_F(Given_HotStandby, Should_ClampStopCount_When_EventCorrupt)
+{
+    ElevatorEvent event = {};
+
+    event.type      = ElevatorEvent::STOP_LIST;
+    event.state     = ElevatorFsm::STATE_MOVING;
+    event.stopCount = 255;
+    for (size_t stop = 0; stop < ElevatorFsm::MAX_STOPS; ++stop)
+    {
+        event.stops[stop] = static_cast<uint16_t>(ElevatorFsm::GROUND_FLOOR + 2 + stop % 5);
+    }
+    ASSERT_TRUE(channel_.events.push(event));
+    ASSERT_FALSE(standby_->poll());
+
+    ASSERT_TRUE(standby_->isInStep());
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, standby_->fsm().stateId());
+    ASSERT_TRUE(standby_->fsm().hasPendingStops());
+}
+
+TEST_F(Given_HotStandby, Should_TakeOver_When_HeartbeatStops)
+{
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1))
+        .Times(2);
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(false));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC))
+        .Times(2);
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+    mirror_->heartbeat();
+    now_ = ElevatorStandby::HEARTBEAT_PERIOD_MSEC;
+    ASSERT_FALSE(standby_->poll());
+
+    // The primary stops. The standby reissues the trip, then handles the
+    // arrival itself.
+    now_ += ElevatorStandby::HEARTBEAT_TIMEOUT_MSEC;
+    ASSERT_TRUE(standby_->poll());
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+
+    ASSERT_EQ(ElevatorFsm::STATE_OPENING, standby_->fsm().stateId());
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, fsm_->stateId());
+}
+
+TEST_F(Given_HotStandby, Should_ResumeFromPrimarySnapshot_When_EventsDropped)
+{
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 2))
+        .Times(2);
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(false));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC))
+        .Times(2);
+
+    // The standby never sees the request.
+    ASSERT_TRUE(fsm_->handleFloorRequest(ElevatorFsm::GROUND_FLOOR + 2));
+    channel_.dropped.store(1);
+    ASSERT_FALSE(standby_->poll());
+    ASSERT_FALSE(standby_->isInStep());
+
+    standby_->takeOver();
+
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, standby_->fsm().stateId());
+}
+
+//---------- Given_TransitionLog ----------------------------------------------
+
+class Given_TransitionLog: public TestElevatorFsmBuilder {
+public:
+    enum
+    {
+        CAR = 3,
+    };
+
+    static const uint64_t EPOCH_MSEC = 1782864000000ull;    // 2026-07-01 00:00 UTC.
+
+    Given_TransitionLog()
+        : path_("/tmp/elevator-transition-log-test-" + std::to_string(getpid()) + ".log")
+        , log_(new ElevatorTransitionLog)
+        , recorder_(*log_, CAR)
+        {}
+
+    void SetUp( ) {
+        unlink(path_.c_str());
+        ASSERT_TRUE(log_->open(path_.c_str(), EPOCH_MSEC));
+        fsm_->setTransitionObserver(&recorder_);
+    }
+
+    void TearDown( ) {
+        log_->close();
+        unlink(path_.c_str());
+    }
+
+    std::string                            path_;
+    std::unique_ptr<ElevatorTransitionLog> log_;
+    ElevatorTransitionRecorder             recorder_;
+    ElevatorTransitionLogReader            reader_;
+};
+
+TEST_F(Given_TransitionLog, Should_CountDoorOpenFailure_When_OpeningTimesOut)
+{
+    const uint64_t DAY = EPOCH_MSEC / ElevatorTransitionLogReader::DAY_MSEC + 2;
+
+    EXPECT_CALL(timer_, nowMsec())
+        .WillRepeatedly(Return(2 * ElevatorTransitionLogReader::DAY_MSEC + 5000));
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+    EXPECT_CALL(ui_, outOfService());
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+    ASSERT_TRUE(timer_.mockExpired());
+    ASSERT_TRUE(log_->flush());
+
+    ASSERT_TRUE(reader_.open(path_.c_str()));
+    ASSERT_EQ(1u, reader_.blocks());
+    ASSERT_EQ(3u, reader_.block(0).rows);
+
+    uint8_t  from[3];
+    uint8_t  to[3];
+    uint16_t floor[3];
+    uint64_t timeMsec[3];
+    reader_.states(0, from, to);
+    reader_.floors(0, floor);
+    reader_.times(0, timeMsec);
+    ASSERT_EQ(ElevatorFsm::STATE_STOPPED, from[0]);
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, to[0]);
+    ASSERT_EQ(ElevatorFsm::STATE_OPENING, to[1]);
+    ASSERT_EQ(ElevatorFsm::STATE_OPENING, from[2]);
+    ASSERT_EQ(ElevatorFsm::STATE_OUT_OF_SERVICE, to[2]);
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR, floor[0]);
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 1, floor[2]);
+    ASSERT_EQ(EPOCH_MSEC + 2 * ElevatorTransitionLogReader::DAY_MSEC + 5000, timeMsec[2]);
+
+    ElevatorTransitionLogReader::CarDayCounts counts;
+    reader_.countPerCarDay(ElevatorFsm::STATE_OPENING, ElevatorFsm::STATE_OUT_OF_SERVICE, counts);
+    ASSERT_EQ(1u, counts.size());
+    ASSERT_EQ(1u, (counts[std::make_pair(size_t(CAR), DAY)]));
+}
+
+TEST_F(Given_TransitionLog, Should_LogRecovery_When_RestartedWhileWaiting)
+{
+    ElevatorSnapshotSlot slot;
+
+    memset(&slot, 0, sizeof(slot));
+    fsm_->setSnapshotSlot(&slot);
+
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(ui_, inService());
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(drive_, getFloor())
+        .WillOnce(Return(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(drive_, isAtFloor())
+        .WillOnce(Return(true));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_WAITING_MSEC))
+        .Times(2);
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR));
+    ASSERT_TRUE(door_.mockOpenedEvent());
+
+    ElevatorFsm restarted(ui_, door_, drive_, timer_);
+    restarted.setTransitionObserver(&recorder_);
+    ASSERT_TRUE(restarted.recover(slot.latest()));
+    ASSERT_TRUE(restarted.isWaiting());
+    ASSERT_TRUE(log_->flush());
+
+    // Opening and Waiting, then the restarted car's way back to Waiting.
+    ASSERT_TRUE(reader_.open(path_.c_str()));
+    ASSERT_EQ(1u, reader_.blocks());
+    ASSERT_EQ(4u, reader_.block(0).rows);
+
+    uint8_t from[4];
+    uint8_t to[4];
+    reader_.states(0, from, to);
+    ASSERT_EQ(ElevatorFsm::STATE_RECOVERING, to[2]);
+    ASSERT_EQ(ElevatorFsm::STATE_RECOVERING, from[3]);
+    ASSERT_EQ(ElevatorFsm::STATE_WAITING, to[3]);
+}
+
+TEST_F(Given_TransitionLog, Should_RoundTripColumns_When_ValuesVaryAcrossBlocks)
+{
+    const size_t ROWS = ElevatorTransitionBlock::MAX_ROWS + 10;
+
+    // Times mostly advance but not always; cars and floors need several
+    // varint bytes.
+    for (size_t row = 0; row < ROWS; ++row)
+    {
+        log_->record(row % 300, static_cast<ElevatorFsm::StateId>(row % 10),
+                     static_cast<ElevatorFsm::StateId>((row + 1) % 10),
+                     row * 7 % 20000, 1000 * row - (row % 3) * 1500);
+    }
+    log_->close();
+
+    // Reopening appends.
+    ASSERT_TRUE(log_->open(path_.c_str(), EPOCH_MSEC));
+    log_->record(1, ElevatorFsm::STATE_STOPPED, ElevatorFsm::STATE_MOVING, 1, 0);
+    log_->close();
+
+    ASSERT_TRUE(reader_.open(path_.c_str()));
+    ASSERT_EQ(3u, reader_.blocks());
+    ASSERT_EQ(reader_.fileBytes(), reader_.indexedBytes());
+
+    std::vector<uint64_t> timeMsec(ElevatorTransitionBlock::MAX_ROWS);
+    std::vector<uint8_t>  from(ElevatorTransitionBlock::MAX_ROWS);
+    std::vector<uint8_t>  to(ElevatorTransitionBlock::MAX_ROWS);
+    std::vector<uint16_t> car(ElevatorTransitionBlock::MAX_ROWS);
+    std::vector<uint16_t> floor(ElevatorTransitionBlock::MAX_ROWS);
+    size_t row = 0;
+
+    for (size_t index = 0; index < 2; ++index)
+    {
+        const ElevatorTransitionBlock &block = reader_.block(index);
+
+        reader_.times(index, timeMsec.data());
+        reader_.states(index, from.data(), to.data());
+        reader_.cars(index, car.data());
+        reader_.floors(index, floor.data());
+        for (size_t entry = 0; entry < block.rows; ++entry, ++row)
+        {
+            ASSERT_EQ(EPOCH_MSEC + 1000 * row - (row % 3) * 1500, timeMsec[entry]);
+            ASSERT_EQ(row % 10, from[entry]);
+            ASSERT_EQ((row + 1) % 10, to[entry]);
+            ASSERT_EQ(row % 300, car[entry]);
+            ASSERT_EQ(row * 7 % 20000, floor[entry]);
+            ASSERT_LE(block.minTimeMsec, timeMsec[entry]);
+            ASSERT_GE(block.maxTimeMsec, timeMsec[entry]);
+        }
+    }
+    ASSERT_EQ(ROWS, row);
+}
+
+TEST_F(Given_TransitionLog, Should_ReadOnlyBlocksWithBothStates_When_Counting)
+{
+    log_->record(0, ElevatorFsm::STATE_STOPPED, ElevatorFsm::STATE_MOVING, 1, 0);
+    log_->record(0, ElevatorFsm::STATE_MOVING, ElevatorFsm::STATE_OPENING, 5, 1000);
+    log_->flush();
+    log_->record(1, ElevatorFsm::STATE_MOVING, ElevatorFsm::STATE_OPENING, 2, 2000);
+    log_->record(1, ElevatorFsm::STATE_OPENING, ElevatorFsm::STATE_OUT_OF_SERVICE, 2, 7000);
+    log_->flush();
+
+    ElevatorTransitionLogReader::CarDayCounts counts;
+    ASSERT_TRUE(reader_.open(path_.c_str()));
+    ASSERT_EQ(2u, reader_.blocks());
+    ASSERT_EQ(1u, reader_.countPerCarDay(ElevatorFsm::STATE_OPENING,
+                                         ElevatorFsm::STATE_OUT_OF_SERVICE, counts));
+    ASSERT_EQ(1u, counts.size());
+    ASSERT_EQ(1u, counts.begin()->first.first);
+}
+
+TEST_F(Given_TransitionLog, Should_IgnoreTornTail_When_LastBlockIsIncomplete)
+{
+    log_->record(0, ElevatorFsm::STATE_STOPPED, ElevatorFsm::STATE_MOVING, 1, 0);
+    log_->flush();
+    log_->record(0, ElevatorFsm::STATE_MOVING, ElevatorFsm::STATE_OPENING, 5, 1000);
+    log_->close();
+
+    ASSERT_EQ(0, truncate(path_.c_str(), log_->fileBytes() - 3));
+
+    ASSERT_TRUE(reader_.open(path_.c_str()));
+    ASSERT_EQ(1u, reader_.blocks());
+    ASSERT_LT(reader_.indexedBytes(), reader_.fileBytes());
+    ASSERT_EQ(1u << ElevatorFsm::STATE_MOVING, reader_.block(0).toStates);
+}
+
+TEST_F(Given_TransitionLog, Should_DecodeWithinColumn_When_ColumnIsCorrupt)
+{
+    log_->record(3, ElevatorFsm::STATE_STOPPED, ElevatorFsm::STATE_MOVING, 7, 0);
+    log_->record(3, ElevatorFsm::STATE_MOVING, ElevatorFsm::STATE_OPENING, 9, 1000);
+    log_->close();
+
+    // Continuation bits throughout the car column: unbounded, the decoder
+    // would run on into the floor column.
+    ElevatorTransitionBlock header;
+    int fd = open(path_.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    ASSERT_EQ(ssize_t(sizeof(header)), pread(fd, &header, sizeof(header), 0));
+    for (size_t byte = 0; byte < header.carBytes; ++byte)
+    {
+        const uint8_t continued = 0x80;
+        ASSERT_EQ(1, pwrite(fd, &continued, 1, header.carOffset() + byte));
+    }
+    ::close(fd);
+
+    uint16_t car[2];
+    uint16_t floor[2];
+    ASSERT_TRUE(reader_.open(path_.c_str()));
+    ASSERT_EQ(1u, reader_.blocks());
+    reader_.cars(0, car);
+    reader_.floors(0, floor);
+    ASSERT_EQ(0u, car[0]);
+    ASSERT_EQ(0u, car[1]);
+    ASSERT_EQ(7u, floor[0]);
+    ASSERT_EQ(9u, floor[1]);
+}
+
+//---------- Given_Metrics ----------------------------------------------------
+
+class Given_Metrics: public TestElevatorFsmBuilder {
+public:
+    enum
+    {
+        CAR = 2,
+    };
+
+    Given_Metrics()
+        : metrics_(CAR + 1)
+        {}
+
+    void SetUp( ) {
+        fsm_->setMetrics(&metrics_, CAR);
+    }
+
+    void TearDown( ) {
+    }
+
+    ElevatorMetrics metrics_;
+};
+
+TEST_F(Given_Metrics, Should_CountTransitionsAndRejections_When_EventsDispatched)
+{
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 1));
+    ASSERT_FALSE(ui_.mockOpenButtonEvent());
+    ASSERT_FALSE(ui_.mockOpenButtonEvent());
+
+    ASSERT_EQ(1u, metrics_.transitions(CAR, ElevatorFsm::STATE_STOPPED, ElevatorFsm::STATE_MOVING));
+    ASSERT_EQ(2u, metrics_.rejected(CAR, ElevatorFsm::STATE_MOVING, ElevatorFsm::EVENT_OPEN_BUTTON));
+    ASSERT_EQ(0u, metrics_.rejected(CAR, ElevatorFsm::STATE_STOPPED, ElevatorFsm::EVENT_FLOOR_REQUEST));
+    ASSERT_EQ(0u, metrics_.transitions(CAR - 1, ElevatorFsm::STATE_STOPPED, ElevatorFsm::STATE_MOVING));
+
+    std::string text;
+    metrics_.render(text);
+    ASSERT_NE(std::string::npos,
+              text.find("elevator_transitions_total{car=\"2\",from=\"Stopped\",to=\"Moving\"} 1\n"));
+    ASSERT_NE(std::string::npos,
+              text.find("elevator_events_rejected_total{car=\"2\",state=\"Moving\",event=\"OpenButton\"} 2\n"));
+    ASSERT_NE(std::string::npos, text.find("# TYPE elevator_faults_total counter\n"));
+}
+
+TEST_F(Given_Metrics, Should_CountFaultSourceAndExpiry_When_DoorFailsTwice)
+{
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+    EXPECT_CALL(ui_, outOfService());
+
+    // The door times out opening, then faults while out of service.
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR));
+    ASSERT_TRUE(timer_.mockExpired());
+    ASSERT_FALSE(door_.mockFaultEvent());
+
+    ASSERT_EQ(1u, metrics_.expiries(CAR, ElevatorFsm::STATE_OPENING));
+    ASSERT_EQ(1u, metrics_.doorFaults(CAR));
+    ASSERT_EQ(0u, metrics_.driveFaults(CAR));
+    ASSERT_EQ(1u, metrics_.rejected(CAR, ElevatorFsm::STATE_OUT_OF_SERVICE, ElevatorFsm::EVENT_DOOR_FAULT));
+    ASSERT_EQ(1u, metrics_.transitions(CAR, ElevatorFsm::STATE_OPENING, ElevatorFsm::STATE_OUT_OF_SERVICE));
+}
+
+TEST(Given_MetricsShards, Should_CountEveryIncrement_When_ThreadsOutnumberShards)
+{
+    const size_t THREADS    = 6;
+    const size_t INCREMENTS = 20000;
+    ElevatorMetrics metrics(1, 2);
+    std::vector<std::thread> threads;
+
+    for (size_t thread = 0; thread < THREADS; ++thread)
+    {
+        threads.emplace_back([&]()
+        {
+            for (size_t increment = 0; increment < INCREMENTS; ++increment)
+            {
+                metrics.transition(0, ElevatorFsm::STATE_MOVING, ElevatorFsm::STATE_OPENING);
+            }
+        });
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    ASSERT_EQ(2u, metrics.shards());
+    ASSERT_EQ(THREADS * INCREMENTS,
+              metrics.transitions(0, ElevatorFsm::STATE_MOVING, ElevatorFsm::STATE_OPENING));
+}
+
+//---------- Given_CoalescedTimers --------------------------------------------
+
+class Given_CoalescedTimers: public TestElevatorFsmBuilder {
+public:
+    Given_CoalescedTimers()
+        : now_(0)
+    {
+        EXPECT_CALL(timer_, nowMsec())
+            .WillRepeatedly(::testing::ReturnPointee(&now_));
+    }
+
+    void SetUp( ) {
+        // Drive FSM into Waiting state with coalescing on: the door open
+        // timeout, set to expire at 5000, will do for the dwell until then.
+        fsm_->setTimerCoalescing(true);
+
+        EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR));
+        EXPECT_CALL(door_, open());
+        EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+
+        ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR));
+        now_ = 2000;
+        ASSERT_TRUE(door_.mockOpenedEvent());
+        ASSERT_TRUE(fsm_->isWaiting());
+    }
+
+    size_t now_;
+};
+
+TEST_F(Given_CoalescedTimers, Should_NotRestartTimer_When_OpenButtonPushed)
+{
+    // Pushes at 3000 and 4000 move the dwell's end to 14000. The running
+    // timer expires at 5000 and is re-armed once for the rest.
+    EXPECT_CALL(timer_, start(14000 - 5000));
+
+    now_ = 3000;
+    ASSERT_TRUE(ui_.mockOpenButtonEvent());
+    now_ = 4000;
+    ASSERT_TRUE(ui_.mockOpenButtonEvent());
+
+    now_ = 5000;
+    ASSERT_TRUE(timer_.mockExpired());
+    ASSERT_TRUE(fsm_->isWaiting());
+}
+
+TEST_F(Given_CoalescedTimers, Should_CloseDoor_When_DwellDeadlineExpires)
+{
+    EXPECT_CALL(door_, close());
+    {
+        // The re-armed rest of the dwell happens to be as long as the door
+        // close timeout.
+        ::testing::InSequence sequence;
+        EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_WAITING_MSEC + 2000 - 5000));
+        EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_CLOSE_MSEC));
+    }
+
+    now_ = 5000;
+    ASSERT_TRUE(timer_.mockExpired());
+    now_ = ElevatorFsm::TIMER_WAITING_MSEC + 2000;
+    ASSERT_TRUE(timer_.mockExpired());
+
+    ASSERT_FALSE(fsm_->isWaiting());
+}
+
+TEST_F(Given_CoalescedTimers, Should_RestartTimer_When_DeadlineMovesSooner)
+{
+    EXPECT_CALL(timer_, start(14000 - 5000));
+    EXPECT_CALL(door_, close());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_CLOSE_MSEC));
+
+    // The dwell, pushed out to 14000, is re-armed at 5000. The door close
+    // timeout, at 13000, is due before that.
+    now_ = 4000;
+    ASSERT_TRUE(ui_.mockOpenButtonEvent());
+    now_ = 5000;
+    ASSERT_TRUE(timer_.mockExpired());
+    now_ = 6000;
+    ASSERT_TRUE(ui_.mockCloseButtonEvent());
+}
+
+TEST_F(Given_CoalescedTimers, Should_KeepTimer_When_DeadlineSoonerWithinSlack)
+{
+    EXPECT_CALL(timer_, start(14000 - 5000));
+    EXPECT_CALL(door_, close());
+
+    // As above, with the door close timeout 1000 sooner than the running
+    // timer: within the slack, so its expiry at 14000 will do.
+    fsm_->setTimerCoalescing(true, 1000);
+    now_ = 4000;
+    ASSERT_TRUE(ui_.mockOpenButtonEvent());
+    now_ = 5000;
+    ASSERT_TRUE(timer_.mockExpired());
+    now_ = 6000;
+    ASSERT_TRUE(ui_.mockCloseButtonEvent());
+}
+
+//---------- Given_IngressGateway ---------------------------------------------
+
+class Given_IngressGateway: public TestElevatorFsmBuilder {
+public:
+    enum
+    {
+        CARS = 3,
+        CAR  = 2,
+    };
+
+    Given_IngressGateway()
+        : path_("/tmp/elevator-ingress-test-" + std::to_string(getpid()) + ".shm")
+        {}
+
+    void SetUp( ) {
+        ASSERT_TRUE(host_.create(path_.c_str(), CARS));
+        ASSERT_TRUE(driver_.open(path_.c_str()));
+        gateway_.reset(new ElevatorIngressGateway(*host_.region()));
+        gateway_->attach(CAR, fsm_);
+    }
+
+    void TearDown( ) {
+        driver_.close();
+        host_.close();
+        unlink(path_.c_str());
+    }
+
+    std::string                             path_;
+    ElevatorIngressMap                      host_;
+    ElevatorIngressMap                      driver_;
+    std::unique_ptr<ElevatorIngressGateway> gateway_;
+};
+
+TEST_F(Given_IngressGateway, Should_RouteToCar_When_BatchFlushed)
+{
+    ElevatorIngressProducer ui(*driver_.region(), ElevatorIngressRegion::SOURCE_UI);
+    ElevatorIngressProducer drive(*driver_.region(), ElevatorIngressRegion::SOURCE_DRIVE);
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+
+    // Posted events aren't announced until the flush.
+    ASSERT_TRUE(ui.post(CAR, ElevatorIngressEvent::FLOOR_REQUEST, ElevatorFsm::GROUND_FLOOR + 1));
+    ASSERT_TRUE(ui.post(CAR, ElevatorIngressEvent::CLOSE_BUTTON));
+    ASSERT_EQ(0u, gateway_->drain());
+    ui.flush();
+    ASSERT_EQ(2u, gateway_->drain());
+    ASSERT_EQ(1u, gateway_->rejected());
+
+    ASSERT_TRUE(drive.post(CAR, ElevatorIngressEvent::ARRIVED));
+    drive.flush();
+    ASSERT_EQ(1u, gateway_->wait(1000));
+    ASSERT_EQ(0u, gateway_->sleeps());
+    ASSERT_EQ(ElevatorFsm::STATE_OPENING, fsm_->stateId());
+    ASSERT_EQ(3u, gateway_->routed());
+    ASSERT_GT(gateway_->latencyNsec(99), 0u);
+}
+
+TEST_F(Given_IngressGateway, Should_DiscardEvent_When_CarNotAttached)
+{
+    ElevatorIngressProducer door(*driver_.region(), ElevatorIngressRegion::SOURCE_DOOR);
+
+    ASSERT_TRUE(door.post(CAR - 1, ElevatorIngressEvent::OPENED));
+    ASSERT_FALSE(door.post(CARS, ElevatorIngressEvent::OPENED));
+    door.flush();
+    ASSERT_EQ(1u, gateway_->drain());
+    ASSERT_EQ(1u, gateway_->discarded());
+    ASSERT_EQ(0u, gateway_->rejected());
+    ASSERT_EQ(1u, door.dropped());
+}
+
+TEST_F(Given_IngressGateway, Should_DropEvent_When_RingFull)
+{
+    ElevatorIngressProducer ui(*driver_.region(), ElevatorIngressRegion::SOURCE_UI);
+
+    for (size_t event = 0; event < ElevatorIngressRegion::RING_EVENTS; ++event)
+    {
+        ASSERT_TRUE(ui.post(CAR - 1, ElevatorIngressEvent::OPEN_BUTTON));
+    }
+    ASSERT_FALSE(ui.post(CAR - 1, ElevatorIngressEvent::OPEN_BUTTON));
+    ui.flush();
+    ASSERT_EQ(size_t(ElevatorIngressRegion::RING_EVENTS), gateway_->drain());
+    ASSERT_TRUE(ui.post(CAR - 1, ElevatorIngressEvent::OPEN_BUTTON));
+}
+
+TEST_F(Given_IngressGateway, Should_WakeHost_When_DriverFlushesWhileAsleep)
+{
+    ElevatorIngressProducer ui(*driver_.region(), ElevatorIngressRegion::SOURCE_UI);
+
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+
+    std::thread driver([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        ui.post(CAR, ElevatorIngressEvent::OPEN_BUTTON);
+        ui.flush();
+    });
+
+    size_t routed = 0;
+    while (routed == 0)
+    {
+        routed = gateway_->wait(5000);
+    }
+    driver.join();
+
+    ASSERT_EQ(1u, routed);
+    ASSERT_EQ(ui.wakes(), gateway_->sleeps());
+    ASSERT_EQ(ElevatorFsm::STATE_OPENING, fsm_->stateId());
+}
+
+//---------- Given_SharedShaft ------------------------------------------------
+
+TEST(Given_ElevatorShaft, Should_RefuseReservation_When_OtherCarInTheWay)
+{
+    ElevatorShaft shaft(12);
+
+    ASSERT_TRUE(shaft.park(ElevatorShaft::LOWER_CAR, 1));
+    ASSERT_TRUE(shaft.park(ElevatorShaft::UPPER_CAR, 5));
+    ASSERT_FALSE(shaft.park(ElevatorShaft::LOWER_CAR, 5));
+
+    // Up to the floor below the upper car, but no further.
+    ASSERT_TRUE(shaft.reserve(ElevatorShaft::LOWER_CAR, 1, 4));
+    ASSERT_FALSE(shaft.reserve(ElevatorShaft::LOWER_CAR, 1, 7));
+    ASSERT_EQ(4u, shaft.highest(ElevatorShaft::LOWER_CAR));
+    ASSERT_EQ(1u, shaft.refusals());
+
+    // The upper car is in the way of the refused trip until it moves up.
+    ASSERT_EQ(8u, shaft.yieldFloor(ElevatorShaft::UPPER_CAR));
+    ASSERT_EQ(size_t(ElevatorShaft::NO_FLOOR), shaft.yieldFloor(ElevatorShaft::LOWER_CAR));
+    ASSERT_TRUE(shaft.reserve(ElevatorShaft::UPPER_CAR, 5, 8));
+    shaft.release(ElevatorShaft::UPPER_CAR, 8);
+    ASSERT_FALSE(shaft.isBlocking(ElevatorShaft::UPPER_CAR));
+    ASSERT_TRUE(shaft.reserve(ElevatorShaft::LOWER_CAR, 4, 7));
+}
+
+TEST(Given_ElevatorShaft, Should_RefuseFloor_When_OutsideShaft)
+{
+    ElevatorShaft shaft(12);
+
+    ASSERT_FALSE(shaft.park(ElevatorShaft::LOWER_CAR, ElevatorShaft::NO_FLOOR));
+    ASSERT_FALSE(shaft.park(ElevatorShaft::UPPER_CAR, 13));
+    ASSERT_TRUE(shaft.park(ElevatorShaft::LOWER_CAR, 1));
+
+    // 0x10001 would pack as floor 1, but is refused rather than truncated.
+    ASSERT_FALSE(shaft.reserve(ElevatorShaft::LOWER_CAR, 1, 0x10001));
+    ASSERT_FALSE(shaft.reserve(ElevatorShaft::LOWER_CAR, 1, 13));
+    ASSERT_EQ(1u, shaft.highest(ElevatorShaft::LOWER_CAR));
+    ASSERT_EQ(0u, shaft.refusals());
+    ASSERT_TRUE(shaft.reserve(ElevatorShaft::LOWER_CAR, 1, 12));
+}
+
+class Given_SharedShaft: public TestElevatorFsmBuilder {
+public:
+    Given_SharedShaft()
+        : shaft_(12)
+        , now_(0)
+    {
+        EXPECT_CALL(timer_, nowMsec())
+            .WillRepeatedly(::testing::ReturnPointee(&now_));
+    }
+
+    void SetUp( ) {
+        // The FSM is the lower car, at the ground floor; the upper car is
+        // three floors up.
+        ASSERT_TRUE(shaft_.park(ElevatorShaft::UPPER_CAR, ElevatorFsm::GROUND_FLOOR + 3));
+        ASSERT_TRUE(fsm_->setShaft(&shaft_, ElevatorShaft::LOWER_CAR));
+    }
+
+    ElevatorShaft shaft_;
+    size_t        now_;
+};
+
+TEST_F(Given_SharedShaft, Should_HoldUntilOtherCarMoves_When_DestinationBlocked)
+{
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_SHAFT_RETRY_MSEC));
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 4));
+    ASSERT_TRUE(fsm_->isHeldForShaft());
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, fsm_->stateId());
+
+    // Still in the way on the first retry; out of the way on the second.
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_SHAFT_RETRY_MSEC));
+    now_ = ElevatorFsm::TIMER_SHAFT_RETRY_MSEC;
+    ASSERT_TRUE(timer_.mockExpired());
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 4));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+    ASSERT_TRUE(shaft_.reserve(ElevatorShaft::UPPER_CAR, ElevatorFsm::GROUND_FLOOR + 3,
+                               ElevatorFsm::GROUND_FLOOR + 8));
+    shaft_.release(ElevatorShaft::UPPER_CAR, ElevatorFsm::GROUND_FLOOR + 8);
+    now_ = 2 * ElevatorFsm::TIMER_SHAFT_RETRY_MSEC;
+    ASSERT_TRUE(timer_.mockExpired());
+
+    ASSERT_FALSE(fsm_->isHeldForShaft());
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 4, shaft_.highest(ElevatorShaft::LOWER_CAR));
+}
+
+TEST_F(Given_SharedShaft, Should_HoldAnew_When_ResumedAfterStopWhileHeld)
+{
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_SHAFT_RETRY_MSEC))
+        .Times(3);
+    EXPECT_CALL(drive_, stop());
+    EXPECT_CALL(drive_, start());
+    EXPECT_CALL(ui_, alarmOn());
+    EXPECT_CALL(ui_, alarmOff());
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 4));
+    ASSERT_TRUE(fsm_->isHeldForShaft());
+
+    ASSERT_TRUE(ui_.mockStopButtonEvent());
+    ASSERT_EQ(ElevatorFsm::STATE_HOLDING, fsm_->stateId());
+    ASSERT_FALSE(fsm_->isHeldForShaft());
+
+    // Stopped for longer than the hold limit, then resumed: the hold starts
+    // over, and a retry doesn't give up.
+    now_ = ElevatorFsm::TIMEOUT_SHAFT_HOLD_MSEC + 1000;
+    ASSERT_TRUE(ui_.mockStopButtonEvent());
+    ASSERT_TRUE(fsm_->isHeldForShaft());
+
+    now_ += ElevatorFsm::TIMER_SHAFT_RETRY_MSEC;
+    ASSERT_TRUE(timer_.mockExpired());
+    ASSERT_EQ(ElevatorFsm::STATE_MOVING, fsm_->stateId());
+}
+
+TEST_F(Given_SharedShaft, Should_TakeLaterStopFirst_When_DestinationBlocked)
+{
+    const size_t stops[] = { ElevatorFsm::GROUND_FLOOR + 5, ElevatorFsm::GROUND_FLOOR + 1 };
+
+    EXPECT_CALL(drive_, goToFloor(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_MOVE_TO_FLOOR_MSEC));
+
+    ASSERT_TRUE(ui_.mockStopList(stops, 2));
+    ASSERT_FALSE(fsm_->isHeldForShaft());
+    ASSERT_TRUE(fsm_->hasPendingStops());
+
+    // On arrival the car keeps just the floor it stopped at.
+    EXPECT_CALL(ui_, arrived(ElevatorFsm::GROUND_FLOOR + 1));
+    EXPECT_CALL(door_, open());
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMEOUT_DOOR_OPEN_MSEC));
+    ASSERT_TRUE(drive_.mockArrivedEvent());
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 1, shaft_.lowest(ElevatorShaft::LOWER_CAR));
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 1, shaft_.highest(ElevatorShaft::LOWER_CAR));
+}
+
+TEST_F(Given_SharedShaft, Should_GoOutOfService_When_HeldTooLong)
+{
+    EXPECT_CALL(timer_, start(ElevatorFsm::TIMER_SHAFT_RETRY_MSEC))
+        .Times(2);
+    EXPECT_CALL(ui_, outOfService());
+
+    ASSERT_TRUE(ui_.mockFloorRequest(ElevatorFsm::GROUND_FLOOR + 4));
+    now_ = ElevatorFsm::TIMER_SHAFT_RETRY_MSEC;
+    ASSERT_TRUE(timer_.mockExpired());
+    now_ = ElevatorFsm::TIMEOUT_SHAFT_HOLD_MSEC;
+    ASSERT_TRUE(timer_.mockExpired());
+
+    ASSERT_FALSE(fsm_->isInService());
+    ASSERT_FALSE(fsm_->isHeldForShaft());
+}
+
+//---------- Given_TrafficClassifier ------------------------------------------
+
+TEST(Given_TrafficClassifier, Should_DetectUpPeak_When_MostRequestsFromLobby)
+{
+    ElevatorTrafficClassifier classifier(12);
+    const size_t lobby = ElevatorFsm::GROUND_FLOOR;
+
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_IDLE, classifier.classify(0));
+
+    for (size_t floor = lobby + 1; floor <= lobby + 8; ++floor)
+    {
+        classifier.arrival(lobby, 1000);
+        classifier.floorRequest(lobby, floor, 1000);
+    }
+    classifier.floorRequest(lobby + 3, lobby + 5, 1000);
+
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_UP_PEAK, classifier.classify(2000));
+    ASSERT_EQ(9u, classifier.requests(2000));
+    ASSERT_EQ(8u, classifier.arrivals(lobby, 2000));
+    ASSERT_EQ(2u, classifier.destinations(lobby + 5, 2000));
+}
+
+TEST(Given_TrafficClassifier, Should_DetectDownPeak_When_MostRequestsToLobby)
+{
+    ElevatorTrafficClassifier classifier(12);
+    const size_t lobby = ElevatorFsm::GROUND_FLOOR;
+
+    for (size_t floor = lobby + 1; floor <= lobby + 8; ++floor)
+    {
+        classifier.floorRequest(floor, lobby, 1000);
+    }
+    classifier.floorRequest(lobby, lobby + 2, 1000);
+    classifier.floorRequest(lobby, lobby + 4, 1000);
+
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_DOWN_PEAK, classifier.classify(2000));
+}
+
+TEST(Given_TrafficClassifier, Should_StayInPeak_When_ShareFallsOnlySlightly)
+{
+    ElevatorTrafficClassifier classifier(12);
+    const size_t lobby = ElevatorFsm::GROUND_FLOOR;
+
+    // 6 of 10 from the lobby enters up-peak...
+    for (size_t request = 0; request < 10; ++request)
+    {
+        classifier.floorRequest((request < 6) ? lobby : lobby + 3, lobby + 5, 1000);
+    }
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_UP_PEAK, classifier.classify(1000));
+
+    // ...and 6 of 12 doesn't leave it, though it wouldn't have entered it.
+    classifier.floorRequest(lobby + 2, lobby + 5, 1000);
+    classifier.floorRequest(lobby + 2, lobby + 5, 1000);
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_UP_PEAK, classifier.classify(1000));
+
+    // 6 of 14 does.
+    classifier.floorRequest(lobby + 2, lobby + 5, 1000);
+    classifier.floorRequest(lobby + 2, lobby + 5, 1000);
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_TWO_WAY, classifier.classify(1000));
+}
+
+TEST(Given_TrafficClassifier, Should_ReturnToIdle_When_RequestsLeaveTheWindow)
+{
+    ElevatorTrafficClassifier classifier(12);
+    const size_t lobby = ElevatorFsm::GROUND_FLOOR;
+
+    for (size_t request = 0; request < 8; ++request)
+    {
+        classifier.floorRequest(lobby, lobby + 1 + request, 1000);
+    }
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_UP_PEAK, classifier.classify(1000));
+
+    // Still counted until the bucket they went into leaves the window.
+    uint64_t later = 1000 + ElevatorSlidingCounter::WINDOW_MSEC - ElevatorSlidingCounter::BUCKET_MSEC;
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_UP_PEAK, classifier.classify(later));
+    ASSERT_EQ(ElevatorTrafficClassifier::MODE_IDLE,
+              classifier.classify(later + ElevatorSlidingCounter::BUCKET_MSEC));
+    ASSERT_EQ(0u, classifier.requests(later + ElevatorSlidingCounter::BUCKET_MSEC));
+
+    // Long after, the window starts again from nothing.
+    classifier.floorRequest(lobby, lobby + 2, 10 * ElevatorSlidingCounter::WINDOW_MSEC);
+    ASSERT_EQ(1u, classifier.requests(10 * ElevatorSlidingCounter::WINDOW_MSEC));
+}
+
+//---------- Given_ElevatorFleet ----------------------------------------------
+
+TEST(Given_ElevatorFleet, Should_PlaceEachCarOnItsOwnCacheLines_When_Built)
+{
+    ElevatorFleet<BenchCar> fleet(5);
+
+    ASSERT_EQ(5u, fleet.size());
+    ASSERT_EQ(0u, ElevatorFleet<BenchCar>::slotBytes() % ElevatorFleet<BenchCar>::CACHE_LINE_BYTES);
+
+    for (size_t id = 0; id < fleet.size(); ++id)
+    {
+        uintptr_t car = reinterpret_cast<uintptr_t>(&fleet.car(id));
+        uintptr_t fsm = reinterpret_cast<uintptr_t>(&fleet.fsm(id));
+
+        // The car's components and then its FSM, in one contiguous slot.
+        ASSERT_EQ(0u, car % ElevatorFleet<BenchCar>::CACHE_LINE_BYTES);
+        ASSERT_GT(fsm, car);
+        ASSERT_LT(fsm + sizeof(ElevatorFsm), car + ElevatorFleet<BenchCar>::slotBytes() + 1);
+        if (id > 0)
+        {
+            ASSERT_EQ(ElevatorFleet<BenchCar>::slotBytes(),
+                      car - reinterpret_cast<uintptr_t>(&fleet.car(id - 1)));
+        }
+        ASSERT_TRUE(fleet.fsm(id).isInService());
+    }
+}
+
+TEST(Given_ElevatorFleet, Should_DriveOnlyItsOwnFsm_When_CarTakesTrip)
+{
+    ElevatorFleet<BenchCar> fleet(3);
+
+    fleet.car(1).trip(ElevatorFsm::GROUND_FLOOR + 4);
+
+    ASSERT_EQ(ElevatorFsm::GROUND_FLOOR + 4u, fleet.car(1).drive.getFloor());
+    ASSERT_TRUE(fleet.fsm(1).isIdle());
+    ASSERT_EQ(size_t(ElevatorFsm::GROUND_FLOOR), fleet.car(0).drive.getFloor());
+    ASSERT_EQ(size_t(ElevatorFsm::GROUND_FLOOR), fleet.car(2).drive.getFloor());
+}
+
+// Bench components whose construction throws on a given car.
+struct ThrowingCar: public BenchCar
+{
+    ThrowingCar()
+    {
+        if (++built == throwOn)
+        {
+            throw std::runtime_error("car");
+        }
+    }
+
+    ~ThrowingCar()
+    {
+        ++destroyed;
+    }
+
+    static size_t built;
+    static size_t destroyed;
+    static size_t throwOn;
+};
+
+size_t ThrowingCar::built     = 0;
+size_t ThrowingCar::destroyed = 0;
+size_t ThrowingCar::throwOn   = 0;
+
+TEST(Given_ElevatorFleet, Should_DestroyBuiltCars_When_CarThrows)
+{
+    ThrowingCar::throwOn = 3;
+
+    ASSERT_THROW(ElevatorFleet<ThrowingCar> fleet(5), std::runtime_error);
+    ASSERT_EQ(3u, ThrowingCar::built);
+    ASSERT_EQ(2u, ThrowingCar::destroyed);
+}
+
+TEST(Given_ElevatorFleet, Should_Throw_When_SizeOverflows)
+{
+    size_t cars = SIZE_MAX / ElevatorFleet<BenchCar>::slotBytes() + 1;
+
+    ASSERT_THROW(ElevatorFleet<BenchCar> fleet(cars), std::bad_array_new_length);
+}
+
+//---------- Main program -----------------------------------------------------
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}